@@ -0,0 +1,138 @@
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Verifier.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "ProgramGenerator.h"
+
+using namespace llvm;
+
+static cl::OptionCategory irGeneratorCategory("IR generator options");
+
+static cl::opt<std::string> outputFilename(
+        "o",
+        cl::desc("Output file, bitcode if it ends with .bc (default: textual IR on the standard output)"),
+        cl::value_desc("filename"),
+        cl::init("-"),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<uint64_t> blocks(
+        "blocks",
+        cl::desc("Minimum number of basic blocks of main, regions are added until it is reached"),
+        cl::init(100),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<unsigned> inputs(
+        "inputs",
+        cl::desc("Number of input variables a1..aN"),
+        cl::init(4),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<unsigned> locals(
+        "locals",
+        cl::desc("Number of local variables x1..xN the assignments write"),
+        cl::init(4),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<unsigned> depth(
+        "depth",
+        cl::desc("Nesting depth of the if statements of a region"),
+        cl::init(3),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<unsigned> fanOut(
+        "fan-out",
+        cl::desc("Number of statements of every region and if or else body"),
+        cl::init(2),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<double> arithmeticDensity(
+        "arithmetic-density",
+        cl::desc("Average number of assignments before every if statement"),
+        cl::init(1),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<unsigned> loops(
+        "loops",
+        cl::desc("Number of while loops with a constant trip count, spread over main"),
+        cl::init(1),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<double> magicEqualities(
+        "magic-equalities",
+        cl::desc("Probability that a condition compares an input for equality with a magic constant, "
+                 "like a1 == 1401"),
+        cl::init(0.1),
+        cl::cat(irGeneratorCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Random seed, the same options and seed always generate the same program"),
+        cl::init(0),
+        cl::cat(irGeneratorCategory)
+);
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(irGeneratorCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Generator of large LLVM IR programs for the testers\n");
+
+    if (fanOut == 0 || arithmeticDensity < 0 || magicEqualities < 0 || magicEqualities > 1) {
+        fprintf(stderr, "error: --fan-out must be positive, --arithmetic-density at least 0 and "
+                        "--magic-equalities between 0 and 1\n");
+        return EXIT_FAILURE;
+    }
+
+    LLVMContext context;
+    std::string moduleName = outputFilename == "-" ? "generated" : sys::path::filename(outputFilename).str();
+    Module module(moduleName, context);
+    module.setSourceFileName(moduleName);
+
+    GeneratorOptions options{inputs, locals, depth, fanOut, arithmeticDensity, loops, magicEqualities, blocks,
+                             randomSeed};
+    ProgramGenerator generator(options, module);
+    generator.generate();
+
+    if (verifyModule(module, &errs())) {
+        fprintf(stderr, "error: the generated module is invalid\n");
+        return EXIT_FAILURE;
+    }
+
+    std::error_code errorCode;
+    raw_fd_ostream out(outputFilename, errorCode, sys::fs::OF_None);
+    if (errorCode) {
+        fprintf(stderr, "error: failed to open \"%s\": %s\n", outputFilename.c_str(), errorCode.message().c_str());
+        return EXIT_FAILURE;
+    }
+    if (sys::path::extension(outputFilename) == ".bc") {
+        WriteBitcodeToFile(module, out);
+    } else {
+        module.print(out, nullptr);
+    }
+    out.close();
+    if (out.has_error()) {
+        out.clear_error();
+        fprintf(stderr, "error: failed to write \"%s\"\n", outputFilename.c_str());
+        return EXIT_FAILURE;
+    }
+
+    errs() << "Blocks: " << generator.getBlockCount() << "\n";
+    return 0;
+}
@@ -0,0 +1,284 @@
+#ifndef IR_GENERATOR_PROGRAMGENERATOR_H
+#define IR_GENERATOR_PROGRAMGENERATOR_H
+
+#include <cstdint>
+#include <cmath>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Constants.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+
+#include "RandomEngine.h"
+
+using namespace llvm;
+
+struct GeneratorOptions {
+    // input variables a1..aN, read before they are written
+    unsigned inputs;
+    // local variables x1..xN, initialized to 0 and written by the assignments
+    unsigned locals;
+    // nesting depth of the if statements of a region
+    unsigned depth;
+    // statements in the body of every if, else and region
+    unsigned fanOut;
+    // average number of assignments before every statement
+    double arithmeticDensity;
+    // while loops with a constant trip count, spread over the regions
+    unsigned loops;
+    // probability that a condition is an equality of an input with a constant outside the random test range
+    double magicEqualities;
+    // regions are generated until main has at least this many blocks
+    uint64_t blocks;
+    uint64_t seed;
+};
+
+/**
+ * @brief Generates a main function in the style clang emits at -O0
+ *
+ * Every variable is an alloca of the entry block that is only accessed by loads and stores, every branch
+ * condition is an icmp of a loaded variable with a constant, and assignments store a binary operation of
+ * variables and constants, like the sample programs. main is a sequence of regions: a region is fanOut
+ * statements, a statement is a few assignments followed by an if (with an else half of the time) whose
+ * bodies are regions one level deeper. Loops wrap whole regions, spread evenly over main. The program only
+ * depends on the options, the seed included.
+ */
+class ProgramGenerator {
+private:
+    // constants of ordinary conditions and assignments, the range the random tester draws inputs from
+    static const int CONSTANT_RANGE = 100;
+    // magic constants are far outside it, inside the range of the DSE tester
+    static const int MAGIC_RANGE = 100'000;
+    static const int MAX_TRIP_COUNT = 10;
+
+    const GeneratorOptions options;
+    RandomEngine engine;
+
+    LLVMContext &context;
+    Module &module;
+    IRBuilder<> builder;
+    Type *int32Ty;
+    Function *function = nullptr;
+
+    AllocaInst *returnValue = nullptr;
+    std::vector<AllocaInst *> inputs;
+    std::vector<AllocaInst *> locals;
+    std::vector<AllocaInst *> loopCounters;
+    unsigned nextLoopCounter = 0;
+    uint64_t blockCount = 0;
+
+    BasicBlock *createBlock(const std::string &name) {
+        blockCount++;
+        return BasicBlock::Create(context, name);
+    }
+
+    // blocks are added to main when code is emitted into them, so they appear in source order like clang's
+    void startBlock(BasicBlock *block) {
+        block->insertInto(function);
+        builder.SetInsertPoint(block);
+    }
+
+    AllocaInst *createVariable(const std::string &name) {
+        AllocaInst *variable = builder.CreateAlloca(int32Ty, nullptr, name);
+        variable->setAlignment(Align(4));
+        return variable;
+    }
+
+    Value *load(AllocaInst *variable) {
+        return builder.CreateAlignedLoad(int32Ty, variable, MaybeAlign(4));
+    }
+
+    void store(Value *value, AllocaInst *variable) {
+        builder.CreateAlignedStore(value, variable, MaybeAlign(4));
+    }
+
+    Constant *constant(int value) {
+        return ConstantInt::get(int32Ty, value, true);
+    }
+
+    template<typename T>
+    T *pick(const std::vector<T *> &values) {
+        return values[engine.inRange(0, (int) values.size() - 1)];
+    }
+
+    AllocaInst *pickVariable() {
+        if (locals.empty() || (!inputs.empty() && engine.coinFlip())) {
+            return pick(inputs);
+        }
+        return pick(locals);
+    }
+
+    Value *generateOperand() {
+        if (engine.coinFlip()) {
+            return constant(engine.inRange(-CONSTANT_RANGE, CONSTANT_RANGE));
+        }
+        return load(pickVariable());
+    }
+
+    // x = a + 5, x = b * y, x = a / 3, ...
+    void generateAssignment() {
+        AllocaInst *target = pick(locals);
+        Value *lhs = load(pickVariable());
+        Value *result;
+        switch (engine.inRange(0, 3)) {
+            case 0:
+                result = builder.CreateNSWAdd(lhs, generateOperand(), "add");
+                break;
+            case 1:
+                result = builder.CreateNSWSub(lhs, generateOperand(), "sub");
+                break;
+            case 2:
+                result = builder.CreateNSWMul(lhs, generateOperand(), "mul");
+                break;
+            default:
+                // only constant divisors, so no path divides by zero
+                result = builder.CreateSDiv(lhs, constant(engine.inRange(1, 9)), "div");
+        }
+        store(result, target);
+    }
+
+    void generateAssignments() {
+        if (locals.empty()) {
+            return;
+        }
+        double whole = std::floor(options.arithmeticDensity);
+        unsigned count = (unsigned) whole + (engine.nextDouble() < options.arithmeticDensity - whole ? 1 : 0);
+        for (unsigned i = 0; i < count; i++) {
+            generateAssignment();
+        }
+    }
+
+    Value *generateCondition() {
+        if (!inputs.empty() && engine.nextDouble() < options.magicEqualities) {
+            return builder.CreateICmpEQ(load(pick(inputs)), constant(engine.inRange(-MAGIC_RANGE, MAGIC_RANGE)),
+                                        "cmp");
+        }
+        static const CmpInst::Predicate PREDICATES[] = {
+                CmpInst::ICMP_EQ, CmpInst::ICMP_NE, CmpInst::ICMP_SGT,
+                CmpInst::ICMP_SGE, CmpInst::ICMP_SLT, CmpInst::ICMP_SLE,
+        };
+        return builder.CreateICmp(PREDICATES[engine.inRange(0, 5)], load(pickVariable()),
+                                  constant(engine.inRange(-CONSTANT_RANGE, CONSTANT_RANGE)), "cmp");
+    }
+
+    void generateIf(unsigned depth) {
+        Value *condition = generateCondition();
+        BasicBlock *thenBlock = createBlock("if.then");
+        BasicBlock *elseBlock = engine.coinFlip() ? createBlock("if.else") : nullptr;
+        BasicBlock *endBlock = createBlock("if.end");
+        builder.CreateCondBr(condition, thenBlock, elseBlock != nullptr ? elseBlock : endBlock);
+
+        startBlock(thenBlock);
+        generateRegion(depth - 1);
+        builder.CreateBr(endBlock);
+
+        if (elseBlock != nullptr) {
+            startBlock(elseBlock);
+            generateRegion(depth - 1);
+            builder.CreateBr(endBlock);
+        }
+
+        startBlock(endBlock);
+    }
+
+    void generateRegion(unsigned depth) {
+        for (unsigned i = 0; i < options.fanOut; i++) {
+            generateAssignments();
+            if (depth > 0 && (!inputs.empty() || !locals.empty())) {
+                generateIf(depth);
+            }
+        }
+    }
+
+    // average number of blocks of a region without loops
+    double getExpectedRegionBlocks(unsigned depth) const {
+        if (depth == 0 || (options.inputs == 0 && options.locals == 0)) {
+            return 0;
+        }
+        // then and end blocks, an else block half of the time, and the regions of the bodies
+        return options.fanOut * (2.5 + 1.5 * getExpectedRegionBlocks(depth - 1));
+    }
+
+    // while (i < tripCount) { region; i++; }, nested when there are several loops
+    void generateLoops(unsigned loops) {
+        if (loops == 0) {
+            generateRegion(options.depth);
+            return;
+        }
+        AllocaInst *counter = loopCounters[nextLoopCounter++];
+        store(constant(0), counter);
+        BasicBlock *conditionBlock = createBlock("while.cond");
+        BasicBlock *bodyBlock = createBlock("while.body");
+        BasicBlock *endBlock = createBlock("while.end");
+        builder.CreateBr(conditionBlock);
+
+        startBlock(conditionBlock);
+        Value *condition = builder.CreateICmpSLT(load(counter), constant(engine.inRange(1, MAX_TRIP_COUNT)), "cmp");
+        builder.CreateCondBr(condition, bodyBlock, endBlock);
+
+        startBlock(bodyBlock);
+        generateLoops(loops - 1);
+        store(builder.CreateNSWAdd(load(counter), constant(1), "inc"), counter);
+        builder.CreateBr(conditionBlock);
+
+        startBlock(endBlock);
+    }
+
+public:
+    ProgramGenerator(const GeneratorOptions &options, Module &module)
+            : options(options), engine(options.seed), context(module.getContext()), module(module),
+              builder(module.getContext()), int32Ty(Type::getInt32Ty(module.getContext())) {}
+
+    Function *generate() {
+        function = Function::Create(FunctionType::get(int32Ty, false), GlobalValue::ExternalLinkage, "main",
+                                    module);
+        startBlock(createBlock("entry"));
+
+        returnValue = createVariable("retval");
+        for (unsigned i = 1; i <= options.inputs; i++) {
+            inputs.push_back(createVariable("a" + std::to_string(i)));
+        }
+        for (unsigned i = 1; i <= options.locals; i++) {
+            locals.push_back(createVariable("x" + std::to_string(i)));
+        }
+        for (unsigned i = 1; i <= options.loops; i++) {
+            loopCounters.push_back(createVariable("i" + std::to_string(i)));
+        }
+        store(constant(0), returnValue);
+        for (auto *local: locals) {
+            store(constant(0), local);
+        }
+
+        // loop j wraps region (j + 0.5) * regions / loops, a region gets nested loops when there are more
+        // loops than regions
+        double regionBlocks = getExpectedRegionBlocks(options.depth);
+        uint64_t regions = 1;
+        if (regionBlocks > 0) {
+            regions = std::max<uint64_t>((uint64_t) std::ceil(options.blocks / regionBlocks), 1);
+        }
+        unsigned nextLoop = 0;
+        for (uint64_t region = 0; region < regions || (regionBlocks > 0 && blockCount < options.blocks); region++) {
+            unsigned loops = 0;
+            while (nextLoop < options.loops && (uint64_t) ((nextLoop + 0.5) * regions / options.loops) == region) {
+                nextLoop++;
+                loops++;
+            }
+            generateLoops(loops);
+        }
+
+        builder.CreateRet(load(returnValue));
+        return function;
+    }
+
+    uint64_t getBlockCount() const {
+        return blockCount;
+    }
+};
+
+#endif //IR_GENERATOR_PROGRAMGENERATOR_H
@@ -0,0 +1,375 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BATCHPATHNAVIGATOR_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BATCHPATHNAVIGATOR_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "CompiledFunction.h"
+#include "ExecutionBudget.h"
+#include "Instrumentation.h"
+#include "PathNavigator.h"
+#include "Utils.h"
+
+using namespace llvm;
+
+/**
+ * @brief Navigates up to MAX_LANES inputs through a compiled function at once.
+ *
+ * Registers are stored as structure-of-arrays rows (registers[reg * laneCount + lane]) and every
+ * decoded instruction is executed for all lanes of a group with the branch-free lane kernel of its
+ * width and signedness (IntegerKernels.h), so the arithmetic and comparisons are vectorized by the
+ * compiler. Each conditional branch splits the lane mask of the group into the lanes that take the
+ * true and the false successor.
+ *
+ * A lane that divides by zero, reads an unassigned variable or reaches an unsupported value or
+ * terminator is removed from its group with the Error status, the other lanes go on.
+ */
+class BatchPathNavigator {
+public:
+    static const unsigned MAX_LANES = 64;
+
+private:
+    typedef uint64_t LaneMask;
+
+    struct LaneGroup {
+        unsigned blockIndex;
+        LaneMask lanes;
+    };
+
+    const CompiledFunction &function;
+    const unsigned laneCount;
+    std::vector<int64_t> registers;
+    std::vector<LaneMask> assignedSlots;
+
+    // per lane 0 / -1 blend masks of the group being executed
+    std::vector<int64_t> activeLanes;
+    std::vector<int64_t> immediateLhs, immediateRhs;
+
+    std::vector<std::vector<BasicBlock *>> paths;
+    std::vector<std::vector<CmpRecord>> cmpRecords;
+
+    const ExecutionBudget budget;
+    std::vector<NavigationStatus> statuses;
+    std::vector<std::string> errors;
+    std::vector<std::vector<uint64_t>> loopIterations;
+
+public:
+
+    // the step budget applies to every lane, the time budget to the whole batch
+    BatchPathNavigator(const CompiledFunction &function,
+                       const std::vector<std::map<std::string, int64_t>> &argumentsMaps,
+                       const ExecutionBudget &budget = {0, 0})
+            : function(function), laneCount(argumentsMaps.size()),
+              registers((size_t) function.getRegisterCount() * argumentsMaps.size()),
+              assignedSlots(function.getSlotCount()),
+              activeLanes(argumentsMaps.size()),
+              immediateLhs(argumentsMaps.size()), immediateRhs(argumentsMaps.size()),
+              paths(argumentsMaps.size()), cmpRecords(argumentsMaps.size()), budget(budget),
+              statuses(argumentsMaps.size(), NavigationStatus::Completed), errors(argumentsMaps.size()),
+              loopIterations(argumentsMaps.size(), std::vector<uint64_t>(function.getLoopCount())) {
+        if (laneCount == 0 || laneCount > MAX_LANES) {
+            throw std::runtime_error("Batch size must be between 1 and " + std::to_string(MAX_LANES));
+        }
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            for (auto &argument: argumentsMaps[lane]) {
+                int slot = function.getSlot(argument.first);
+                if (slot < 0) {
+                    throw std::runtime_error("Variable " + argument.first + " not found in function");
+                }
+                row(slot)[lane] = normalizeInteger(argument.second, function.getSlotBits(slot));
+                assignedSlots[slot] |= LaneMask(1) << lane;
+            }
+        }
+    }
+
+    void navigate() {
+        INSTRUMENT_SCOPE("BatchPathNavigator::navigate");
+        const DecodedInst *code = function.getCode().data();
+        const DecodedBlock *blocks = function.getBlocks().data();
+
+        std::vector<LaneGroup> pendingGroups = {{CompiledFunction::getEntryIndex(), allLanes()}};
+        BudgetTracker timeTracker({0, budget.maxSeconds});
+        while (!pendingGroups.empty()) {
+            LaneGroup group = pendingGroups.back();
+            pendingGroups.pop_back();
+
+            if (timeTracker.step() != NavigationStatus::Completed) {
+                setStatus(group.lanes, NavigationStatus::TimeLimitExceeded);
+                for (auto &pendingGroup: pendingGroups) {
+                    setStatus(pendingGroup.lanes, NavigationStatus::TimeLimitExceeded);
+                }
+                return;
+            }
+            // lanes of a group share their whole path, so any of them tells the step count
+            if (budget.maxSteps > 0 && paths[firstLane(group.lanes)].size() >= budget.maxSteps) {
+                setStatus(group.lanes, NavigationStatus::StepLimitExceeded);
+                continue;
+            }
+
+            const DecodedBlock &block = blocks[group.blockIndex];
+            for (unsigned lane = 0; lane < laneCount; lane++) {
+                bool isActive = (group.lanes >> lane) & 1;
+                activeLanes[lane] = isActive ? -1 : 0;
+                if (isActive) {
+                    paths[lane].push_back(block.basicBlock);
+                }
+            }
+
+            execute(code + block.firstInst, code + block.lastInst, group.lanes);
+            if (!group.lanes) {
+                continue;
+            }
+
+            switch (block.terminator) {
+                case TerminatorKind::Branch: {
+                    LaneMask trueLanes = toLaneMask(row(block.conditionReg)) & group.lanes;
+                    LaneMask falseLanes = group.lanes & ~trueLanes;
+                    if (falseLanes) followEdge(code, block, 1, falseLanes, pendingGroups);
+                    if (trueLanes) followEdge(code, block, 0, trueLanes, pendingGroups);
+                    break;
+                }
+                case TerminatorKind::Jump:
+                    followEdge(code, block, 0, group.lanes, pendingGroups);
+                    break;
+                case TerminatorKind::Unsupported:
+                    failLanes(group.lanes, "Unsupported terminator " +
+                                           valueToString(block.basicBlock->getTerminator()));
+                    break;
+                case TerminatorKind::Exit:
+                    break;
+            }
+        }
+    }
+
+    unsigned getLaneCount() const {
+        return laneCount;
+    }
+
+    std::map<std::string, int64_t> getVariablesMap(unsigned lane) const {
+        std::map<std::string, int64_t> variablesMap;
+        for (unsigned slot = 0; slot < function.getSlotCount(); slot++) {
+            if (((assignedSlots[slot] >> lane) & 1) && function.isVariableSlot(slot)) {
+                variablesMap[function.getSlotName(slot)] = row(slot)[lane];
+            }
+        }
+        return variablesMap;
+    }
+
+    NavigationStatus getStatus(unsigned lane) const {
+        return statuses[lane];
+    }
+
+    // what went wrong in the lane when its status is Error
+    const std::string &getError(unsigned lane) const {
+        return errors[lane];
+    }
+
+    const std::vector<uint64_t> &getLoopIterations(unsigned lane) const {
+        return loopIterations[lane];
+    }
+
+    const std::vector<BasicBlock *> &getPath(unsigned lane) const {
+        return paths[lane];
+    }
+
+    const std::vector<CmpRecord> &getCmpRecords(unsigned lane) const {
+        return cmpRecords[lane];
+    }
+
+    NavigationResult getResult(unsigned lane, const std::map<std::string, int64_t> &argumentsMap) const {
+        return {argumentsMap, paths[lane], getVariablesMap(lane), cmpRecords[lane], statuses[lane],
+                loopIterations[lane], errors[lane]};
+    }
+
+private:
+
+    LaneMask allLanes() const {
+        return laneCount == MAX_LANES ? ~LaneMask(0) : (LaneMask(1) << laneCount) - 1;
+    }
+
+    static unsigned firstLane(LaneMask lanes) {
+        return __builtin_ctzll(lanes);
+    }
+
+    void setStatus(LaneMask lanes, NavigationStatus status) {
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            if ((lanes >> lane) & 1) {
+                statuses[lane] = status;
+            }
+        }
+    }
+
+    // ends the navigation of the lanes with the Error status, they are no longer active
+    void failLanes(LaneMask lanes, const std::string &error) {
+        setStatus(lanes, NavigationStatus::Error);
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            if ((lanes >> lane) & 1) {
+                errors[lane] = error;
+                activeLanes[lane] = 0;
+            }
+        }
+    }
+
+    // the lanes that fail are removed from lanes, the block stops when none is left
+    void execute(const DecodedInst *inst, const DecodedInst *lastInst, LaneMask &lanes) {
+        for (; inst != lastInst && lanes; ++inst) {
+            switch (inst->opCode) {
+                case OpCode::Binary:
+                    evaluateBinaryOperation(inst, lanes);
+                    break;
+                case OpCode::Store:
+                    applyStore(inst, lanes);
+                    break;
+                case OpCode::Copy:
+                    applyCopy(inst, lanes);
+                    break;
+                case OpCode::ICmp:
+                    evaluateComparison(inst, lanes);
+                    break;
+                case OpCode::Clear:
+                    assignedSlots[inst->dst] &= ~lanes;
+                    break;
+            }
+        }
+    }
+
+    void setActiveLanes(LaneMask lanes) {
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            activeLanes[lane] = ((lanes >> lane) & 1) ? -1 : 0;
+        }
+    }
+
+    // the phis of the successor are only written for the lanes that take the edge
+    void followEdge(const DecodedInst *code, const DecodedBlock &block, unsigned successor, LaneMask lanes,
+                    std::vector<LaneGroup> &pendingGroups) {
+        if (block.backEdgeLoops[successor] >= 0) {
+            for (unsigned lane = 0; lane < laneCount; lane++) {
+                if ((lanes >> lane) & 1) {
+                    loopIterations[lane][block.backEdgeLoops[successor]]++;
+                }
+            }
+        }
+        if (block.phiFirstInst[successor] != block.phiLastInst[successor]) {
+            setActiveLanes(lanes);
+            execute(code + block.phiFirstInst[successor], code + block.phiLastInst[successor], lanes);
+        }
+        if (lanes) {
+            pendingGroups.push_back({block.successors[successor], lanes});
+        }
+    }
+
+    int64_t *row(unsigned reg) {
+        return registers.data() + (size_t) reg * laneCount;
+    }
+
+    const int64_t *row(unsigned reg) const {
+        return registers.data() + (size_t) reg * laneCount;
+    }
+
+    LaneMask toLaneMask(const int64_t *values) const {
+        LaneMask mask = 0;
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            mask |= LaneMask(values[lane] != 0) << lane;
+        }
+        return mask;
+    }
+
+    // the lanes that cannot read the operand fail, a row is still returned so the others can go on
+    const int64_t *readLanes(const Operand &operand, LaneMask &lanes, std::vector<int64_t> &immediateRow) {
+        switch (operand.kind) {
+            case OperandKind::Immediate:
+                std::fill(immediateRow.begin(), immediateRow.end(), operand.value);
+                return immediateRow.data();
+            case OperandKind::Slot:
+                if ((assignedSlots[operand.value] & lanes) != lanes) {
+                    failLanes(lanes & ~assignedSlots[operand.value],
+                              "Variable " + function.getSlotName(operand.value) + " not found in variablesMap");
+                    lanes &= assignedSlots[operand.value];
+                }
+                return row(operand.value);
+            case OperandKind::Unsupported:
+                failLanes(lanes, "Unsupported value " + function.getUnsupportedValue(operand.value));
+                lanes = 0;
+                return immediateRow.data();
+            case OperandKind::Temporary:
+            default:
+                return row(operand.value);
+        }
+    }
+
+    /**
+     * Division kernels only evaluate the lanes of the mask, an inactive lane must not trap. When an active lane
+     * does, the lanes are evaluated one by one with the scalar kernel to fail only the lanes that throw.
+     */
+    void evaluateBinaryOperation(const DecodedInst *inst, LaneMask &lanes) {
+        const int64_t *lhs = readLanes(inst->lhs, lanes, immediateLhs);
+        const int64_t *rhs = readLanes(inst->rhs, lanes, immediateRhs);
+        int64_t *dst = row(inst->dst);
+        try {
+            inst->laneKernel(lhs, rhs, dst, laneCount, lanes);
+        } catch (const std::runtime_error &) {
+            for (unsigned lane = 0; lane < laneCount; lane++) {
+                if (!((lanes >> lane) & 1)) {
+                    continue;
+                }
+                try {
+                    dst[lane] = inst->binaryKernel(lhs[lane], rhs[lane]);
+                } catch (const std::runtime_error &error) {
+                    failLanes(LaneMask(1) << lane, error.what());
+                    lanes &= ~(LaneMask(1) << lane);
+                }
+            }
+        }
+    }
+
+    void applyStore(const DecodedInst *inst, LaneMask &lanes) {
+        const int64_t *value = readLanes(inst->lhs, lanes, immediateLhs);
+        int64_t *dst = row(inst->dst);
+        const int64_t *active = activeLanes.data();
+        for (unsigned i = 0; i < laneCount; i++) {
+            dst[i] = (value[i] & active[i]) | (dst[i] & ~active[i]);
+        }
+        assignedSlots[inst->dst] |= lanes;
+    }
+
+    void applyCopy(const DecodedInst *inst, LaneMask &lanes) {
+        const int64_t *value = readLanes(inst->lhs, lanes, immediateLhs);
+        std::copy(value, value + laneCount, row(inst->dst));
+    }
+
+    void evaluateComparison(const DecodedInst *inst, LaneMask &lanes) {
+        const int64_t *lhs = readLanes(inst->lhs, lanes, immediateLhs);
+        const int64_t *rhs = readLanes(inst->rhs, lanes, immediateRhs);
+        int64_t *dst = row(inst->dst);
+        try {
+            inst->laneKernel(lhs, rhs, dst, laneCount, lanes);
+        } catch (const std::runtime_error &error) {
+            // an unknown predicate throws for every lane
+            failLanes(lanes, error.what());
+            lanes = 0;
+        }
+
+        for (unsigned lane = 0; lane < laneCount; lane++) {
+            if ((lanes >> lane) & 1) {
+                cmpRecords[lane].push_back({inst->cmpInst, dst[lane] != 0});
+            }
+        }
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BATCHPATHNAVIGATOR_H
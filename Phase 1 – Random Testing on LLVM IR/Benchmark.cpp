@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <cstdlib>
+#include <random>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Benchmark.h"
+#include "BatchPathNavigator.h"
+#include "CompiledFunction.h"
+#include "JitNavigator.h"
+#include "ModuleLoader.h"
+#include "PathNavigator.h"
+#include "RandomCampaign.h"
+
+using namespace llvm;
+
+static cl::OptionCategory benchmarkCategory("Benchmark options");
+
+static cl::list<std::string> inputFilenames(
+        cl::Positional, cl::desc("<input .ll or .bc files>"), cl::OneOrMore, cl::cat(benchmarkCategory)
+);
+
+static cl::opt<double> minTime(
+        "min-time",
+        cl::desc("Minimum number of seconds the measured round of a benchmark runs"),
+        cl::init(0.5),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<std::string> filter(
+        "filter",
+        cl::desc("Only run the benchmarks whose name contains the text"),
+        cl::value_desc("text"),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed of the benchmarked inputs"),
+        cl::cat(benchmarkCategory)
+);
+
+// random inputs a navigation benchmark cycles through, drawn before the timing starts
+static const unsigned INPUT_SETS = 1024;
+
+// the ranges and budget of the random tester
+static const int MIN_RANGE = -100;
+static const int MAX_RANGE = 100;
+static const ExecutionBudget BUDGET{100000, 0};
+
+std::vector<std::vector<int>> drawInputSets(size_t inputCount) {
+    std::vector<std::vector<int>> inputSets(INPUT_SETS, std::vector<int>(inputCount));
+    for (auto &inputValues: inputSets) {
+        for (auto &value: inputValues) {
+            value = randomInRange(MIN_RANGE, MAX_RANGE);
+        }
+    }
+    return inputSets;
+}
+
+// navigates the input sets in turn with a reused navigator, the way a campaign worker does
+template<typename Navigator>
+void benchmarkNavigator(BenchmarkRunner &runner, const std::string &name, const std::string &input,
+                        Navigator &navigator, const std::vector<int> &inputSlots) {
+    auto inputSets = drawInputSets(inputSlots.size());
+    size_t nextInputSet = 0;
+    runner.run(name, input, "", [&] {
+        const std::vector<int> &inputValues = inputSets[nextInputSet++ % INPUT_SETS];
+        navigator.reset();
+        for (size_t i = 0; i < inputSlots.size(); i++) {
+            if (inputSlots[i] >= 0) {
+                navigator.setArgument(inputSlots[i], inputValues[i]);
+            }
+        }
+        navigator.navigate();
+        return 1;
+    });
+}
+
+void benchmarkFunction(BenchmarkRunner &runner, const std::string &input, Function &function) {
+    auto inputArguments = getInputArguments(function, "a");
+
+    runner.run("CompiledFunction::CompiledFunction", input, "", [&] {
+        CompiledFunction compiledFunction(function);
+        return 1;
+    });
+
+    CompiledFunction compiledFunction(function);
+    std::vector<int> inputSlots;
+    for (auto &variable: inputArguments) {
+        inputSlots.push_back(compiledFunction.getSlot(variable));
+    }
+    PathNavigator pathNavigator(compiledFunction, BUDGET);
+    benchmarkNavigator(runner, "PathNavigator::navigate", input, pathNavigator, inputSlots);
+
+    std::vector<std::map<std::string, int64_t>> argumentsMaps;
+    for (unsigned lane = 0; lane < BatchPathNavigator::MAX_LANES; lane++) {
+        argumentsMaps.push_back(randomInitialize(inputArguments, MIN_RANGE, MAX_RANGE));
+    }
+    // an operation is the navigation of one lane
+    runner.run("BatchPathNavigator::navigate", input, "lanes=" + std::to_string(argumentsMaps.size()), [&] {
+        BatchPathNavigator batchNavigator(compiledFunction, argumentsMaps, BUDGET);
+        batchNavigator.navigate();
+        return batchNavigator.getLaneCount();
+    });
+
+    if (runner.isEnabled("JitNavigator::navigate")) {
+        try {
+            JitFunction jitFunction(function, inputArguments);
+            std::vector<int> jitInputSlots;
+            for (auto &variable: inputArguments) {
+                jitInputSlots.push_back(jitFunction.getInputSlot(variable));
+            }
+            JitNavigator jitNavigator(jitFunction, BUDGET);
+            benchmarkNavigator(runner, "JitNavigator::navigate", input, jitNavigator, jitInputSlots);
+        } catch (const std::runtime_error &error) {
+            errs() << input << ": JitNavigator::navigate skipped: " << error.what() << "\n";
+        }
+    }
+
+    CampaignOptions options{1, BUDGET, 10000, 0, MIN_RANGE, MAX_RANGE, getMasterSeed()};
+    runner.run("RandomCampaign::run", input, "iterations=" + std::to_string(options.iterations), [&] {
+        RandomCampaign campaign(compiledFunction, inputArguments, options, [](const NavigationResult &) {});
+        campaign.run();
+        return 1;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(benchmarkCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Benchmarks of the random tester\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
+
+    BenchmarkRunner runner(minTime, filter, outs());
+    for (auto &inputFilename: inputFilenames) {
+        LLVMContext context;
+        ModuleLoader moduleLoader;
+        std::unique_ptr<Module> M;
+        Function *mainFunction;
+        try {
+            M = moduleLoader.load(inputFilename, context);
+            mainFunction = M->getFunction("main");
+            if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+                fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+                return EXIT_FAILURE;
+            }
+            moduleLoader.materialize(*mainFunction);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+
+        benchmarkFunction(runner, inputFilename, *mainFunction);
+    }
+    return 0;
+}
@@ -0,0 +1,392 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BLOCKSUMMARY_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BLOCKSUMMARY_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+
+#include "IntegerKernels.h"
+
+using namespace llvm;
+
+enum class ValueKind : uint8_t {
+    // Example: 5
+    Constant,
+    // Example: a
+    Load,
+    // Example: a + 5, or (long) a, an integer cast being an operation whose second operand is unused
+    BinaryOperation,
+    // Example: %a1, %x.0 or %add, an SSA value read from its own slot
+    Register,
+    // Example: a call or a select, evaluating it throws
+    Unsupported,
+};
+
+struct ValueSummary {
+    ValueKind kind;
+    Value *value;
+    // only for Constant
+    int64_t constant;
+    // only for Load, the loaded variable
+    Value *pointer;
+    // only for Load and Register, the slot of the variable or of the SSA value in BlockSummaryTable
+    unsigned slot;
+    // only for BinaryOperation, index in BlockSummaryTable::getBinaryOperation
+    unsigned binaryOperation;
+};
+
+struct BinaryOperationSummary {
+    // of the binary operator or of the cast (sext, zext or trunc)
+    unsigned opCode;
+    ValueSummary operands[2];
+    // for the width of the operation
+    BinaryKernels kernels;
+};
+
+// a = value, or the definition of an SSA value kept in a slot, where pointer is the defining instruction
+struct StoreSummary {
+    Value *pointer;
+    unsigned slot;
+    ValueSummary value;
+};
+
+struct BlockSummary {
+    BasicBlock *basicBlock;
+    // stores and SSA definitions in program order
+    std::vector<StoreSummary> stores;
+    // phis of successors[i] with their incoming value from this block, every value is read before a phi is written
+    std::vector<StoreSummary> phiStores[2];
+    // comparison the branch depends on, the first comparison of the block if the branch condition is not one,
+    // nullptr if the block has none
+    ICmpInst *cmpInst;
+    // the block ends in a conditional branch on cmpInst, a block with several successors that does not (a switch,
+    // or a branch on another value) can not be navigated
+    bool isCmpBranch;
+    ValueSummary cmpOperands[2];
+    // for the predicate of cmpInst
+    CompareKernels cmpKernels;
+    unsigned numberOfSuccessors;
+    // block indices of the first two successors
+    unsigned successors[2];
+    // loop index if the edge to successors[i] is a back edge of that loop, -1 otherwise
+    int backEdgeLoops[2];
+};
+
+/**
+ * @brief Per-block table of a function, built once so navigations never rescan instructions
+ *
+ * For every block it keeps the stores in program order, the comparison of the branch, the successor indices
+ * and which of the successor edges are loop back edges. Store values and comparison operands are classified
+ * as constant, load, register or operation (a binary operation or an integer cast), and the operands of every
+ * reachable operation are classified the same way. Any other value, like a call or a select, is unsupported: a
+ * variable or phi assigned one has no value until it is assigned again, and a navigation that evaluates one
+ * throws.
+ *
+ * Values are numbered by their llvm::Value, not by name, so unnamed values and optimized (SSA) functions are
+ * supported. Every variable (an alloca or any other loaded or stored pointer), integer parameter and integer
+ * phi gets a slot, and so does every operation that is used by another one, by a phi or in another block: it
+ * is defined by a store to its own slot where it is computed, a phi is assigned on the edge the block is entered
+ * through. The other operations, like all of those of -O0 code, are evaluated where they are used. Parameters
+ * are numbered first, then allocas, phis and definitions in function order and the other pointers by first
+ * appearance, so navigations keep every value in a flat array.
+ *
+ * Values are integers of their own width, kept as IntegerKernels.h describes, and the kernels of every
+ * operation and comparison are selected here, for its width and signedness.
+ */
+class BlockSummaryTable {
+private:
+    std::vector<BlockSummary> blocks;
+    std::vector<BinaryOperationSummary> binaryOperations;
+    std::map<const BasicBlock *, unsigned> blockIndexOf;
+    std::map<const Value *, unsigned> slotOfValue;
+    std::vector<const Value *> slotValues;
+    std::vector<unsigned> slotBits;
+    std::vector<std::string> slotNames;
+    std::map<std::string, unsigned> slotOfName;
+    std::vector<BasicBlock *> loopHeaders;
+
+    unsigned getOrCreateSlot(const Value *value) {
+        auto it = slotOfValue.find(value);
+        if (it != slotOfValue.end()) {
+            return it->second;
+        }
+        slotOfValue[value] = slotValues.size();
+        slotValues.push_back(value);
+        slotBits.push_back(getIntegerBits(value));
+        return slotValues.size() - 1;
+    }
+
+    // width of the integer a value or the variable it points to holds, 0 if it is no integer of up to 64 bits
+    static unsigned getIntegerBits(const Value *value) {
+        Type *type = value->getType();
+        if (auto *allocaInst = dyn_cast<AllocaInst>(value)) {
+            type = allocaInst->getAllocatedType();
+        } else if (auto *globalVariable = dyn_cast<GlobalVariable>(value)) {
+            type = globalVariable->getValueType();
+        }
+        return type->isIntegerTy() && type->getIntegerBitWidth() <= 64 ? type->getIntegerBitWidth() : 0;
+    }
+
+    // the integer casts that are modeled, like (long) a or (char) a
+    static bool isIntegerCast(const Value *value) {
+        auto *castInst = dyn_cast<CastInst>(value);
+        return castInst != nullptr && castInst->getType()->isIntegerTy() &&
+               (castInst->getOpcode() == Instruction::SExt || castInst->getOpcode() == Instruction::ZExt ||
+                castInst->getOpcode() == Instruction::Trunc);
+    }
+
+    // a binary operation or an integer cast
+    static bool isOperation(const Value *value) {
+        return isa<BinaryOperator>(value) || isIntegerCast(value);
+    }
+
+    // evaluated at every use, such an operation would be computed once per use and with operands that may have
+    // changed since it ran
+    static bool isKeptInSlot(const Instruction *operation) {
+        if (!operation->getType()->isIntegerTy()) {
+            return false;
+        }
+        for (const User *user: operation->users()) {
+            auto *userInst = dyn_cast<Instruction>(user);
+            if (userInst == nullptr || isa<PHINode>(userInst) || isOperation(userInst) ||
+                userInst->getParent() != operation->getParent()) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void numberValues(Function &function) {
+        for (auto &argument: function.args()) {
+            if (argument.getType()->isIntegerTy()) {
+                getOrCreateSlot(&argument);
+            }
+        }
+        for (auto &BB: function) {
+            for (auto &I: BB) {
+                if (isa<AllocaInst>(&I) || (isa<PHINode>(&I) && I.getType()->isIntegerTy()) ||
+                    (isOperation(&I) && isKeptInSlot(&I))) {
+                    getOrCreateSlot(&I);
+                }
+            }
+        }
+    }
+
+    // parameters, phis and the operations kept in a slot, pointers are never registers
+    bool isRegister(const Value *value) const {
+        return (isa<Argument>(value) || isa<PHINode>(value) || isOperation(value)) &&
+               value->getType()->isIntegerTy() && slotOfValue.find(value) != slotOfValue.end();
+    }
+
+    ValueSummary summarize(Value *value) {
+        ValueSummary summary{ValueKind::Unsupported, value, 0, nullptr, 0, 0};
+        if (auto *constantInt = dyn_cast<ConstantInt>(value)) {
+            summary.kind = ValueKind::Constant;
+            summary.constant = constantInt->getSExtValue();
+        } else if (auto *loadInst = dyn_cast<LoadInst>(value)) {
+            summary.kind = ValueKind::Load;
+            summary.pointer = loadInst->getPointerOperand();
+            summary.slot = getOrCreateSlot(summary.pointer);
+        } else if (isRegister(value)) {
+            summary.kind = ValueKind::Register;
+            summary.slot = slotOfValue[value];
+        } else if (isOperation(value)) {
+            summary.kind = ValueKind::BinaryOperation;
+            summary.binaryOperation = summarizeOperation(dyn_cast<Instruction>(value));
+        }
+        return summary;
+    }
+
+    unsigned summarizeOperation(Instruction *operation) {
+        BinaryOperationSummary binaryOperation;
+        binaryOperation.opCode = operation->getOpcode();
+        binaryOperation.operands[0] = summarize(operation->getOperand(0));
+        if (auto *binaryOperator = dyn_cast<BinaryOperator>(operation)) {
+            binaryOperation.operands[1] = summarize(binaryOperator->getOperand(1));
+            binaryOperation.kernels = selectBinaryKernels(binaryOperator->getOpcode(), binaryOperator->getType());
+        } else {
+            auto *castInst = dyn_cast<CastInst>(operation);
+            binaryOperation.operands[1] = {ValueKind::Constant, nullptr, 0, nullptr, 0, 0};
+            binaryOperation.kernels = selectCastKernels(castInst->getOpcode(), castInst->getSrcTy(),
+                                                        castInst->getDestTy());
+        }
+        binaryOperations.push_back(binaryOperation);
+        return binaryOperations.size() - 1;
+    }
+
+    void summarizeBlock(BasicBlock &BB, BlockSummary &block) {
+        for (auto &I: BB) {
+            if (auto *storeInst = dyn_cast<StoreInst>(&I)) {
+                Value *pointer = storeInst->getPointerOperand();
+                // the parameter copies of -O0 code, x.addr = x, where the alloca is the input
+                if (isa<Argument>(storeInst->getValueOperand()) && isa<AllocaInst>(pointer)) {
+                    continue;
+                }
+                block.stores.push_back({pointer, getOrCreateSlot(pointer), summarize(storeInst->getValueOperand())});
+            } else if (isOperation(&I) && isRegister(&I)) {
+                ValueSummary definition{ValueKind::BinaryOperation, &I, 0, nullptr, 0, summarizeOperation(&I)};
+                block.stores.push_back({&I, slotOfValue[&I], definition});
+            }
+        }
+
+        Instruction *terminatorInst = BB.getTerminator();
+        auto *branchInst = dyn_cast<BranchInst>(terminatorInst);
+        block.cmpInst = branchInst != nullptr && branchInst->isConditional()
+                        ? dyn_cast<ICmpInst>(branchInst->getCondition()) : nullptr;
+        block.isCmpBranch = block.cmpInst != nullptr;
+        for (auto it = BB.begin(); block.cmpInst == nullptr && it != BB.end(); ++it) {
+            block.cmpInst = dyn_cast<ICmpInst>(&*it);
+        }
+        if (block.cmpInst != nullptr) {
+            block.cmpOperands[0] = summarize(block.cmpInst->getOperand(0));
+            block.cmpOperands[1] = summarize(block.cmpInst->getOperand(1));
+            block.cmpKernels = selectCompareKernels(block.cmpInst->getPredicate());
+        }
+
+        block.numberOfSuccessors = terminatorInst->getNumSuccessors();
+        for (unsigned i = 0; i < 2 && i < block.numberOfSuccessors; i++) {
+            BasicBlock *successor = terminatorInst->getSuccessor(i);
+            block.successors[i] = blockIndexOf[successor];
+            for (auto &phi: successor->phis()) {
+                // like a store of an unsupported value, a phi that gets one (e.g. undef or a call) has no value
+                if (isRegister(&phi)) {
+                    block.phiStores[i].push_back({&phi, slotOfValue[&phi],
+                                                  summarize(phi.getIncomingValueForBlock(&BB))});
+                }
+            }
+        }
+    }
+
+    // unnamed values are numbered like the IR printer does (%0, %1, ...), with one slot tracker for the function
+    void nameSlots(Function &function) {
+        std::unique_ptr<ModuleSlotTracker> slotTracker;
+        for (const Value *value: slotValues) {
+            std::string name = value->getName().str();
+            if (name.empty()) {
+                if (slotTracker == nullptr) {
+                    slotTracker = std::make_unique<ModuleSlotTracker>(function.getParent(), false);
+                    slotTracker->incorporateFunction(function);
+                }
+                raw_string_ostream stream(name);
+                value->printAsOperand(stream, false, *slotTracker);
+                stream.flush();
+            }
+            slotOfName.insert({name, slotNames.size()});
+            slotNames.push_back(name);
+        }
+    }
+
+    // an edge is a back edge of a loop when it enters the loop header from inside the loop
+    void findBackEdges(Function &function) {
+        DominatorTree dominatorTree(function);
+        LoopInfo loopInfo(dominatorTree);
+
+        std::map<const Loop *, int> loopIndexOf;
+        for (Loop *loop: loopInfo.getLoopsInPreorder()) {
+            loopIndexOf[loop] = loopHeaders.size();
+            loopHeaders.push_back(loop->getHeader());
+        }
+
+        for (auto &block: blocks) {
+            block.backEdgeLoops[0] = block.backEdgeLoops[1] = -1;
+            for (unsigned i = 0; i < 2 && i < block.numberOfSuccessors; i++) {
+                BasicBlock *successor = blocks[block.successors[i]].basicBlock;
+                Loop *loop = loopInfo.getLoopFor(successor);
+                if (loop != nullptr && loop->getHeader() == successor && loop->contains(block.basicBlock)) {
+                    block.backEdgeLoops[i] = loopIndexOf[loop];
+                }
+            }
+        }
+    }
+
+public:
+    explicit BlockSummaryTable(Function &function) {
+        for (auto &BB: function) {
+            blockIndexOf[&BB] = blocks.size();
+            blocks.emplace_back();
+            blocks.back().basicBlock = &BB;
+        }
+
+        numberValues(function);
+        unsigned index = 0;
+        for (auto &BB: function) {
+            summarizeBlock(BB, blocks[index++]);
+        }
+        nameSlots(function);
+
+        findBackEdges(function);
+    }
+
+    const std::vector<BlockSummary> &getBlocks() const {
+        return blocks;
+    }
+
+    const BlockSummary &getBlock(unsigned block) const {
+        return blocks[block];
+    }
+
+    // the entry block is always summarized first
+    static unsigned getEntryIndex() {
+        return 0;
+    }
+
+    unsigned getBlockIndex(const BasicBlock *basicBlock) const {
+        return blockIndexOf.at(basicBlock);
+    }
+
+    const BinaryOperationSummary &getBinaryOperation(unsigned binaryOperation) const {
+        return binaryOperations[binaryOperation];
+    }
+
+    unsigned getSlotCount() const {
+        return slotNames.size();
+    }
+
+    const std::string &getSlotName(unsigned slot) const {
+        return slotNames[slot];
+    }
+
+    // the variable, parameter, phi or operation the slot holds
+    const Value *getSlotValue(unsigned slot) const {
+        return slotValues[slot];
+    }
+
+    // 0 for a slot that holds no integer of up to 64 bits
+    unsigned getSlotBits(unsigned slot) const {
+        return slotBits[slot];
+    }
+
+    int getSlot(const std::string &variableName) const {
+        auto it = slotOfName.find(variableName);
+        return it == slotOfName.end() ? -1 : (int) it->second;
+    }
+
+    // false for the operations kept in a slot, they are intermediate results and not variables
+    bool isVariableSlot(unsigned slot) const {
+        return !isOperation(slotValues[slot]);
+    }
+
+    unsigned getLoopCount() const {
+        return loopHeaders.size();
+    }
+
+    BasicBlock *getLoopHeader(unsigned loop) const {
+        return loopHeaders[loop];
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_BLOCKSUMMARY_H
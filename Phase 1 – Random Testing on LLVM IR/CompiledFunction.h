@@ -0,0 +1,364 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_COMPILEDFUNCTION_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_COMPILEDFUNCTION_H
+
+#include <cstdio>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cstdlib>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/ModuleSlotTracker.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "BlockSummary.h"
+#include "Instrumentation.h"
+#include "Utils.h"
+
+using namespace llvm;
+
+enum class OpCode : uint8_t {
+    // registers[dst] = binaryKernel(lhs, rhs)
+    Binary,
+    // registers[dst] = lhs, where dst is a variable slot or the slot of an SSA value
+    Store,
+    // registers[dst] = lhs, where dst is a temporary
+    Copy,
+    // registers[dst] = compareKernel(lhs, rhs), recorded as a comparison of the path
+    ICmp,
+    // the slot dst was assigned a value that is not modeled, it has none until it is assigned again
+    Clear,
+};
+
+enum class OperandKind : uint8_t {
+    Immediate,
+    // slot of a variable or an SSA value, must be assigned before it is read
+    Slot,
+    // result of a previous Binary or Copy of the same block or edge
+    Temporary,
+    // a value that is not modeled, reading it throws, value indexes getUnsupportedValue
+    Unsupported,
+};
+
+struct Operand {
+    OperandKind kind;
+    // immediate value or register index
+    int64_t value;
+};
+
+struct DecodedInst {
+    OpCode opCode;
+    // of the width and signedness of the instruction, binaryKernel for Binary and compareKernel for ICmp
+    union {
+        BinaryKernel binaryKernel;
+        CompareKernel compareKernel;
+    };
+    // the same operation for a row of lanes, only for Binary and ICmp
+    LaneKernel laneKernel;
+    unsigned dst;
+    Operand lhs;
+    Operand rhs;
+    ICmpInst *cmpInst;
+};
+
+enum class TerminatorKind : uint8_t {
+    Exit,
+    Jump,
+    Branch,
+    // several successors but no branch on the block comparison, like a switch, navigating through it throws
+    Unsupported,
+};
+
+struct DecodedBlock {
+    BasicBlock *basicBlock;
+    // instructions of the block are code[firstInst, lastInst)
+    unsigned firstInst;
+    unsigned lastInst;
+    TerminatorKind terminator;
+    // register holding the result of the block comparison, only for Branch
+    unsigned conditionReg;
+    // block indices, successors[0] is taken when the comparison is true
+    unsigned successors[2];
+    // the phis of successors[i] are assigned by code[phiFirstInst[i], phiLastInst[i]) when that edge is taken
+    unsigned phiFirstInst[2];
+    unsigned phiLastInst[2];
+    // loop index if the edge to successors[i] is a back edge of that loop, -1 otherwise
+    int backEdgeLoops[2];
+};
+
+/**
+ * @brief One-time lowering of a function into a flat, pre-decoded instruction stream.
+ *
+ * Slots are the value numbering of BlockSummaryTable: variables, parameters, phis and the SSA values used
+ * across blocks. They occupy registers [0, getSlotCount()) and temporaries follow them. Operands are
+ * either immediates or register indices, so no name lookup happens while navigating, and every operation
+ * carries the kernels of its width and signedness, so none is dispatched on its opcode either.
+ */
+class CompiledFunction {
+private:
+    std::vector<DecodedInst> code;
+    std::vector<DecodedBlock> blocks;
+    std::vector<std::string> slotNames;
+    std::map<std::string, unsigned> slotOfName;
+    std::vector<bool> variableSlots;
+    std::vector<unsigned> slotBits;
+    std::map<const BasicBlock *, unsigned> blockIndexOf;
+    std::vector<BasicBlock *> loopHeaders;
+    std::vector<std::string> unsupportedValues;
+    unsigned registerCount = 0;
+    // printed names of the blocks, and of every comparison when it held and when it failed, see nameValues
+    std::vector<std::string> blockNames;
+    DenseMap<const ICmpInst *, unsigned> cmpIndexOf;
+    std::vector<std::string> cmpStrings;
+
+    void copySlots(const BlockSummaryTable &summary) {
+        for (unsigned slot = 0; slot < summary.getSlotCount(); slot++) {
+            slotNames.push_back(summary.getSlotName(slot));
+            slotOfName.insert({slotNames.back(), slot});
+            variableSlots.push_back(summary.isVariableSlot(slot));
+            slotBits.push_back(summary.getSlotBits(slot));
+        }
+        registerCount = slotNames.size();
+    }
+
+    Operand lowerOperand(const BlockSummaryTable &summary, const ValueSummary &value) {
+        switch (value.kind) {
+            // Example: 5
+            case ValueKind::Constant:
+                return {OperandKind::Immediate, value.constant};
+            // Example: a, read when the using instruction executes
+            case ValueKind::Load:
+            // Example: %x.0, assigned by its phi or definition
+            case ValueKind::Register:
+                return {OperandKind::Slot, value.slot};
+            // Example: a + 5, evaluated right before the using instruction
+            case ValueKind::BinaryOperation: {
+                const BinaryOperationSummary &binaryOperation = summary.getBinaryOperation(value.binaryOperation);
+                DecodedInst inst{};
+                inst.opCode = OpCode::Binary;
+                inst.binaryKernel = binaryOperation.kernels.scalar;
+                inst.laneKernel = binaryOperation.kernels.lanes;
+                inst.lhs = lowerOperand(summary, binaryOperation.operands[0]);
+                inst.rhs = lowerOperand(summary, binaryOperation.operands[1]);
+                inst.dst = registerCount++;
+                code.push_back(inst);
+                return {OperandKind::Temporary, inst.dst};
+            }
+            case ValueKind::Unsupported:
+            default:
+                unsupportedValues.push_back(valueToString(value.value));
+                return {OperandKind::Unsupported, (int64_t) unsupportedValues.size() - 1};
+        }
+    }
+
+    void lowerBlock(const BlockSummaryTable &summary, const BlockSummary &blockSummary, DecodedBlock &block) {
+        block.firstInst = code.size();
+
+        // stores are applied before the block comparison is evaluated
+        for (auto &store: blockSummary.stores) {
+            DecodedInst inst{};
+            if (store.value.kind == ValueKind::Unsupported) {
+                inst.opCode = OpCode::Clear;
+            } else {
+                inst.opCode = OpCode::Store;
+                inst.lhs = lowerOperand(summary, store.value);
+            }
+            inst.dst = store.slot;
+            code.push_back(inst);
+        }
+
+        // only the first comparison of a block decides the branch
+        if (blockSummary.cmpInst != nullptr) {
+            DecodedInst inst{};
+            inst.opCode = OpCode::ICmp;
+            inst.compareKernel = blockSummary.cmpKernels.scalar;
+            inst.laneKernel = blockSummary.cmpKernels.lanes;
+            inst.lhs = lowerOperand(summary, blockSummary.cmpOperands[0]);
+            inst.rhs = lowerOperand(summary, blockSummary.cmpOperands[1]);
+            inst.dst = registerCount++;
+            inst.cmpInst = blockSummary.cmpInst;
+            code.push_back(inst);
+            block.conditionReg = inst.dst;
+        }
+
+        block.lastInst = code.size();
+
+        if (blockSummary.isCmpBranch) {
+            block.terminator = TerminatorKind::Branch;
+            block.successors[0] = blockSummary.successors[0];
+            block.successors[1] = blockSummary.successors[1];
+        } else if (blockSummary.numberOfSuccessors == 1) {
+            block.terminator = TerminatorKind::Jump;
+            block.successors[0] = blockSummary.successors[0];
+        } else if (blockSummary.numberOfSuccessors == 0) {
+            block.terminator = TerminatorKind::Exit;
+        } else {
+            block.terminator = TerminatorKind::Unsupported;
+        }
+
+        bool hasEdges = block.terminator == TerminatorKind::Branch || block.terminator == TerminatorKind::Jump;
+        for (unsigned i = 0; i < 2 && hasEdges; i++) {
+            block.phiFirstInst[i] = code.size();
+            lowerPhiStores(summary, blockSummary.phiStores[i]);
+            block.phiLastInst[i] = code.size();
+        }
+    }
+
+    // every incoming value is read before a phi is written, a phi of the same edge is copied to a temporary first
+    void lowerPhiStores(const BlockSummaryTable &summary, const std::vector<StoreSummary> &phiStores) {
+        std::vector<Operand> incomingValues;
+        for (auto &phiStore: phiStores) {
+            if (phiStore.value.kind == ValueKind::Unsupported) {
+                incomingValues.push_back({OperandKind::Unsupported, 0});
+                continue;
+            }
+            Operand value = lowerOperand(summary, phiStore.value);
+            bool readsPhi = phiStores.size() > 1 && value.kind == OperandKind::Slot &&
+                            std::any_of(phiStores.begin(), phiStores.end(), [&](const StoreSummary &other) {
+                                return other.slot == value.value;
+                            });
+            if (readsPhi) {
+                DecodedInst inst{};
+                inst.opCode = OpCode::Copy;
+                inst.lhs = value;
+                inst.dst = registerCount++;
+                code.push_back(inst);
+                value = {OperandKind::Temporary, inst.dst};
+            }
+            incomingValues.push_back(value);
+        }
+        for (size_t i = 0; i < phiStores.size(); i++) {
+            DecodedInst inst{};
+            inst.opCode = incomingValues[i].kind == OperandKind::Unsupported ? OpCode::Clear : OpCode::Store;
+            inst.lhs = incomingValues[i];
+            inst.dst = phiStores[i].slot;
+            code.push_back(inst);
+        }
+    }
+
+    /**
+     * @brief Prints the block names and the comparisons of the function once
+     *
+     * Printing an unnamed value numbers the whole function, so every value is printed with one slot tracker here
+     * rather than with its own on each test printed. Every integer comparison is named, not only the block ones,
+     * since JitNavigator records them all.
+     */
+    void nameValues(Function &function) {
+        ModuleSlotTracker slotTracker(function.getParent(), false);
+        slotTracker.incorporateFunction(function);
+        for (auto &block: blocks) {
+            blockNames.push_back(getSimpleNodeName(block.basicBlock, slotTracker));
+        }
+        for (auto &BB: function) {
+            for (auto &I: BB) {
+                auto *cmpInst = dyn_cast<ICmpInst>(&I);
+                if (cmpInst != nullptr && cmpInst->getType()->isIntegerTy()) {
+                    cmpIndexOf[cmpInst] = cmpStrings.size();
+                    cmpStrings.push_back(CmpRecordToString({cmpInst, true}, slotTracker));
+                    cmpStrings.push_back(CmpRecordToString({cmpInst, false}, slotTracker));
+                }
+            }
+        }
+    }
+
+public:
+    explicit CompiledFunction(Function &function) {
+        INSTRUMENT_SCOPE("CompiledFunction::CompiledFunction");
+        // blocks are lowered from the summary table, so they keep its block and slot indices
+        BlockSummaryTable summary(function);
+        copySlots(summary);
+        for (auto &blockSummary: summary.getBlocks()) {
+            blockIndexOf[blockSummary.basicBlock] = blocks.size();
+            DecodedBlock block{};
+            block.basicBlock = blockSummary.basicBlock;
+            blocks.push_back(block);
+        }
+
+        for (unsigned index = 0; index < blocks.size(); index++) {
+            lowerBlock(summary, summary.getBlock(index), blocks[index]);
+            blocks[index].backEdgeLoops[0] = summary.getBlock(index).backEdgeLoops[0];
+            blocks[index].backEdgeLoops[1] = summary.getBlock(index).backEdgeLoops[1];
+        }
+        for (unsigned loop = 0; loop < summary.getLoopCount(); loop++) {
+            loopHeaders.push_back(summary.getLoopHeader(loop));
+        }
+        nameValues(function);
+    }
+
+    const std::vector<DecodedInst> &getCode() const {
+        return code;
+    }
+
+    const std::vector<DecodedBlock> &getBlocks() const {
+        return blocks;
+    }
+
+    // the entry block is always lowered first
+    static unsigned getEntryIndex() {
+        return 0;
+    }
+
+    unsigned getBlockIndex(const BasicBlock *basicBlock) const {
+        return blockIndexOf.at(basicBlock);
+    }
+
+    const std::string &getBlockName(const BasicBlock *basicBlock) const {
+        return blockNames[getBlockIndex(basicBlock)];
+    }
+
+    // the comparison as CmpRecordToString prints it
+    const std::string &getCmpString(const CmpRecord &cmpRecord) const {
+        return cmpStrings[cmpIndexOf.find(cmpRecord.cmpInst)->second + !cmpRecord.result];
+    }
+
+    unsigned getLoopCount() const {
+        return loopHeaders.size();
+    }
+
+    BasicBlock *getLoopHeader(unsigned loop) const {
+        return loopHeaders[loop];
+    }
+
+    unsigned getRegisterCount() const {
+        return registerCount;
+    }
+
+    unsigned getSlotCount() const {
+        return slotNames.size();
+    }
+
+    const std::string &getSlotName(unsigned slot) const {
+        return slotNames[slot];
+    }
+
+    unsigned getSlotBits(unsigned slot) const {
+        return slotBits[slot];
+    }
+
+    int getSlot(const std::string &variableName) const {
+        auto it = slotOfName.find(variableName);
+        return it == slotOfName.end() ? -1 : (int) it->second;
+    }
+
+    // false for the intermediate results kept in a slot
+    bool isVariableSlot(unsigned slot) const {
+        return variableSlots[slot];
+    }
+
+    // the IR of an unsupported operand, for the error of a navigation that reads it
+    const std::string &getUnsupportedValue(unsigned index) const {
+        return unsupportedValues[index];
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_COMPILEDFUNCTION_H
@@ -0,0 +1,84 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_EXECUTIONBUDGET_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_EXECUTIONBUDGET_H
+
+#include <cstdint>
+#include <chrono>
+#include <string>
+
+// limits of a single navigation, 0 means unlimited
+struct ExecutionBudget {
+    uint64_t maxSteps;
+    double maxSeconds;
+};
+
+enum class NavigationStatus {
+    Completed,
+    StepLimitExceeded,
+    TimeLimitExceeded,
+    // the navigation threw, only reported by engines that keep going without it, like the lanes of a batch
+    Error,
+};
+
+std::string navigationStatusToString(NavigationStatus status) {
+    switch (status) {
+        case NavigationStatus::Completed:
+            return "completed";
+        case NavigationStatus::StepLimitExceeded:
+            return "timeout (step limit exceeded)";
+        case NavigationStatus::TimeLimitExceeded:
+            return "timeout (time limit exceeded)";
+        case NavigationStatus::Error:
+            return "error";
+        default:
+            return "unknown";
+    }
+}
+
+/**
+ * @brief Counts the blocks entered by a navigation and checks them against an ExecutionBudget
+ *
+ * The clock is only read every CLOCK_CHECK_INTERVAL steps to keep the check cheap.
+ */
+class BudgetTracker {
+private:
+    static const uint64_t CLOCK_CHECK_INTERVAL = 1024;
+
+    ExecutionBudget budget;
+    std::chrono::steady_clock::time_point deadline;
+    uint64_t steps = 0;
+
+public:
+    explicit BudgetTracker(const ExecutionBudget &budget) : budget(budget) {
+        restart();
+    }
+
+    // starts counting a new navigation with the same budget
+    void restart() {
+        steps = 0;
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>(budget.maxSeconds));
+    }
+
+    /**
+     * @brief Counts one more step
+     * @return Completed while the navigation is still within its budget
+     */
+    NavigationStatus step() {
+        steps++;
+        if (budget.maxSteps > 0 && steps > budget.maxSteps) {
+            return NavigationStatus::StepLimitExceeded;
+        }
+        if (budget.maxSeconds > 0 && steps % CLOCK_CHECK_INTERVAL == 0 &&
+            std::chrono::steady_clock::now() >= deadline) {
+            return NavigationStatus::TimeLimitExceeded;
+        }
+        return NavigationStatus::Completed;
+    }
+
+    uint64_t getSteps() const {
+        return steps;
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_EXECUTIONBUDGET_H
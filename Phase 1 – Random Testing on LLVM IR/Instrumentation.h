@@ -0,0 +1,312 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INSTRUMENTATION_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INSTRUMENTATION_H
+
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
+#include "llvm/Support/MathExtras.h"
+#include "llvm/Support/raw_ostream.h"
+
+using namespace llvm;
+
+/**
+ * Scoped timers, counters and histograms of the hot paths.
+ *
+ * They are only compiled in when INSTRUMENTATION is defined (cmake -DINSTRUMENTATION=ON), otherwise the macros
+ * expand to nothing and their arguments are not evaluated:
+ *
+ *   INSTRUMENT_SCOPE("Solver::solve");                           times the rest of the enclosing block
+ *   INSTRUMENT_COUNT("Chromosome::getFitness", 1);               adds to a counter
+ *   INSTRUMENT_HISTOGRAM("DseTester::pathLength", path.size());  records a sample
+ *
+ * Names are string literals, every site with the same name adds to the same statistics. Each thread records
+ * into its own buffers, which are only read by printSummary and writeTrace once the instrumented threads are
+ * done. With tracing on, every timed scope is also kept as a Chrome trace event (up to MAX_TRACE_EVENTS per
+ * thread), writeTrace saves them for chrome://tracing or https://ui.perfetto.dev.
+ */
+
+enum class InstrumentKind {
+    Timer,
+    Counter,
+    Histogram,
+};
+
+// nanoseconds of a timer, increments of a counter or samples of a histogram
+struct InstrumentStatistics {
+    uint64_t count = 0;
+    uint64_t sum = 0;
+    uint64_t min = UINT64_MAX;
+    uint64_t max = 0;
+    // bucket b counts the values below 2^b and not below 2^(b-1), bucket 0 the zeros
+    uint64_t buckets[65] = {};
+
+    void add(uint64_t value) {
+        count++;
+        sum += value;
+        min = std::min(min, value);
+        max = std::max(max, value);
+        buckets[value == 0 ? 0 : 64 - countLeadingZeros(value)]++;
+    }
+
+    void merge(const InstrumentStatistics &other) {
+        count += other.count;
+        sum += other.sum;
+        min = std::min(min, other.min);
+        max = std::max(max, other.max);
+        for (unsigned bucket = 0; bucket < 65; bucket++) {
+            buckets[bucket] += other.buckets[bucket];
+        }
+    }
+
+    // upper bound of the nearest-rank percentile, within a factor of two
+    uint64_t getPercentile(double fraction) const {
+        uint64_t rank = std::max<uint64_t>((uint64_t) std::ceil(fraction * count), 1), seen = 0;
+        for (unsigned bucket = 0; bucket < 65; bucket++) {
+            seen += buckets[bucket];
+            if (seen >= rank) {
+                return bucket == 0 ? 0 : std::min<uint64_t>(bucket == 64 ? UINT64_MAX : (1ull << bucket) - 1, max);
+            }
+        }
+        return max;
+    }
+};
+
+struct TraceEvent {
+    unsigned site;
+    // since the start of the process
+    uint64_t startNanoseconds;
+    uint64_t durationNanoseconds;
+};
+
+// statistics and trace events of one thread
+struct ThreadRecorder {
+    unsigned threadId;
+    std::vector<InstrumentStatistics> statistics;
+    std::vector<TraceEvent> events;
+    uint64_t droppedEvents = 0;
+
+    explicit ThreadRecorder(unsigned threadId) : threadId(threadId) {}
+
+    InstrumentStatistics &getStatistics(unsigned site) {
+        if (site >= statistics.size()) {
+            statistics.resize(site + 1);
+        }
+        return statistics[site];
+    }
+};
+
+class Instrumentation {
+private:
+    struct Site {
+        const char *name;
+        InstrumentKind kind;
+    };
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::atomic<bool> tracing{false};
+
+    std::mutex mutex;
+    std::vector<Site> sites;
+    // never freed, the recorders of finished threads are still reported
+    std::vector<std::unique_ptr<ThreadRecorder>> recorders;
+
+    ThreadRecorder *createRecorder() {
+        std::lock_guard<std::mutex> lock(mutex);
+        recorders.push_back(std::make_unique<ThreadRecorder>((unsigned) recorders.size() + 1));
+        return recorders.back().get();
+    }
+
+    std::vector<InstrumentStatistics> mergeStatistics() {
+        std::vector<InstrumentStatistics> merged(sites.size());
+        for (auto &recorder: recorders) {
+            for (size_t site = 0; site < recorder->statistics.size(); site++) {
+                merged[site].merge(recorder->statistics[site]);
+            }
+        }
+        return merged;
+    }
+
+public:
+#ifdef INSTRUMENTATION
+    static const bool ENABLED = true;
+#else
+    static const bool ENABLED = false;
+#endif
+    static const size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    static Instrumentation &get() {
+        static Instrumentation instrumentation;
+        return instrumentation;
+    }
+
+    static ThreadRecorder &threadRecorder() {
+        thread_local ThreadRecorder *recorder = get().createRecorder();
+        return *recorder;
+    }
+
+    // a site registered again with the same name gets the same id
+    unsigned registerSite(const char *name, InstrumentKind kind) {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (unsigned site = 0; site < sites.size(); site++) {
+            if (std::strcmp(sites[site].name, name) == 0) {
+                return site;
+            }
+        }
+        sites.push_back({name, kind});
+        return (unsigned) sites.size() - 1;
+    }
+
+    void setTracing(bool enabled) {
+        tracing.store(enabled, std::memory_order_relaxed);
+    }
+
+    bool isTracing() const {
+        return tracing.load(std::memory_order_relaxed);
+    }
+
+    uint64_t getNanoseconds() const {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start)
+                .count();
+    }
+
+    /**
+     * @brief Prints the merged statistics of every site that recorded something, sorted by name
+     */
+    void printSummary(raw_ostream &out) {
+        std::lock_guard<std::mutex> lock(mutex);
+        std::vector<InstrumentStatistics> statistics = mergeStatistics();
+        std::vector<unsigned> order;
+        for (unsigned site = 0; site < sites.size(); site++) {
+            if (statistics[site].count > 0) {
+                order.push_back(site);
+            }
+        }
+        if (order.empty()) {
+            return;
+        }
+        std::sort(order.begin(), order.end(), [&](unsigned site1, unsigned site2) {
+            return std::strcmp(sites[site1].name, sites[site2].name) < 0;
+        });
+
+        out << "*************** Instrumentation ****************" << "\n";
+        for (unsigned site: order) {
+            const InstrumentStatistics &s = statistics[site];
+            out << sites[site].name << ": ";
+            switch (sites[site].kind) {
+                case InstrumentKind::Timer:
+                    out << s.count << " calls, " << format("%.3f", s.sum / 1e6) << " ms, mean "
+                        << format("%.3f", (double) s.sum / s.count / 1e3) << " us, p99 <= "
+                        << format("%.3f", s.getPercentile(0.99) / 1e3) << " us, max "
+                        << format("%.3f", s.max / 1e3) << " us\n";
+                    break;
+                case InstrumentKind::Counter:
+                    out << s.sum << "\n";
+                    break;
+                case InstrumentKind::Histogram:
+                    out << s.count << " samples, min " << s.min << ", mean "
+                        << format("%.1f", (double) s.sum / s.count) << ", p50 <= " << s.getPercentile(0.5)
+                        << ", p99 <= " << s.getPercentile(0.99) << ", max " << s.max << "\n";
+                    break;
+            }
+        }
+        uint64_t droppedEvents = 0;
+        for (auto &recorder: recorders) {
+            droppedEvents += recorder->droppedEvents;
+        }
+        if (droppedEvents > 0) {
+            out << "Dropped trace events: " << droppedEvents << "\n";
+        }
+    }
+
+    /**
+     * @brief Writes the timed scopes in the Chrome trace event format, one track per thread
+     * @throws std::runtime_error if the file can not be written
+     */
+    void writeTrace(const std::string &filename) {
+        std::error_code errorCode;
+        raw_fd_ostream out(filename, errorCode, sys::fs::OF_None);
+        if (errorCode) {
+            throw std::runtime_error("failed to open \"" + filename + "\": " + errorCode.message());
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        out << "{\"traceEvents\":[";
+        bool isFirst = true;
+        for (auto &recorder: recorders) {
+            out << (isFirst ? "\n" : ",\n") << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":"
+                << recorder->threadId << ",\"args\":{\"name\":\"thread " << recorder->threadId << "\"}}";
+            isFirst = false;
+            for (auto &event: recorder->events) {
+                out << ",\n{\"name\":\"" << sites[event.site].name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":"
+                    << recorder->threadId << ",\"ts\":" << format("%.3f", event.startNanoseconds / 1e3)
+                    << ",\"dur\":" << format("%.3f", event.durationNanoseconds / 1e3) << "}";
+            }
+        }
+        out << "\n],\"displayTimeUnit\":\"ns\"}\n";
+        out.close();
+        if (out.has_error()) {
+            out.clear_error();
+            throw std::runtime_error("failed to write \"" + filename + "\"");
+        }
+    }
+};
+
+// times its scope into a timer site
+class ScopedTimer {
+private:
+    const unsigned site;
+    const uint64_t startNanoseconds;
+
+public:
+    explicit ScopedTimer(unsigned site) : site(site), startNanoseconds(Instrumentation::get().getNanoseconds()) {}
+
+    ScopedTimer(const ScopedTimer &) = delete;
+
+    ScopedTimer &operator=(const ScopedTimer &) = delete;
+
+    ~ScopedTimer() {
+        Instrumentation &instrumentation = Instrumentation::get();
+        uint64_t duration = instrumentation.getNanoseconds() - startNanoseconds;
+        ThreadRecorder &recorder = Instrumentation::threadRecorder();
+        recorder.getStatistics(site).add(duration);
+        if (instrumentation.isTracing()) {
+            if (recorder.events.size() < Instrumentation::MAX_TRACE_EVENTS) {
+                recorder.events.push_back({site, startNanoseconds, duration});
+            } else {
+                recorder.droppedEvents++;
+            }
+        }
+    }
+};
+
+#ifdef INSTRUMENTATION
+#define INSTRUMENT_CONCAT_(a, b) a##b
+#define INSTRUMENT_CONCAT(a, b) INSTRUMENT_CONCAT_(a, b)
+// registers a site once per expansion
+#define INSTRUMENT_SITE(name, kind) \
+    ([]() { static const unsigned site = Instrumentation::get().registerSite(name, kind); return site; }())
+#define INSTRUMENT_SCOPE(name) \
+    ScopedTimer INSTRUMENT_CONCAT(scopedTimer, __LINE__)(INSTRUMENT_SITE(name, InstrumentKind::Timer))
+#define INSTRUMENT_COUNT(name, increment) \
+    Instrumentation::threadRecorder().getStatistics(INSTRUMENT_SITE(name, InstrumentKind::Counter)).add(increment)
+#define INSTRUMENT_HISTOGRAM(name, value) \
+    Instrumentation::threadRecorder().getStatistics(INSTRUMENT_SITE(name, InstrumentKind::Histogram)).add(value)
+#else
+#define INSTRUMENT_SCOPE(name) ((void) 0)
+#define INSTRUMENT_COUNT(name, increment) ((void) 0)
+#define INSTRUMENT_HISTOGRAM(name, value) ((void) 0)
+#endif
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INSTRUMENTATION_H
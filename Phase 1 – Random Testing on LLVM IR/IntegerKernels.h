@@ -0,0 +1,354 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INTEGERKERNELS_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INTEGERKERNELS_H
+
+#include <cstdint>
+#include <stdexcept>
+#include <type_traits>
+
+#include "llvm/IR/InstrTypes.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/Type.h"
+
+using namespace llvm;
+
+/**
+ * Arithmetic and comparisons of the integer types of LLVM IR (i1, i8, i16, i32 and i64) without APInt.
+ *
+ * A value of width N is kept in an int64_t sign-extended from bit N - 1, so it already is its signed value, and
+ * reinterpreted as uint64_t it keeps its unsigned order. Every operation is instantiated per width: it computes
+ * in the unsigned type of the width, where overflow wraps like in LLVM, and sign-extends the result again.
+ * Kernels are selected once per instruction when a function is summarized, navigations only call them through
+ * a function pointer, or a lane kernel for a whole row of lanes.
+ *
+ * What LLVM leaves poison or undefined gets a fixed result: a shift by the width or more shifts every bit out,
+ * INT_MIN / -1 wraps to INT_MIN and INT_MIN % -1 is 0. A division by zero throws.
+ *
+ * The integer casts (sext, zext and trunc) are binary kernels as well, with a second operand that is unused, so
+ * they run wherever a binary operation does.
+ */
+
+typedef int64_t (*BinaryKernel)(int64_t lhs, int64_t rhs);
+typedef bool (*CompareKernel)(int64_t lhs, int64_t rhs);
+// dst[i] = lhs[i] op rhs[i] for the n lanes, a kernel that can throw only evaluates the lanes set in the mask
+typedef void (*LaneKernel)(const int64_t *lhs, const int64_t *rhs, int64_t *dst, unsigned n, uint64_t lanes);
+
+// the value of an integer of the width as it is kept, sign-extended from its highest bit
+inline int64_t normalizeInteger(int64_t value, unsigned bits) {
+    return bits == 0 || bits >= 64 ? value : (int64_t) ((uint64_t) value << (64 - bits)) >> (64 - bits);
+}
+
+template<unsigned Bits>
+struct IntegerArithmetic {
+    typedef typename std::conditional<Bits <= 8, uint8_t,
+            typename std::conditional<Bits <= 16, uint16_t,
+                    typename std::conditional<Bits <= 32, uint32_t, uint64_t>::type>::type>::type Unsigned;
+    typedef typename std::make_signed<Unsigned>::type Signed;
+
+    static int64_t normalize(uint64_t value) {
+        return Bits == 1 ? -(int64_t) (value & 1) : (int64_t) (Signed) (Unsigned) value;
+    }
+
+    // zero-extended from the width
+    static uint64_t toUnsigned(int64_t value) {
+        return Bits == 1 ? (uint64_t) value & 1 : (uint64_t) (Unsigned) value;
+    }
+
+    static int64_t add(int64_t lhs, int64_t rhs) {
+        return normalize((uint64_t) lhs + (uint64_t) rhs);
+    }
+
+    static int64_t sub(int64_t lhs, int64_t rhs) {
+        return normalize((uint64_t) lhs - (uint64_t) rhs);
+    }
+
+    static int64_t mul(int64_t lhs, int64_t rhs) {
+        return normalize((uint64_t) lhs * (uint64_t) rhs);
+    }
+
+    static int64_t sdiv(int64_t lhs, int64_t rhs) {
+        if (rhs == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        return rhs == -1 ? normalize(0 - (uint64_t) lhs) : lhs / rhs;
+    }
+
+    static int64_t udiv(int64_t lhs, int64_t rhs) {
+        if (rhs == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        return normalize(toUnsigned(lhs) / toUnsigned(rhs));
+    }
+
+    static int64_t srem(int64_t lhs, int64_t rhs) {
+        if (rhs == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        return rhs == -1 ? 0 : lhs % rhs;
+    }
+
+    static int64_t urem(int64_t lhs, int64_t rhs) {
+        if (rhs == 0) {
+            throw std::runtime_error("Division by zero");
+        }
+        return normalize(toUnsigned(lhs) % toUnsigned(rhs));
+    }
+
+    static int64_t bitAnd(int64_t lhs, int64_t rhs) {
+        return lhs & rhs;
+    }
+
+    static int64_t bitOr(int64_t lhs, int64_t rhs) {
+        return lhs | rhs;
+    }
+
+    static int64_t bitXor(int64_t lhs, int64_t rhs) {
+        return lhs ^ rhs;
+    }
+
+    static int64_t shl(int64_t lhs, int64_t rhs) {
+        return toUnsigned(rhs) >= Bits ? 0 : normalize((uint64_t) lhs << toUnsigned(rhs));
+    }
+
+    static int64_t lshr(int64_t lhs, int64_t rhs) {
+        return toUnsigned(rhs) >= Bits ? 0 : normalize(toUnsigned(lhs) >> toUnsigned(rhs));
+    }
+
+    static int64_t ashr(int64_t lhs, int64_t rhs) {
+        return lhs >> (toUnsigned(rhs) >= Bits ? 63 : toUnsigned(rhs));
+    }
+};
+
+// a cast from FromBits to ToBits, the second operand is unused
+template<unsigned FromBits, unsigned ToBits>
+struct IntegerCast {
+    // the value already is sign-extended from its highest bit
+    static int64_t sext(int64_t value, int64_t) {
+        return value;
+    }
+
+    static int64_t zext(int64_t value, int64_t) {
+        return IntegerArithmetic<ToBits>::normalize(IntegerArithmetic<FromBits>::toUnsigned(value));
+    }
+
+    static int64_t trunc(int64_t value, int64_t) {
+        return IntegerArithmetic<ToBits>::normalize((uint64_t) value);
+    }
+};
+
+// T is int64_t for the signed predicates and uint64_t for the unsigned ones
+template<typename T>
+struct IntegerComparison {
+    static bool eq(int64_t lhs, int64_t rhs) {
+        return lhs == rhs;
+    }
+
+    static bool ne(int64_t lhs, int64_t rhs) {
+        return lhs != rhs;
+    }
+
+    static bool gt(int64_t lhs, int64_t rhs) {
+        return (T) lhs > (T) rhs;
+    }
+
+    static bool ge(int64_t lhs, int64_t rhs) {
+        return (T) lhs >= (T) rhs;
+    }
+
+    static bool lt(int64_t lhs, int64_t rhs) {
+        return (T) lhs < (T) rhs;
+    }
+
+    static bool le(int64_t lhs, int64_t rhs) {
+        return (T) lhs <= (T) rhs;
+    }
+};
+
+inline int64_t unknownBinaryOperation(int64_t, int64_t) {
+    throw std::runtime_error("Unknown binary operation");
+}
+
+inline int64_t unknownCast(int64_t, int64_t) {
+    throw std::runtime_error("Unknown cast");
+}
+
+inline bool unknownComparison(int64_t, int64_t) {
+    throw std::runtime_error("Unknown comparison type");
+}
+
+// the kernel is a template argument, so it is inlined into the loop and the loop is vectorized
+template<BinaryKernel Kernel, bool CanThrow>
+void applyToLanes(const int64_t *lhs, const int64_t *rhs, int64_t *dst, unsigned n, uint64_t lanes) {
+    for (unsigned i = 0; i < n; i++) {
+        dst[i] = !CanThrow || ((lanes >> i) & 1) ? Kernel(lhs[i], rhs[i]) : 0;
+    }
+}
+
+template<CompareKernel Kernel>
+void compareLanes(const int64_t *lhs, const int64_t *rhs, int64_t *dst, unsigned n, uint64_t) {
+    for (unsigned i = 0; i < n; i++) {
+        dst[i] = Kernel(lhs[i], rhs[i]);
+    }
+}
+
+struct BinaryKernels {
+    BinaryKernel scalar;
+    LaneKernel lanes;
+};
+
+struct CompareKernels {
+    CompareKernel scalar;
+    LaneKernel lanes;
+};
+
+template<BinaryKernel Kernel, bool CanThrow = false>
+BinaryKernels makeBinaryKernels() {
+    return {Kernel, &applyToLanes<Kernel, CanThrow>};
+}
+
+template<CompareKernel Kernel>
+CompareKernels makeCompareKernels() {
+    return {Kernel, &compareLanes<Kernel>};
+}
+
+template<unsigned Bits>
+BinaryKernels selectBinaryKernels(Instruction::BinaryOps opCode) {
+    typedef IntegerArithmetic<Bits> A;
+    switch (opCode) {
+        case Instruction::Add:
+            return makeBinaryKernels<&A::add>();
+        case Instruction::Sub:
+            return makeBinaryKernels<&A::sub>();
+        case Instruction::Mul:
+            return makeBinaryKernels<&A::mul>();
+        case Instruction::SDiv:
+            return makeBinaryKernels<&A::sdiv, true>();
+        case Instruction::UDiv:
+            return makeBinaryKernels<&A::udiv, true>();
+        case Instruction::SRem:
+            return makeBinaryKernels<&A::srem, true>();
+        case Instruction::URem:
+            return makeBinaryKernels<&A::urem, true>();
+        case Instruction::And:
+            return makeBinaryKernels<&A::bitAnd>();
+        case Instruction::Or:
+            return makeBinaryKernels<&A::bitOr>();
+        case Instruction::Xor:
+            return makeBinaryKernels<&A::bitXor>();
+        case Instruction::Shl:
+            return makeBinaryKernels<&A::shl>();
+        case Instruction::LShr:
+            return makeBinaryKernels<&A::lshr>();
+        case Instruction::AShr:
+            return makeBinaryKernels<&A::ashr>();
+        default:
+            return makeBinaryKernels<&unknownBinaryOperation, true>();
+    }
+}
+
+/**
+ * @brief Kernels of a binary operation of the type, operations of other types (floating point, vectors or
+ * integers of another width) throw when they are evaluated
+ */
+inline BinaryKernels selectBinaryKernels(Instruction::BinaryOps opCode, Type *type) {
+    switch (type->isIntegerTy() ? type->getIntegerBitWidth() : 0) {
+        case 1:
+            return selectBinaryKernels<1>(opCode);
+        case 8:
+            return selectBinaryKernels<8>(opCode);
+        case 16:
+            return selectBinaryKernels<16>(opCode);
+        case 32:
+            return selectBinaryKernels<32>(opCode);
+        case 64:
+            return selectBinaryKernels<64>(opCode);
+        default:
+            return makeBinaryKernels<&unknownBinaryOperation, true>();
+    }
+}
+
+template<unsigned FromBits, unsigned ToBits>
+BinaryKernels selectCastKernels(Instruction::CastOps opCode) {
+    typedef IntegerCast<FromBits, ToBits> C;
+    switch (opCode) {
+        case Instruction::SExt:
+            return makeBinaryKernels<&C::sext>();
+        case Instruction::ZExt:
+            return makeBinaryKernels<&C::zext>();
+        case Instruction::Trunc:
+            return makeBinaryKernels<&C::trunc>();
+        default:
+            return makeBinaryKernels<&unknownCast, true>();
+    }
+}
+
+template<unsigned FromBits>
+BinaryKernels selectCastKernels(Instruction::CastOps opCode, unsigned toBits) {
+    switch (toBits) {
+        case 1:
+            return selectCastKernels<FromBits, 1>(opCode);
+        case 8:
+            return selectCastKernels<FromBits, 8>(opCode);
+        case 16:
+            return selectCastKernels<FromBits, 16>(opCode);
+        case 32:
+            return selectCastKernels<FromBits, 32>(opCode);
+        case 64:
+            return selectCastKernels<FromBits, 64>(opCode);
+        default:
+            return makeBinaryKernels<&unknownCast, true>();
+    }
+}
+
+/**
+ * @brief Kernels of an integer cast between the types, casts of other types or of integers of another width
+ * throw when they are evaluated
+ */
+inline BinaryKernels selectCastKernels(Instruction::CastOps opCode, Type *fromType, Type *toType) {
+    unsigned toBits = toType->isIntegerTy() ? toType->getIntegerBitWidth() : 0;
+    switch (fromType->isIntegerTy() ? fromType->getIntegerBitWidth() : 0) {
+        case 1:
+            return selectCastKernels<1>(opCode, toBits);
+        case 8:
+            return selectCastKernels<8>(opCode, toBits);
+        case 16:
+            return selectCastKernels<16>(opCode, toBits);
+        case 32:
+            return selectCastKernels<32>(opCode, toBits);
+        case 64:
+            return selectCastKernels<64>(opCode, toBits);
+        default:
+            return makeBinaryKernels<&unknownCast, true>();
+    }
+}
+
+// comparisons do not depend on the width, sign extension keeps both the signed and the unsigned order
+inline CompareKernels selectCompareKernels(CmpInst::Predicate predicate) {
+    typedef IntegerComparison<int64_t> S;
+    typedef IntegerComparison<uint64_t> U;
+    switch (predicate) {
+        case CmpInst::ICMP_EQ:
+            return makeCompareKernels<&S::eq>();
+        case CmpInst::ICMP_NE:
+            return makeCompareKernels<&S::ne>();
+        case CmpInst::ICMP_UGT:
+            return makeCompareKernels<&U::gt>();
+        case CmpInst::ICMP_UGE:
+            return makeCompareKernels<&U::ge>();
+        case CmpInst::ICMP_ULT:
+            return makeCompareKernels<&U::lt>();
+        case CmpInst::ICMP_ULE:
+            return makeCompareKernels<&U::le>();
+        case CmpInst::ICMP_SGT:
+            return makeCompareKernels<&S::gt>();
+        case CmpInst::ICMP_SGE:
+            return makeCompareKernels<&S::ge>();
+        case CmpInst::ICMP_SLT:
+            return makeCompareKernels<&S::lt>();
+        case CmpInst::ICMP_SLE:
+            return makeCompareKernels<&S::le>();
+        default:
+            return makeCompareKernels<&unknownComparison>();
+    }
+}
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_INTEGERKERNELS_H
@@ -0,0 +1,155 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_MODULELOADER_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_MODULELOADER_H
+
+#include <cstdio>
+#include <chrono>
+#include <memory>
+#include <set>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/GlobalVariable.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/Error.h"
+#include "llvm/Support/SourceMgr.h"
+
+using namespace llvm;
+
+/**
+ * @brief Loads IR files and materializes the function bodies a run needs
+ *
+ * A bitcode file is read lazily: the globals and function declarations are loaded, the body of a function is
+ * only read when it is materialized. By default only the functions reachable from the tested ones, through
+ * calls or any other reference to the function, are materialized; the rest of a large module is never read.
+ * Textual IR can not be read lazily and is always parsed completely. The time spent loading and materializing
+ * is summed, so the startup cost can be reported.
+ */
+class ModuleLoader {
+private:
+    const bool materializeAll;
+    std::chrono::steady_clock::duration loadTime{0};
+
+    // a timer that adds the time of a scope to loadTime
+    class LoadTimer {
+    private:
+        ModuleLoader &loader;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    public:
+        explicit LoadTimer(ModuleLoader &loader) : loader(loader) {}
+
+        ~LoadTimer() {
+            loader.loadTime += std::chrono::steady_clock::now() - start;
+        }
+    };
+
+    static void check(Error error, const Function &function) {
+        if (error) {
+            throw std::runtime_error("failed to materialize function " + function.getName().str() + ": " +
+                                     toString(std::move(error)));
+        }
+    }
+
+    // adds the functions a value refers to, looking through constant expressions and global initializers
+    static void addReferencedFunctions(const Value *value, std::set<const Value *> &visited,
+                                       std::vector<Function *> &worklist) {
+        if (!isa<Constant>(value) || !visited.insert(value).second) {
+            return;
+        }
+        if (auto *function = dyn_cast<Function>(value)) {
+            worklist.push_back(const_cast<Function *>(function));
+        } else if (auto *globalVariable = dyn_cast<GlobalVariable>(value)) {
+            if (globalVariable->hasInitializer()) {
+                addReferencedFunctions(globalVariable->getInitializer(), visited, worklist);
+            }
+        } else if (!isa<GlobalValue>(value)) {
+            for (auto &operand: cast<Constant>(value)->operands()) {
+                addReferencedFunctions(operand, visited, worklist);
+            }
+        }
+    }
+
+public:
+    /**
+     * @param materializeAll read every function body when a module is loaded
+     */
+    explicit ModuleLoader(bool materializeAll = false) : materializeAll(materializeAll) {}
+
+    /**
+     * @throws std::runtime_error if the file can not be read or parsed
+     */
+    std::unique_ptr<Module> load(const std::string &filename, LLVMContext &context) {
+        LoadTimer timer(*this);
+        SMDiagnostic err;
+        std::unique_ptr<Module> module = getLazyIRFileModule(filename, err, context);
+        if (module == nullptr) {
+            throw std::runtime_error("failed to load LLVM IR file \"" + filename + "\"");
+        }
+        if (materializeAll) {
+            if (Error error = module->materializeAll()) {
+                throw std::runtime_error("failed to load LLVM IR file \"" + filename + "\": " +
+                                         toString(std::move(error)));
+            }
+        }
+        return module;
+    }
+
+    /**
+     * @brief Materializes a function and every function it can reach
+     *
+     * Functions that are already materialized are skipped, so a module can be shared by several entry points.
+     * @throws std::runtime_error if a function body is malformed
+     */
+    void materialize(Function &entryPoint) {
+        LoadTimer timer(*this);
+        std::set<const Value *> visited;
+        std::vector<Function *> worklist{&entryPoint};
+        while (!worklist.empty()) {
+            Function *function = worklist.back();
+            worklist.pop_back();
+            if (!function->isMaterializable()) {
+                // a declaration, or a body whose references were followed when it was materialized
+                continue;
+            }
+            check(function->materialize(), *function);
+            for (auto &BB: *function) {
+                for (auto &I: BB) {
+                    for (auto &operand: I.operands()) {
+                        addReferencedFunctions(operand, visited, worklist);
+                    }
+                }
+            }
+        }
+    }
+
+    double getLoadSeconds() const {
+        return std::chrono::duration<double>(loadTime).count();
+    }
+
+    static unsigned getMaterializedFunctionCount(const Module &module) {
+        unsigned count = 0;
+        for (auto &F: module) {
+            if (!F.isDeclaration() && !F.isMaterializable()) {
+                count++;
+            }
+        }
+        return count;
+    }
+
+    static unsigned getDefinedFunctionCount(const Module &module) {
+        unsigned count = 0;
+        for (auto &F: module) {
+            if (!F.isDeclaration()) {
+                count++;
+            }
+        }
+        return count;
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_MODULELOADER_H
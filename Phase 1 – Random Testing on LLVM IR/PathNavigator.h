@@ -2,6 +2,8 @@
 #define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_PATHNAVIGATOR_H
 
 #include <cstdio>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <set>
 #include <cstdlib>
@@ -17,341 +19,193 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "CompiledFunction.h"
+#include "ExecutionBudget.h"
+#include "Instrumentation.h"
 #include "Utils.h"
 
 using namespace llvm;
 
+// everything a navigation produced, in a form that outlives the navigator
+struct NavigationResult {
+    std::map<std::string, int64_t> argumentsMap;
+    std::vector<BasicBlock *> path;
+    std::map<std::string, int64_t> variablesMap;
+    std::vector<CmpRecord> cmpRecords;
+    NavigationStatus status;
+    std::vector<uint64_t> loopIterations;
+    // what went wrong when the status is Error
+    std::string error;
+};
+
 class PathNavigator {
 private:
-    BasicBlock *entryBlock;
-    std::map<std::string, int> variablesMap;
+    const CompiledFunction &function;
+    std::vector<int64_t> registers;
+    std::vector<bool> assignedSlots;
 
     std::vector<BasicBlock *> path;
-    std::vector<ICmpInst *> cmpInstructions;
-public:
-
-    PathNavigator(BasicBlock *entryBlock, std::map<std::string, int> argumentsMap)
-            : entryBlock(entryBlock), variablesMap(std::move(argumentsMap)) {}
+    std::vector<unsigned> blockTrace;
+    std::vector<CmpRecord> cmpRecords;
 
-    void navigate() {
-        BasicBlock *currentBasicBlock = entryBlock;
-        Instruction * terminatorInst;
-
-        do {
-            path.push_back(currentBasicBlock);
-            terminatorInst = currentBasicBlock->getTerminator();
+    const ExecutionBudget budget;
+    NavigationStatus status = NavigationStatus::Completed;
+    // back edges taken per loop of the function
+    std::vector<uint64_t> loopIterations;
+public:
 
-            applyAssignments(currentBasicBlock);
-            auto evaluateConditionResult = evaluateComparison(currentBasicBlock);
-            if (evaluateConditionResult != nullptr) {
-                if (*evaluateConditionResult) {
-                    currentBasicBlock = terminatorInst->getSuccessor(0);
-                } else {
-                    currentBasicBlock = terminatorInst->getSuccessor(1);
-                }
-            } else if (terminatorInst->getNumSuccessors() == 1) {
-                currentBasicBlock = terminatorInst->getSuccessor(0);
-            } else {
-                break;
+    PathNavigator(const CompiledFunction &function, const ExecutionBudget &budget = {0, 0})
+            : function(function), registers(function.getRegisterCount()),
+              assignedSlots(function.getSlotCount()), budget(budget), loopIterations(function.getLoopCount()) {}
+
+    PathNavigator(const CompiledFunction &function, const std::map<std::string, int64_t> &argumentsMap,
+                  const ExecutionBudget &budget = {0, 0})
+            : PathNavigator(function, budget) {
+        for (auto &argument: argumentsMap) {
+            int slot = function.getSlot(argument.first);
+            if (slot < 0) {
+                throw std::runtime_error("Variable " + argument.first + " not found in function");
             }
-
-        } while (true);
-    }
-
-    std::map<std::string, int> &getVariablesMap() {
-        return variablesMap;
+            setArgument(slot, argument.second);
+        }
     }
 
-    std::vector<BasicBlock *> &getPath() {
-        return path;
+    /**
+     * @brief Forgets the previous navigation but keeps every buffer, so a reused navigator does not allocate
+     */
+    void reset() {
+        std::fill(assignedSlots.begin(), assignedSlots.end(), false);
+        std::fill(loopIterations.begin(), loopIterations.end(), 0);
+        path.clear();
+        blockTrace.clear();
+        cmpRecords.clear();
+        status = NavigationStatus::Completed;
     }
 
-    std::vector<ICmpInst *> &getCmpInstructions() {
-        return cmpInstructions;
+    // an input of a narrower variable gets the value it has in that variable, like a1 = (char) 300 is 44
+    void setArgument(unsigned slot, int64_t value) {
+        registers[slot] = normalizeInteger(value, function.getSlotBits(slot));
+        assignedSlots[slot] = true;
     }
 
-private:
-
-    void applyAssignments(BasicBlock *basicBlock) {
-        for (auto &I: *basicBlock) {
-            if (I.getOpcode() == Instruction::Store) {
-                auto *storeInst = dyn_cast<StoreInst>(&I);
-
-                std::string pointerOpName = storeInst->getPointerOperand()->getName().str();
-                Value * storeValue = storeInst->getValueOperand();
-
-                // if storeValue is a constant instruction
-                // Example: a = 5
-                if (isa<ConstantInt>(storeValue)) {
-                    variablesMap[pointerOpName] = dyn_cast<ConstantInt>(storeValue)->getSExtValue();
-                }
-                    // if storeValue is a load instruction
-                    // Example: a = b
-                else if (isa<LoadInst>(storeValue)) {
-                    std::string opName = getLoadInstOperandName(dyn_cast<LoadInst>(storeValue));
-
-                    if (variablesMap.find(opName) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opName + " not found in variablesMap");
-                    }
-
-                    variablesMap[pointerOpName] = variablesMap[opName];
-                }
-                    // check if store value is binary operator (like add, sub, mul or div)
-                    // Example: a = b + c, a = b - 2, a = c * 5, a = 10 / 2
-                else if (isa<BinaryOperator>(storeValue)) {
-                    variablesMap[pointerOpName] = evaluateBinaryOperation(
-                            dyn_cast<BinaryOperator>(storeValue)
-                    );
-                }
+    void navigate() {
+        INSTRUMENT_SCOPE("PathNavigator::navigate");
+        const DecodedInst *code = function.getCode().data();
+        const DecodedBlock *blocks = function.getBlocks().data();
+        const DecodedBlock *currentBlock = &blocks[CompiledFunction::getEntryIndex()];
+        BudgetTracker budgetTracker(budget);
+
+        while (true) {
+            if ((status = budgetTracker.step()) != NavigationStatus::Completed) {
+                return;
             }
-        }
-    }
-
-    int evaluateBinaryOperation(BinaryOperator *binaryOperator) {
-        Value * op1 = binaryOperator->getOperand(0);
-        Value * op2 = binaryOperator->getOperand(1);
-
-        int op1Value = 0;
-        int op2Value = 0;
-
-        // check if op1 or op2 is a constant and get constant value
-        // or load register and get register value
-        if (isa<LoadInst>(op1) && isa<LoadInst>(op2)) {
-            std::string op1Name = getLoadInstOperandName(dyn_cast<LoadInst>(op1));
-            std::string op2Name = getLoadInstOperandName(dyn_cast<LoadInst>(op2));
-
-            if (variablesMap.find(op1Name) == variablesMap.end() ||
-                variablesMap.find(op2Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op1Name + " or " + op2Name + "is missing");
+            path.push_back(currentBlock->basicBlock);
+            blockTrace.push_back(currentBlock - blocks);
+
+            execute(code + currentBlock->firstInst, code + currentBlock->lastInst);
+
+            unsigned successor;
+            switch (currentBlock->terminator) {
+                case TerminatorKind::Branch:
+                    successor = registers[currentBlock->conditionReg] ? 0 : 1;
+                    break;
+                case TerminatorKind::Jump:
+                    successor = 0;
+                    break;
+                case TerminatorKind::Unsupported:
+                    throw std::runtime_error("Unsupported terminator " +
+                                             valueToString(currentBlock->basicBlock->getTerminator()));
+                case TerminatorKind::Exit:
+                default:
+                    return;
             }
-
-            op1Value = variablesMap[op1Name];
-            op2Value = variablesMap[op2Name];
-        } else if (isa<LoadInst>(op1) && isa<ConstantInt>(op2)) {
-            std::string op1Name = getLoadInstOperandName(dyn_cast<LoadInst>(op1));
-            int op2ExactValue = dyn_cast<ConstantInt>(op2)->getSExtValue();
-
-            if (variablesMap.find(op1Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op1Name + " is missing");
+            if (currentBlock->backEdgeLoops[successor] >= 0) {
+                loopIterations[currentBlock->backEdgeLoops[successor]]++;
             }
+            execute(code + currentBlock->phiFirstInst[successor], code + currentBlock->phiLastInst[successor]);
+            currentBlock = &blocks[currentBlock->successors[successor]];
+        }
+    }
 
-            op1Value = variablesMap[op1Name];
-            op2Value = op2ExactValue;
-        } else if (isa<ConstantInt>(op1) && isa<LoadInst>(op2)) {
-            int op1ExactValue = dyn_cast<ConstantInt>(op1)->getSExtValue();
-            std::string op2Name = getLoadInstOperandName(dyn_cast<LoadInst>(op2));
-
-            if (variablesMap.find(op2Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op2Name + " is missing");
+    std::map<std::string, int64_t> getVariablesMap() const {
+        std::map<std::string, int64_t> variablesMap;
+        for (unsigned slot = 0; slot < function.getSlotCount(); slot++) {
+            if (assignedSlots[slot] && function.isVariableSlot(slot)) {
+                variablesMap[function.getSlotName(slot)] = registers[slot];
             }
-
-            op1Value = op1ExactValue;
-            op2Value = variablesMap[op2Name];
-        } else if (isa<ConstantInt>(op1) && isa<ConstantInt>(op2)) {
-            int op1ExactValue = dyn_cast<ConstantInt>(op1)->getSExtValue();
-            int op2ExactValue = dyn_cast<ConstantInt>(op2)->getSExtValue();
-
-            op1Value = op1ExactValue;
-            op2Value = op2ExactValue;
         }
-        return evaluateBinaryOpInstruction(binaryOperator->getOpcode(), op1Value, op2Value);
+        return variablesMap;
     }
 
-    inline static std::string getLoadInstOperandName(LoadInst *loadInst) {
-        return loadInst->getPointerOperand()->getName().str();
+    NavigationStatus getStatus() const {
+        return status;
     }
 
-    static int evaluateBinaryOpInstruction(Instruction::BinaryOps binaryOps, int e1, int e2) {
-        switch (binaryOps) {
-            case Instruction::Add:
-                return e1 + e2;
-            case Instruction::Sub:
-                return e1 - e2;
-            case Instruction::Mul:
-                return e1 * e2;
-            case Instruction::SDiv:
-                if (e2 != 0) {
-                    return e1 / e2;
-                } else {
-                    throw std::runtime_error("Unknown binary operation");
-                }
-            case Instruction::And:
-                return e1 & e2;
-            case Instruction::Or:
-                return e1 | e2;
-            case Instruction::Xor:
-                return e1 ^ e2;
-            case Instruction::Shl:
-                return e1 << e2;
-            case Instruction::LShr:
-            case Instruction::AShr:
-                return e1 >> e2;
-            default:
-                throw std::runtime_error("Unknown binary operation");
-        }
+    const std::vector<uint64_t> &getLoopIterations() const {
+        return loopIterations;
     }
 
-    bool *evaluateComparison(BasicBlock *basicBlock) {
-        for (auto &I: *basicBlock) {
-            // Integer comparison
-            if (I.getOpcode() == Instruction::ICmp) {
-                auto *cmpInstruction = dyn_cast<ICmpInst>(&I);
-
-                auto opCmp1 = cmpInstruction->getOperand(0);
-                auto opCmp2 = cmpInstruction->getOperand(1);
-
-                auto cmpPredicate = cmpInstruction->getPredicate();
-                int opCmp1FinalValue = 0;
-                int opCmp2FinalValue = 0;
-
-                // Example: a == b, a != b, a < b, a > b, a <= b, a >= b
-                if (isa<LoadInst>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end() ||
-                        variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " or " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a == 5
-                else if (isa<LoadInst>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    int opCmp2ExactValue = dyn_cast<ConstantInt>(opCmp2)->getSExtValue();
-
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = opCmp2ExactValue;
-                }
-                    // Example: 7 == b
-                else if (isa<ConstantInt>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    int opCmp1ExactValue = dyn_cast<ConstantInt>(opCmp1)->getSExtValue();
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = opCmp1ExactValue;
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a + b == c + d
-                else if (isa<BinaryOperator>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
-
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = opCmp2Value;
-                }
-                    // Example: a + b == c
-                else if (isa<BinaryOperator>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a == b - c
-                else if (isa<LoadInst>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
+    std::vector<BasicBlock *> &getPath() {
+        return path;
+    }
 
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " is missing");
-                    }
+    // block indices of the path in the compiled function
+    std::vector<unsigned> &getBlockTrace() {
+        return blockTrace;
+    }
 
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = opCmp2Value;
-                }
-                    // Example: a + b == 11
-                else if (isa<BinaryOperator>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    int opCmp2ExactValue = dyn_cast<ConstantInt>(opCmp2)->getSExtValue();
+    std::vector<CmpRecord> &getCmpRecords() {
+        return cmpRecords;
+    }
 
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = opCmp2ExactValue;
-                }
-                    // Example: 45 == a * b
-                else if (isa<ConstantInt>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    int opCmp1ExactValue = dyn_cast<ConstantInt>(opCmp1)->getSExtValue();
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
+    NavigationResult getResult(const std::map<std::string, int64_t> &argumentsMap) const {
+        return {argumentsMap, path, getVariablesMap(), cmpRecords, status, loopIterations, ""};
+    }
 
-                    opCmp1FinalValue = opCmp1ExactValue;
-                    opCmp2FinalValue = opCmp2Value;
-                }
+private:
 
-                auto cmpResult = evaluateCmpInstruction(cmpPredicate, opCmp1FinalValue, opCmp2FinalValue);
-                if (!cmpResult) {
-                    cmpInstruction->setPredicate(negateCmpPredicate(cmpPredicate));
+    void execute(const DecodedInst *inst, const DecodedInst *lastInst) {
+        for (; inst != lastInst; ++inst) {
+            switch (inst->opCode) {
+                case OpCode::Binary:
+                    registers[inst->dst] = inst->binaryKernel(read(inst->lhs), read(inst->rhs));
+                    break;
+                case OpCode::Store:
+                    registers[inst->dst] = read(inst->lhs);
+                    assignedSlots[inst->dst] = true;
+                    break;
+                case OpCode::Copy:
+                    registers[inst->dst] = read(inst->lhs);
+                    break;
+                case OpCode::ICmp: {
+                    bool cmpResult = inst->compareKernel(read(inst->lhs), read(inst->rhs));
+                    cmpRecords.push_back({inst->cmpInst, cmpResult});
+                    registers[inst->dst] = cmpResult;
+                    break;
                 }
-                cmpInstructions.push_back(cmpInstruction);
-                return new bool(cmpResult);
+                case OpCode::Clear:
+                    assignedSlots[inst->dst] = false;
+                    break;
             }
         }
-        return nullptr;
     }
 
-    static bool evaluateCmpInstruction(ICmpInst::Predicate cmpType, int opCmp1Value, int opCmp2Value) {
-        switch (cmpType) {
-            case ICmpInst::ICMP_EQ:
-                return opCmp1Value == opCmp2Value;
-            case ICmpInst::ICMP_NE:
-                return opCmp1Value != opCmp2Value;
-            case ICmpInst::ICMP_UGT:
-                return opCmp1Value > opCmp2Value;
-            case ICmpInst::ICMP_UGE:
-                return opCmp1Value >= opCmp2Value;
-            case ICmpInst::ICMP_ULT:
-                return opCmp1Value < opCmp2Value;
-            case ICmpInst::ICMP_ULE:
-                return opCmp1Value <= opCmp2Value;
-            case ICmpInst::ICMP_SGT:
-                return opCmp1Value > opCmp2Value;
-            case ICmpInst::ICMP_SGE:
-                return opCmp1Value >= opCmp2Value;
-            case ICmpInst::ICMP_SLT:
-                return opCmp1Value < opCmp2Value;
-            case ICmpInst::ICMP_SLE:
-                return opCmp1Value <= opCmp2Value;
-            default:
-                throw std::runtime_error("Unknown comparison type");
-        }
-    }
-
-    static CmpInst::Predicate negateCmpPredicate(CmpInst::Predicate predicate) {
-        switch (predicate) {
-            case CmpInst::ICMP_EQ:
-                return CmpInst::ICMP_NE;
-            case CmpInst::ICMP_NE:
-                return CmpInst::ICMP_EQ;
-            case CmpInst::ICMP_UGT:
-                return CmpInst::ICMP_ULE;
-            case CmpInst::ICMP_UGE:
-                return CmpInst::ICMP_ULT;
-            case CmpInst::ICMP_ULT:
-                return CmpInst::ICMP_UGE;
-            case CmpInst::ICMP_ULE:
-                return CmpInst::ICMP_UGT;
-            case CmpInst::ICMP_SGT:
-                return CmpInst::ICMP_SLE;
-            case CmpInst::ICMP_SGE:
-                return CmpInst::ICMP_SLT;
-            case CmpInst::ICMP_SLT:
-                return CmpInst::ICMP_SGE;
-            case CmpInst::ICMP_SLE:
-                return CmpInst::ICMP_SGT;
+    int64_t read(const Operand &operand) const {
+        switch (operand.kind) {
+            case OperandKind::Immediate:
+                return operand.value;
+            case OperandKind::Slot:
+                if (!assignedSlots[operand.value]) {
+                    throw std::runtime_error(
+                            "Variable " + function.getSlotName(operand.value) + " not found in variablesMap"
+                    );
+                }
+                return registers[operand.value];
+            case OperandKind::Unsupported:
+                throw std::runtime_error("Unsupported value " + function.getUnsupportedValue(operand.value));
+            case OperandKind::Temporary:
             default:
-                throw std::runtime_error("Unknown comparison type");
+                return registers[operand.value];
         }
     }
 };
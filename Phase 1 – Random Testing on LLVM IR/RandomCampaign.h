@@ -0,0 +1,288 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMCAMPAIGN_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMCAMPAIGN_H
+
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cstdlib>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IRReader/IRReader.h"
+#include "llvm/Support/SourceMgr.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "CompiledFunction.h"
+#include "Instrumentation.h"
+#include "JitNavigator.h"
+#include "PathNavigator.h"
+#include "Utils.h"
+
+using namespace llvm;
+
+/**
+ * @brief Block and edge coverage of the paths navigated in one compiled function
+ */
+class CoverageMap {
+private:
+    unsigned blockCount;
+    std::vector<bool> coveredBlocks;
+    std::unordered_set<uint64_t> coveredEdges;
+    unsigned coveredBlockCount = 0;
+
+public:
+    explicit CoverageMap(unsigned blockCount) : blockCount(blockCount), coveredBlocks(blockCount) {}
+
+    /**
+     * @brief Adds a block trace to the coverage
+     * @param blockTrace
+     * @return true if the trace covered a block or an edge that was not covered before
+     */
+    bool addTrace(const std::vector<unsigned> &blockTrace) {
+        INSTRUMENT_SCOPE("CoverageMap::addTrace");
+        bool isNew = false;
+        for (size_t i = 0; i < blockTrace.size(); i++) {
+            if (!coveredBlocks[blockTrace[i]]) {
+                coveredBlocks[blockTrace[i]] = true;
+                coveredBlockCount++;
+                isNew = true;
+            }
+            if (i > 0 && coveredEdges.insert((uint64_t) blockTrace[i - 1] * blockCount + blockTrace[i]).second) {
+                isNew = true;
+            }
+        }
+        return isNew;
+    }
+
+    unsigned getBlockCount() const {
+        return blockCount;
+    }
+
+    unsigned getCoveredBlockCount() const {
+        return coveredBlockCount;
+    }
+
+    size_t getCoveredEdgeCount() const {
+        return coveredEdges.size();
+    }
+};
+
+struct CampaignOptions {
+    unsigned threads;
+    ExecutionBudget budget;
+    // 0 means no limit, at least one of iterations and timeBudgetSeconds must be set
+    uint64_t iterations;
+    double timeBudgetSeconds;
+    int minRange, maxRange;
+    // inputs of iteration i are drawn from RandomEngine(seed, i)
+    uint64_t seed;
+};
+
+// iterations spent in one loop of the function over a campaign
+struct LoopStatistics {
+    uint64_t totalIterations = 0;
+    uint64_t maxIterations = 0;
+    // navigations that ran out of budget while the loop had the most iterations
+    uint64_t timeouts = 0;
+};
+
+/**
+ * @brief Runs random testing of one function on a pool of worker threads
+ *
+ * The compiled function is shared read-only between the workers. The inputs of iteration i are drawn from
+ * RandomEngine(seed, i), so a campaign navigates the same inputs for a seed whatever the number of
+ * workers. Each worker keeps a private coverage map, only inputs that look new to the worker are checked
+ * against (and merged into) the global coverage under a lock.
+ */
+class RandomCampaign {
+private:
+    const CompiledFunction &function;
+    const std::set<std::string> &inputArguments;
+    const CampaignOptions options;
+    const std::function<void(const NavigationResult &)> onNewCoverage;
+    // navigations run natively when it is given
+    const JitFunction *jitFunction;
+
+    std::mutex globalCoverageMutex;
+    CoverageMap globalCoverage;
+
+    std::atomic<uint64_t> nextIteration{0};
+    std::atomic<uint64_t> completedIterations{0};
+    std::atomic<uint64_t> failedNavigations{0};
+    std::atomic<uint64_t> timedOutNavigations{0};
+    std::chrono::steady_clock::time_point deadline;
+
+    std::mutex loopStatisticsMutex;
+    std::vector<LoopStatistics> loopStatistics;
+
+    bool claimIteration(uint64_t &iteration) {
+        iteration = nextIteration.fetch_add(1, std::memory_order_relaxed);
+        if (options.iterations > 0 && iteration >= options.iterations) {
+            return false;
+        }
+        return options.timeBudgetSeconds <= 0 || std::chrono::steady_clock::now() < deadline;
+    }
+
+    template<typename Navigator>
+    static void addLoopIterations(std::vector<LoopStatistics> &statistics, const Navigator &pathNavigator) {
+        const auto &loopIterations = pathNavigator.getLoopIterations();
+        size_t busiestLoop = 0;
+        for (size_t loop = 0; loop < loopIterations.size(); loop++) {
+            statistics[loop].totalIterations += loopIterations[loop];
+            statistics[loop].maxIterations = std::max(statistics[loop].maxIterations, loopIterations[loop]);
+            if (loopIterations[loop] > loopIterations[busiestLoop]) {
+                busiestLoop = loop;
+            }
+        }
+        if (pathNavigator.getStatus() != NavigationStatus::Completed && !loopIterations.empty()) {
+            statistics[busiestLoop].timeouts++;
+        }
+    }
+
+    std::map<std::string, int64_t> getArgumentsMap(const std::vector<int> &inputValues) const {
+        std::map<std::string, int64_t> argumentsMap;
+        size_t input = 0;
+        for (auto &variable: inputArguments) {
+            argumentsMap[variable] = inputValues[input++];
+        }
+        return argumentsMap;
+    }
+
+    template<typename Navigator>
+    void runIteration(Navigator &pathNavigator, const std::vector<int> &inputValues,
+                      CoverageMap &localCoverage, std::vector<LoopStatistics> &localLoopStatistics) {
+        try {
+            pathNavigator.navigate();
+        } catch (const std::runtime_error &) {
+            failedNavigations.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        completedIterations.fetch_add(1, std::memory_order_relaxed);
+        if (pathNavigator.getStatus() != NavigationStatus::Completed) {
+            timedOutNavigations.fetch_add(1, std::memory_order_relaxed);
+        }
+        addLoopIterations(localLoopStatistics, pathNavigator);
+        INSTRUMENT_HISTOGRAM("RandomCampaign::pathLength", pathNavigator.getBlockTrace().size());
+
+        if (!localCoverage.addTrace(pathNavigator.getBlockTrace())) {
+            return;
+        }
+
+        // waiting for the lock included
+        INSTRUMENT_SCOPE("RandomCampaign::mergeCoverage");
+        std::lock_guard<std::mutex> lock(globalCoverageMutex);
+        if (globalCoverage.addTrace(pathNavigator.getBlockTrace())) {
+            INSTRUMENT_COUNT("RandomCampaign::newCoverage", 1);
+            onNewCoverage(pathNavigator.getResult(getArgumentsMap(inputValues)));
+        }
+    }
+
+    /**
+     * @brief Runs iterations until the campaign is over
+     *
+     * The navigator and every buffer of the worker are reused by all its iterations, an iteration that
+     * does not add coverage does not allocate.
+     * @param inputSlots slot of each input argument in the navigator, -1 if the navigator has none
+     */
+    template<typename Navigator>
+    void runWorker(Navigator &pathNavigator, const std::vector<int> &inputSlots) {
+        CoverageMap localCoverage(function.getBlocks().size());
+        std::vector<LoopStatistics> localLoopStatistics(function.getLoopCount());
+        std::vector<int> inputValues(inputSlots.size());
+
+        uint64_t iteration;
+        while (claimIteration(iteration)) {
+            INSTRUMENT_SCOPE("RandomCampaign::iteration");
+            // inputs of an iteration only depend on the master seed, not on the worker that runs it
+            RandomEngine engine(options.seed, iteration);
+            pathNavigator.reset();
+            for (size_t input = 0; input < inputSlots.size(); input++) {
+                inputValues[input] = randomInRange(engine, options.minRange, options.maxRange);
+                if (inputSlots[input] >= 0) {
+                    pathNavigator.setArgument(inputSlots[input], inputValues[input]);
+                }
+            }
+            runIteration(pathNavigator, inputValues, localCoverage, localLoopStatistics);
+        }
+
+        std::lock_guard<std::mutex> lock(loopStatisticsMutex);
+        for (size_t loop = 0; loop < loopStatistics.size(); loop++) {
+            loopStatistics[loop].totalIterations += localLoopStatistics[loop].totalIterations;
+            loopStatistics[loop].maxIterations = std::max(loopStatistics[loop].maxIterations,
+                                                          localLoopStatistics[loop].maxIterations);
+            loopStatistics[loop].timeouts += localLoopStatistics[loop].timeouts;
+        }
+    }
+
+    void startWorker() {
+        std::vector<int> inputSlots;
+        for (auto &variable: inputArguments) {
+            inputSlots.push_back(jitFunction != nullptr ? jitFunction->getInputSlot(variable)
+                                                        : function.getSlot(variable));
+        }
+        if (jitFunction != nullptr) {
+            JitNavigator jitNavigator(*jitFunction, options.budget);
+            runWorker(jitNavigator, inputSlots);
+        } else {
+            PathNavigator pathNavigator(function, options.budget);
+            runWorker(pathNavigator, inputSlots);
+        }
+    }
+
+public:
+    RandomCampaign(const CompiledFunction &function, const std::set<std::string> &inputArguments,
+                   const CampaignOptions &options, std::function<void(const NavigationResult &)> onNewCoverage,
+                   const JitFunction *jitFunction = nullptr)
+            : function(function), inputArguments(inputArguments), options(options),
+              onNewCoverage(std::move(onNewCoverage)), jitFunction(jitFunction),
+              globalCoverage(function.getBlocks().size()),
+              loopStatistics(function.getLoopCount()) {}
+
+    void run() {
+        deadline = std::chrono::steady_clock::now() +
+                   std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                           std::chrono::duration<double>(options.timeBudgetSeconds));
+
+        std::vector<std::thread> workers;
+        for (unsigned i = 0; i < std::max(1u, options.threads); i++) {
+            workers.emplace_back(&RandomCampaign::startWorker, this);
+        }
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    uint64_t getIterationCount() const {
+        return completedIterations.load();
+    }
+
+    uint64_t getFailedNavigationCount() const {
+        return failedNavigations.load();
+    }
+
+    uint64_t getTimedOutNavigationCount() const {
+        return timedOutNavigations.load();
+    }
+
+    const std::vector<LoopStatistics> &getLoopStatistics() const {
+        return loopStatistics;
+    }
+
+    const CoverageMap &getCoverage() const {
+        return globalCoverage;
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMCAMPAIGN_H
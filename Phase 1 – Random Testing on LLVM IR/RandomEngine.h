@@ -0,0 +1,173 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMENGINE_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMENGINE_H
+
+#include <cstdint>
+#include <cstdlib>
+#include <atomic>
+#include <limits>
+#include <random>
+
+/**
+ * @brief SplitMix64, used to expand seeds into engine states
+ */
+class SplitMix64 {
+private:
+    uint64_t state;
+
+public:
+    explicit SplitMix64(uint64_t seed) : state(seed) {}
+
+    uint64_t next() {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    static uint64_t mix(uint64_t value) {
+        return SplitMix64(value).next();
+    }
+};
+
+/**
+ * @brief xoshiro256** engine with cheap construction, jump-ahead and independent streams
+ *
+ * RandomEngine(seed, stream) gives a reproducible engine per (seed, stream) pair, e.g. one stream per
+ * worker or per iteration of a campaign, and jump() advances an engine by 2^128 draws to split it into
+ * non-overlapping sequences. It satisfies UniformRandomBitGenerator, so it also works with <random>.
+ */
+class RandomEngine {
+private:
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+        return (x << k) | (x >> (64 - k));
+    }
+
+public:
+    typedef uint64_t result_type;
+
+    explicit RandomEngine(uint64_t seed, uint64_t stream = 0) {
+        SplitMix64 seeder(SplitMix64::mix(seed) + SplitMix64::mix(stream ^ 0xD1B54A32D192ED03ULL));
+        for (auto &word: s) {
+            word = seeder.next();
+        }
+    }
+
+    static constexpr result_type min() {
+        return 0;
+    }
+
+    static constexpr result_type max() {
+        return std::numeric_limits<result_type>::max();
+    }
+
+    result_type operator()() {
+        return next();
+    }
+
+    uint64_t next() {
+        const uint64_t result = rotl(s[1] * 5, 7) * 9;
+        const uint64_t t = s[1] << 17;
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+        return result;
+    }
+
+    // advances the engine by 2^128 draws
+    void jump() {
+        static const uint64_t JUMP[] = {
+                0x180EC6D33CFD0ABAULL, 0xD5A61266F0C9392CULL, 0xA9582618E03FC9AAULL, 0x39ABDC4529B1661CULL
+        };
+        uint64_t t[4] = {0, 0, 0, 0};
+        for (uint64_t jumpWord: JUMP) {
+            for (int b = 0; b < 64; b++) {
+                if (jumpWord & (uint64_t(1) << b)) {
+                    for (int i = 0; i < 4; i++) {
+                        t[i] ^= s[i];
+                    }
+                }
+                next();
+            }
+        }
+        for (int i = 0; i < 4; i++) {
+            s[i] = t[i];
+        }
+    }
+
+    // returns a copy of this engine and moves this engine to the next non-overlapping sequence
+    RandomEngine split() {
+        RandomEngine child = *this;
+        jump();
+        return child;
+    }
+
+    /**
+     * @brief Uniform integer in [startOfRange, endOfRange], returns startOfRange for an empty range
+     */
+    int inRange(int startOfRange, int endOfRange) {
+        if (endOfRange <= startOfRange) {
+            return startOfRange;
+        }
+        uint64_t span = (uint64_t) ((int64_t) endOfRange - startOfRange) + 1;
+        // Lemire's nearly divisionless bounded draw
+        __uint128_t product = (__uint128_t) next() * span;
+        uint64_t low = (uint64_t) product;
+        if (low < span) {
+            uint64_t threshold = -span % span;
+            while (low < threshold) {
+                product = (__uint128_t) next() * span;
+                low = (uint64_t) product;
+            }
+        }
+        return (int) (startOfRange + (int64_t) (product >> 64));
+    }
+
+    bool coinFlip() {
+        return next() >> 63;
+    }
+
+    // uniform double in [0, 1)
+    double nextDouble() {
+        return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+
+    void fillInRange(int *first, int *last, int startOfRange, int endOfRange) {
+        for (; first != last; ++first) {
+            *first = inRange(startOfRange, endOfRange);
+        }
+    }
+};
+
+inline std::atomic<uint64_t> &masterSeedStorage() {
+    static std::atomic<uint64_t> masterSeed(((uint64_t) std::random_device()() << 32) | std::random_device()());
+    return masterSeed;
+}
+
+inline uint64_t getMasterSeed() {
+    return masterSeedStorage().load();
+}
+
+// must be called before any number is drawn from threadRandomEngine()
+inline void setMasterSeed(uint64_t seed) {
+    masterSeedStorage().store(seed);
+}
+
+/**
+ * @brief Engine of the calling thread, seeded from the master seed
+ *
+ * The first thread that draws gets stream 0, so single threaded runs are reproducible from the master
+ * seed. Multi-threaded code that has to be reproducible should own RandomEngine(getMasterSeed(), stream)
+ * instances with streams that do not depend on thread scheduling.
+ */
+inline RandomEngine &threadRandomEngine() {
+    static std::atomic<uint64_t> nextStream(0);
+    thread_local RandomEngine engine(getMasterSeed(), nextStream.fetch_add(1));
+    return engine;
+}
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RANDOMENGINE_H
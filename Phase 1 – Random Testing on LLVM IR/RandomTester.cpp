@@ -12,64 +12,727 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 
+#include "AllocationCounter.h"
+#include "BatchPathNavigator.h"
+#include "CompiledFunction.h"
+#include "FunctionPool.h"
+#include "Instrumentation.h"
+#include "JitNavigator.h"
+#include "ModuleLoader.h"
 #include "PathNavigator.h"
+#include "RandomCampaign.h"
+#include "ResultWriter.h"
+#include "TestServer.h"
 
 using namespace llvm;
 
+static cl::OptionCategory randomTesterCategory("Random tester options");
+
+static cl::opt<std::string> inputFilename(
+        cl::Positional, cl::desc("<input .ll file or directory>"), cl::cat(randomTesterCategory)
+);
+
+static cl::opt<unsigned> batchSize(
+        "batch",
+        cl::desc("Navigate N random inputs together as lanes of one batch (1-64)"),
+        cl::init(0),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<uint64_t> campaignIterations(
+        "iterations",
+        cl::desc("Run a campaign of N random inputs and print only the inputs that add coverage"),
+        cl::init(0),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<double> campaignTimeBudget(
+        "time-budget",
+        cl::desc("Run a campaign for the given number of seconds"),
+        cl::init(0),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<unsigned> campaignThreads(
+        "workers",
+        cl::desc("Number of campaign worker threads, or of functions tested at once with --all-functions "
+                 "(default: all hardware threads)"),
+        cl::init(std::thread::hardware_concurrency()),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<bool> allFunctions(
+        "all-functions",
+        cl::desc("Test every function defined in the input instead of main, a directory input tests every "
+                 ".ll and .bc file in it"),
+        cl::init(false),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed, the seed of every run is printed so it can be replayed"),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<uint64_t> maxSteps(
+        "max-steps",
+        cl::desc("Maximum number of blocks one navigation may enter before it is reported as a timeout (0: no limit)"),
+        cl::init(100000),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<double> maxTime(
+        "max-time",
+        cl::desc("Maximum number of seconds one navigation may run before it is reported as a timeout (0: no limit)"),
+        cl::init(0),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<bool> printStatistics(
+        "print-stats",
+        cl::desc("Print the module load time, heap allocation statistics of the campaign and, in a build with "
+                 "INSTRUMENTATION, the timers, counters and histograms of the hot paths"),
+        cl::init(false),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<bool> materializeAll(
+        "materialize-all",
+        cl::desc("Read every function of a bitcode input, not only those reachable from the tested functions"),
+        cl::init(false),
+        cl::cat(randomTesterCategory)
+);
+
+enum class Engine {
+    Interpreter,
+    Jit,
+};
+
+static cl::opt<Engine> engine(
+        "engine",
+        cl::desc("Execution backend of the navigations"),
+        cl::values(
+                clEnumValN(Engine::Interpreter, "interp", "Interpret the pre-decoded instruction stream (default)"),
+                clEnumValN(Engine::Jit, "jit", "Run an instrumented copy of the function natively with ORC LLJIT")
+        ),
+        cl::init(Engine::Interpreter),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<ResultFormat> outputFormat(
+        "output-format",
+        cl::desc("Format of the generated tests"),
+        cl::values(
+                clEnumValN(ResultFormat::Text, "text", "Banner-delimited text (default)"),
+                clEnumValN(ResultFormat::Jsonl, "jsonl", "One JSON object per test"),
+                clEnumValN(ResultFormat::Binary, "binary", "Length-prefixed binary records")
+        ),
+        cl::init(ResultFormat::Text),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<std::string> outputFilename(
+        "output",
+        cl::desc("File the jsonl or binary tests are written to (default: standard output)"),
+        cl::value_desc("filename"),
+        cl::init("-"),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<bool> asyncOutput(
+        "async-output",
+        cl::desc("Write jsonl or binary tests from a background thread"),
+        cl::init(false),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<std::string> serveSocket(
+        "serve",
+        cl::desc("Run as a daemon that answers test requests on a Unix domain socket, --workers requests at once"),
+        cl::value_desc("socket path"),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<uint64_t> cacheMemory(
+        "cache-memory",
+        cl::desc("Heap size in MiB over which the daemon evicts the least recently used modules"),
+        cl::init(2048),
+        cl::cat(randomTesterCategory)
+);
+
+static cl::opt<std::string> traceFilename(
+        "trace",
+        cl::desc("Write the timed scopes of the hot paths as a Chrome trace (needs a build with INSTRUMENTATION)"),
+        cl::value_desc("filename"),
+        cl::cat(randomTesterCategory)
+);
+
+// what testFunction does with a function, from the command line or from a daemon request
+struct TestOptions {
+    Engine engine;
+    ExecutionBudget budget;
+    uint64_t seed;
+    unsigned batchSize;
+    uint64_t iterations;
+    double timeBudgetSeconds;
+    // threads of a campaign
+    unsigned workers;
+    bool printStatistics;
+};
+
+TestOptions getCommandLineTestOptions(unsigned workers) {
+    return {engine, ExecutionBudget{maxSteps, maxTime}, getMasterSeed(), batchSize, campaignIterations,
+            campaignTimeBudget, workers, printStatistics};
+}
+
+// analyses of a function that do not depend on the test options, the daemon keeps them between requests
+struct FunctionAnalysis {
+    Function &function;
+    // the function lowered once, every navigation runs on the decoded instruction stream
+    CompiledFunction compiledFunction;
+    std::set<std::string> inputArguments;
+    // only built for native navigations, by prepare
+    std::unique_ptr<JitFunction> jitFunction;
+
+    explicit FunctionAnalysis(Function &function)
+            : function(function), compiledFunction(function), inputArguments(getInputArguments(function, "a")) {}
+
+    /**
+     * @throws std::runtime_error if the function can not be compiled for the engine
+     */
+    void prepare(Engine engine) {
+        if (engine == Engine::Jit && jitFunction == nullptr) {
+            jitFunction = std::make_unique<JitFunction>(function, inputArguments);
+        }
+    }
+};
+
 LLVMContext &getGlobalContext() {
     static LLVMContext context;
     return context;
 }
 
 
-int main(int argc, char *argv[]) {
-    // Read the IR file.
-    LLVMContext & context = getGlobalContext();
-    SMDiagnostic err;
-    std::unique_ptr<Module> M = parseIRFile(argv[1], err, context);
-    if (M == nullptr) {
-        fprintf(stderr, "error: failed to load LLVM IR file \"%s\"", argv[1]);
-        return EXIT_FAILURE;
+void printNavigation(raw_ostream &out, const CompiledFunction &function, const NavigationResult &result) {
+    out << "************** Input Argument(s) ***************" << "\n";
+    for (auto &argument: result.argumentsMap) {
+        out << argument.first << ": " << argument.second << "\n";
+    }
+
+    out << "*************** Navigated Path *****************" << "\n";
+    for (auto basicBlock: result.path) {
+        out << function.getBlockName(basicBlock) << "\n";
     }
+    if (result.status != NavigationStatus::Completed) {
+        out << "... " << navigationStatusToString(result.status);
+        if (!result.error.empty()) {
+            out << ": " << result.error;
+        }
+        out << "\n";
+    }
+
+    out << "**************** Variables Map *****************" << "\n";
+    for (auto &variable: result.variablesMap) {
+        out << variable.first << ": " << variable.second << "\n";
+    }
+
+    out << "*********** Comparison Instructions ************" << "\n";
+    for (auto &cmpRecord: result.cmpRecords) {
+        out << function.getCmpString(cmpRecord) << "\n";
+    }
+
+    if (function.getLoopCount() > 0) {
+        out << "*************** Loop Iterations ****************" << "\n";
+        for (unsigned loop = 0; loop < function.getLoopCount(); loop++) {
+            out << function.getBlockName(function.getLoopHeader(loop)) << ": " << result.loopIterations[loop] << "\n";
+        }
+    }
+}
+
+/**
+ * @brief Fills a TestRecord with a navigation
+ * @param coveredBlocks blocks covered by the previous tests, updated with the blocks of this one
+ */
+void recordNavigation(TestRecord &record, std::set<const BasicBlock *> &coveredBlocks,
+                      const CompiledFunction &function, const NavigationResult &result) {
+    record.clear();
+    for (auto &argument: result.argumentsMap) {
+        record.inputs.emplace_back(argument.first, argument.second);
+    }
+    for (auto basicBlock: result.path) {
+        record.path.push_back(function.getBlockName(basicBlock));
+        if (coveredBlocks.insert(basicBlock).second) {
+            record.newBlocks.push_back(record.path.back());
+        }
+    }
+    for (auto &cmpRecord: result.cmpRecords) {
+        record.comparisons.push_back(function.getCmpString(cmpRecord));
+    }
+    record.status = navigationStatusToString(result.status);
+    record.coveredBlocks = coveredBlocks.size();
+}
+
+/**
+ * @param module the tested module, its materialized functions are counted
+ */
+void printStartup(raw_ostream &out, double loadSeconds, const Module *module) {
+    out << "******************* Startup ********************" << "\n";
+    out << "Module load: " << format("%.3f", loadSeconds * 1000) << " ms\n";
+    if (module != nullptr) {
+        out << "Materialized functions: " << ModuleLoader::getMaterializedFunctionCount(*module) << "/"
+            << ModuleLoader::getDefinedFunctionCount(*module) << "\n";
+    }
+}
+
+void printCampaignSummary(raw_ostream &out, const CompiledFunction &function, const RandomCampaign &campaign,
+                          uint64_t campaignAllocations, bool printStatistics) {
+    const CoverageMap &coverage = campaign.getCoverage();
+    out << "****************** Campaign ********************" << "\n";
+    out << "Iterations: " << campaign.getIterationCount() << "\n";
+    out << "Failed navigations: " << campaign.getFailedNavigationCount() << "\n";
+    out << "Timed out navigations: " << campaign.getTimedOutNavigationCount() << "\n";
+    out << "Covered blocks: " << coverage.getCoveredBlockCount() << "/" << coverage.getBlockCount() << " ("
+        << (int) ((float) coverage.getCoveredBlockCount() / coverage.getBlockCount() * 100) << "%)\n";
+    out << "Covered edges: " << coverage.getCoveredEdgeCount() << "\n";
+    for (unsigned loop = 0; loop < function.getLoopCount(); loop++) {
+        const LoopStatistics &statistics = campaign.getLoopStatistics()[loop];
+        out << "Loop " << function.getBlockName(function.getLoopHeader(loop))
+            << ": total iterations " << statistics.totalIterations
+            << ", max per navigation " << statistics.maxIterations
+            << ", timeouts " << statistics.timeouts << "\n";
+    }
+    if (printStatistics) {
+        // threads, coverage maps and printed inputs allocate, plain iterations do not
+        out << "****************** Statistics ******************" << "\n";
+        out << "Heap allocations: " << campaignAllocations << " ("
+            << format("%.4f", (double) campaignAllocations / std::max<uint64_t>(1, campaign.getIterationCount()))
+            << " per iteration)\n";
+    }
+}
+
+/**
+ * @brief Tests one function the way the options ask: one navigation, a batch or a campaign
+ *
+ * Single navigations and batches draw their inputs from threadRandomEngine(), campaigns from options.seed.
+ * @param analysis prepared for options.engine
+ * @param out text tests
+ * @param summaryStream campaign summaries
+ * @param writeRecord receives the tests when the output format is structured, empty for the text format
+ * @throws std::runtime_error if a single navigation fails
+ */
+void testFunction(const FunctionAnalysis &analysis, const TestOptions &options, raw_ostream &out,
+                  raw_ostream &summaryStream, const std::function<void(const TestRecord &)> &writeRecord) {
+    const CompiledFunction &compiledFunction = analysis.compiledFunction;
+    const auto &inputArguments = analysis.inputArguments;
+    const ExecutionBudget &budget = options.budget;
+    const JitFunction *jitFunction = options.engine == Engine::Jit ? analysis.jitFunction.get() : nullptr;
+
+    TestRecord testRecord;
+    testRecord.module = analysis.function.getParent()->getModuleIdentifier();
+    testRecord.function = analysis.function.getName().str();
+    std::set<const BasicBlock *> coveredBlocks;
+    auto report = [&](const NavigationResult &result) {
+        if (writeRecord) {
+            recordNavigation(testRecord, coveredBlocks, compiledFunction, result);
+            writeRecord(testRecord);
+            testRecord.id++;
+        } else {
+            printNavigation(out, compiledFunction, result);
+        }
+    };
+
+    if (options.iterations > 0 || options.timeBudgetSeconds > 0) {
+        CampaignOptions campaignOptions{options.workers, budget, options.iterations, options.timeBudgetSeconds,
+                                        -100, 100, options.seed};
+        RandomCampaign campaign(compiledFunction, inputArguments, campaignOptions, report, jitFunction);
+        uint64_t allocationsBeforeCampaign = getHeapAllocationCount();
+        campaign.run();
+        uint64_t campaignAllocations = getHeapAllocationCount() - allocationsBeforeCampaign;
+        printCampaignSummary(summaryStream, compiledFunction, campaign, campaignAllocations,
+                             options.printStatistics);
+        return;
+    }
+
+    if (options.batchSize > 0) {
+        std::vector<std::map<std::string, int64_t>> argumentsMaps;
+        for (unsigned lane = 0; lane < options.batchSize; lane++) {
+            argumentsMaps.push_back(randomInitialize(inputArguments, -100, 100));
+        }
+
+        if (jitFunction != nullptr) {
+            // native runs do not share work between inputs, the lanes run one after the other
+            for (auto &argumentsMap: argumentsMaps) {
+                auto jitNavigator = JitNavigator(*jitFunction, argumentsMap, budget);
+                jitNavigator.navigate();
+                report(jitNavigator.getResult(argumentsMap));
+            }
+            return;
+        }
 
-    BasicBlock *mainBasicBlock;
-    // initial mainBasicBlock
-    for (auto &F: *M) {
-        if (F.getName() == "main") {
-            mainBasicBlock = &F.getEntryBlock();
-            break;
+        auto batchNavigator = BatchPathNavigator(compiledFunction, argumentsMaps, budget);
+        batchNavigator.navigate();
+
+        for (unsigned lane = 0; lane < batchNavigator.getLaneCount(); lane++) {
+            report(batchNavigator.getResult(lane, argumentsMaps[lane]));
         }
+        return;
     }
 
     auto argumentsMap = randomInitialize(
-            getInputArguments(mainBasicBlock, "a"),
+            inputArguments,
             -100,
             100
     );
 
-    auto pathNavigator = PathNavigator(mainBasicBlock, argumentsMap);
+    if (jitFunction != nullptr) {
+        auto jitNavigator = JitNavigator(*jitFunction, argumentsMap, budget);
+        jitNavigator.navigate();
+        report(jitNavigator.getResult(argumentsMap));
+        return;
+    }
+
+    auto pathNavigator = PathNavigator(compiledFunction, argumentsMap, budget);
     pathNavigator.navigate();
 
-    outs() << "************** Input Argument(s) ***************" << "\n";
-    for (auto &argument: argumentsMap) {
-        outs() << argument.first << ": " << argument.second << "\n";
+    report(pathNavigator.getResult(argumentsMap));
+}
+
+/**
+ * @brief Tests every defined function of the input files on a FunctionPool
+ *
+ * The tests of a function are collected while it runs and printed in one piece, so the output of
+ * different functions never interleaves. Campaigns of the functions run on a single thread each.
+ * @param loadSeconds increased by the time the workers spent loading modules
+ * @return number of functions that could not be tested
+ */
+unsigned testAllFunctions(const std::vector<FunctionTask> &tasks, raw_ostream &summaryStream,
+                          ResultWriter *resultWriter, double &loadSeconds) {
+    std::mutex outputMutex;
+    std::atomic<unsigned> failedFunctions{0};
+
+    FunctionPool pool(tasks, materializeAll);
+    pool.run(campaignThreads, [&](size_t, const FunctionTask &task, Function *function) {
+        std::string text, summary;
+        raw_string_ostream textStream(text), summaryTextStream(summary);
+        std::vector<TestRecord> records;
+        std::string error;
+
+        if (function == nullptr) {
+            error = "failed to load LLVM IR file \"" + task.filename + "\"";
+        } else {
+            // the summary of a structured run goes to its own stream, it needs the banner too
+            raw_ostream &bannerStream = resultWriter != nullptr ? summaryTextStream : textStream;
+            bannerStream << "****************** Function ********************" << "\n";
+            bannerStream << task.filename << ": " << task.functionName << "\n";
+            std::function<void(const TestRecord &)> writeRecord;
+            if (resultWriter != nullptr) {
+                writeRecord = [&](const TestRecord &record) {
+                    records.push_back(record);
+                };
+            }
+            try {
+                FunctionAnalysis analysis(*function);
+                analysis.prepare(engine);
+                testFunction(analysis, getCommandLineTestOptions(1), textStream,
+                             resultWriter != nullptr ? summaryTextStream : textStream, writeRecord);
+            } catch (const std::runtime_error &exception) {
+                error = exception.what();
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (!error.empty()) {
+            failedFunctions++;
+            errs() << "error: " << task.filename << ": " << task.functionName << ": " << error << "\n";
+        }
+        outs() << textStream.str();
+        summaryStream << summaryTextStream.str();
+        for (auto &record: records) {
+            resultWriter->write(record);
+        }
+    });
+    loadSeconds += pool.getLoadSeconds();
+    return failedFunctions;
+}
+
+uint64_t getUnsignedField(const ServerRequest &request, const std::string &key, uint64_t defaultValue) {
+    auto it = request.find(key);
+    if (it == request.end()) {
+        return defaultValue;
+    }
+    char *end;
+    errno = 0;
+    uint64_t value = std::strtoull(it->second.c_str(), &end, 10);
+    if (it->second.empty() || *end != '\0' || errno != 0) {
+        throw std::runtime_error("invalid value \"" + it->second + "\" for " + key);
+    }
+    return value;
+}
+
+double getDoubleField(const ServerRequest &request, const std::string &key, double defaultValue) {
+    auto it = request.find(key);
+    if (it == request.end()) {
+        return defaultValue;
+    }
+    char *end;
+    double value = std::strtod(it->second.c_str(), &end);
+    if (it->second.empty() || *end != '\0') {
+        throw std::runtime_error("invalid value \"" + it->second + "\" for " + key);
+    }
+    return value;
+}
+
+/**
+ * @brief Test options of a daemon request, the command line gives the defaults
+ *
+ * Fields: engine (interp or jit), seed, batch, iterations, time-budget, workers, max-steps and max-time, with
+ * the meaning of the options of the same name. workers is at most --workers of the daemon.
+ * @throws std::runtime_error if a field has an invalid value
+ */
+TestOptions getRequestTestOptions(const ServerRequest &request) {
+    TestOptions options = getCommandLineTestOptions(1);
+    auto engineField = request.find("engine");
+    if (engineField != request.end()) {
+        if (engineField->second == "interp") {
+            options.engine = Engine::Interpreter;
+        } else if (engineField->second == "jit") {
+            options.engine = Engine::Jit;
+        } else {
+            throw std::runtime_error("invalid value \"" + engineField->second + "\" for engine");
+        }
+    }
+    options.seed = getUnsignedField(request, "seed", options.seed);
+    options.batchSize = getUnsignedField(request, "batch", options.batchSize);
+    if (options.batchSize > 64) {
+        throw std::runtime_error("batch must be at most 64");
+    }
+    options.iterations = getUnsignedField(request, "iterations", options.iterations);
+    options.timeBudgetSeconds = getDoubleField(request, "time-budget", options.timeBudgetSeconds);
+    // a client gets at most the threads the daemon was started with
+    options.workers = std::max<uint64_t>(1, std::min<uint64_t>(getUnsignedField(request, "workers", options.workers),
+                                                               campaignThreads));
+    options.budget.maxSteps = getUnsignedField(request, "max-steps", options.budget.maxSteps);
+    options.budget.maxSeconds = getDoubleField(request, "max-time", options.budget.maxSeconds);
+    return options;
+}
+
+/**
+ * @brief Answers one daemon request
+ *
+ * A test request has the module file, the function (default main) and the test options of
+ * getRequestTestOptions. The tests are streamed back as jsonl records while they are found, then a last line
+ * has the status, the seed, whether the module was cached and the text summary. command=stats answers with the
+ * counters of the module cache.
+ */
+void handleRequest(ModuleCache<FunctionAnalysis> &cache, const ServerRequest &request, FILE *response) {
+    std::string status;
+    auto command = request.find("command");
+    if (command != request.end() && command->second == "stats") {
+        size_t cachedModules;
+        uint64_t hits, misses, evictions;
+        cache.getStatistics(cachedModules, hits, misses, evictions);
+        status = "{\"status\":\"ok\",\"modules\":" + std::to_string(cachedModules) +
+                 ",\"hits\":" + std::to_string(hits) + ",\"misses\":" + std::to_string(misses) +
+                 ",\"evictions\":" + std::to_string(evictions) +
+                 ",\"heapBytes\":" + std::to_string(sys::Process::GetMallocUsage()) + "}\n";
+        fputs(status.c_str(), response);
+        return;
+    }
+
+    std::string summary;
+    raw_string_ostream summaryStream(summary);
+    std::string error;
+    bool isHit = false;
+    TestOptions options{};
+    ResultWriter writer(response, ResultFormat::Jsonl);
+    try {
+        options = getRequestTestOptions(request);
+        auto module = request.find("module");
+        if (module == request.end()) {
+            throw std::runtime_error("the request has no module");
+        }
+        auto function = request.find("function");
+        auto cachedModule = cache.get(module->second, isHit);
+
+        FunctionAnalysis *analysis;
+        {
+            std::unique_lock<std::shared_timed_mutex> lock(cachedModule->mutex);
+            analysis = &cachedModule->getAnalysis(function != request.end() ? function->second : "main");
+            analysis->prepare(options.engine);
+        }
+
+        // a long campaign delays the first test of another function of the module, not the other tests
+        std::shared_lock<std::shared_timed_mutex> lock(cachedModule->mutex);
+        threadRandomEngine() = RandomEngine(options.seed, 0);
+        testFunction(*analysis, options, nulls(), summaryStream, [&](const TestRecord &record) {
+            writer.write(record);
+            writer.flush();
+        });
+        writer.close();
+    } catch (const std::runtime_error &exception) {
+        error = exception.what();
     }
 
-    outs() << "*************** Navigated Path *****************" << "\n";
-    for (auto basicBlock: pathNavigator.getPath()) {
-        outs() << getSimpleNodeName(basicBlock) << "\n";
+    status = "{\"status\":";
+    ResultWriter::appendJsonString(status, error.empty() ? "ok" : "error");
+    if (!error.empty()) {
+        status += ",\"error\":";
+        ResultWriter::appendJsonString(status, error);
     }
+    status += ",\"seed\":" + std::to_string(options.seed);
+    status += std::string(",\"cached\":") + (isHit ? "true" : "false");
+    status += ",\"summary\":";
+    ResultWriter::appendJsonString(status, summaryStream.str());
+    status += "}\n";
+    fputs(status.c_str(), response);
+}
+
+/**
+ * @brief Prints the instrumentation summary with --print-stats and writes the --trace file
+ * @return false if the trace could not be written
+ */
+bool reportInstrumentation(raw_ostream &summaryStream) {
+    if (printStatistics) {
+        Instrumentation::get().printSummary(summaryStream);
+    }
+    if (!traceFilename.empty()) {
+        try {
+            Instrumentation::get().writeTrace(traceFilename);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(randomTesterCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Random tester for LLVM IR\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
+
+    if (!traceFilename.empty()) {
+        if (!Instrumentation::ENABLED) {
+            fprintf(stderr, "error: --trace needs a build with INSTRUMENTATION defined\n");
+            return EXIT_FAILURE;
+        }
+        Instrumentation::get().setTracing(true);
+    }
+
+    if (!serveSocket.empty()) {
+        ModuleCache<FunctionAnalysis> cache(cacheMemory << 20);
+        TestServer server(serveSocket, campaignThreads, [&](const ServerRequest &request, FILE *response) {
+            handleRequest(cache, request, response);
+        });
+        errs() << "Serving on " << serveSocket << "\n";
+        try {
+            server.run();
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        return reportInstrumentation(errs()) ? 0 : EXIT_FAILURE;
+    }
+    if (inputFilename.empty()) {
+        fprintf(stderr, "error: no input file, pass an .ll file, a directory or --serve\n");
+        return EXIT_FAILURE;
+    }
+
+    if (outputFormat == ResultFormat::Text && outputFilename != "-") {
+        fprintf(stderr, "error: --output needs --output-format=jsonl or --output-format=binary\n");
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<ResultWriter> resultWriter;
+    if (outputFormat != ResultFormat::Text) {
+        try {
+            resultWriter = std::make_unique<ResultWriter>(outputFilename, outputFormat, asyncOutput);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
+    // with a structured format the output only has tests, summaries go to stderr
+    raw_ostream &summaryStream = resultWriter != nullptr ? errs() : outs();
+
+    int exitCode = 0;
+    double loadSeconds = 0;
+    // the module main is tested in, nullptr when several functions are tested
+    std::unique_ptr<Module> M;
+    if (allFunctions || sys::fs::is_directory(inputFilename)) {
+        // the listing only reads declarations, the workers load what they test
+        ModuleLoader listingLoader;
+        std::vector<FunctionTask> tasks;
+        try {
+            tasks = listDefinedFunctions(listInputFiles(inputFilename), listingLoader);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        loadSeconds = listingLoader.getLoadSeconds();
+
+        unsigned failedFunctions = testAllFunctions(tasks, summaryStream, resultWriter.get(), loadSeconds);
+        summaryStream << "****************** Functions *******************" << "\n";
+        summaryStream << "Tested functions: " << tasks.size() - failedFunctions << "/" << tasks.size() << "\n";
+        exitCode = failedFunctions > 0 ? EXIT_FAILURE : 0;
+    } else {
+        // Read the IR file, a bitcode file only up to the functions main reaches.
+        LLVMContext & context = getGlobalContext();
+        ModuleLoader moduleLoader(materializeAll);
+        Function *mainFunction;
+        try {
+            M = moduleLoader.load(inputFilename, context);
+            mainFunction = M->getFunction("main");
+            if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+                fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+                return EXIT_FAILURE;
+            }
+            moduleLoader.materialize(*mainFunction);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        loadSeconds = moduleLoader.getLoadSeconds();
 
-    outs() << "**************** Variables Map *****************" << "\n";
-    for (auto &variable: pathNavigator.getVariablesMap()) {
-        outs() << variable.first << ": " << variable.second << "\n";
+        std::function<void(const TestRecord &)> writeRecord;
+        if (resultWriter != nullptr) {
+            writeRecord = [&](const TestRecord &record) {
+                resultWriter->write(record);
+            };
+        }
+        try {
+            FunctionAnalysis analysis(*mainFunction);
+            analysis.prepare(engine);
+            testFunction(analysis, getCommandLineTestOptions(campaignThreads), outs(), summaryStream, writeRecord);
+        } catch (const std::runtime_error &error) {
+            outs().flush();
+            fprintf(stderr, "error: %s\n", error.what());
+            exitCode = EXIT_FAILURE;
+        }
     }
 
-    outs() << "*********** Comparison Instructions ************" << "\n";
-    for (auto &cmpInstruction: pathNavigator.getCmpInstructions()) {
-        outs() << CmpInstructionToString(cmpInstruction) << "\n";
+    if (printStatistics) {
+        printStartup(summaryStream, loadSeconds, M.get());
+    }
+    if (!reportInstrumentation(summaryStream)) {
+        exitCode = EXIT_FAILURE;
     }
 
-    return 0;
+    if (resultWriter != nullptr) {
+        try {
+            resultWriter->close();
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
+    return exitCode;
 }
@@ -0,0 +1,362 @@
+#ifndef PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RESULTWRITER_H
+#define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RESULTWRITER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+enum class ResultFormat {
+    // banner-delimited text of the tool, not handled by ResultWriter
+    Text,
+    // one JSON object per line
+    Jsonl,
+    // length-prefixed little-endian records, see ResultWriter
+    Binary,
+};
+
+// one generated test
+struct TestRecord {
+    uint64_t id = 0;
+    // file and function the test was generated for
+    std::string module;
+    std::string function;
+    std::vector<std::pair<std::string, int64_t>> inputs;
+    // names of the navigated blocks
+    std::vector<std::string> path;
+    // comparisons of the path with the predicate that held, e.g. (a1 > 5)
+    std::vector<std::string> comparisons;
+    std::string status = "completed";
+    // coverage delta: blocks this test covered for the first time
+    std::vector<std::string> newBlocks;
+    // blocks covered so far, this test included
+    uint64_t coveredBlocks = 0;
+
+    // keeps the capacity of the vectors, so a reused record does not allocate for short names
+    void clear() {
+        inputs.clear();
+        path.clear();
+        comparisons.clear();
+        status = "completed";
+        newBlocks.clear();
+        coveredBlocks = 0;
+    }
+};
+
+/**
+ * @brief Buffered sink of TestRecords in JSON Lines or compact binary form
+ *
+ * Records are serialized into a large in-memory buffer that is written out once it is full. With a
+ * background writer, the full buffer is handed over to a writer thread and serialization goes on in a
+ * second buffer, so the search loop only waits when the disk cannot keep up. write is not thread safe,
+ * callers that produce records on several threads serialize the calls.
+ *
+ * JSONL record:
+ *   {"id":0,"module":"test1.ll","function":"main","inputs":{"a1":5},"path":["entry","if.then"],
+ *    "comparisons":["(a1 > 0)"],"status":"completed","newBlocks":["entry","if.then"],"coveredBlocks":2}
+ *
+ * Binary stream, all integers little-endian:
+ *   header:  "LTTR" u8 version (1)
+ *   record:  u32 size of the rest of the record
+ *            u64 id
+ *            str module, str function
+ *            u32 n, n * (str name, i64 value)   inputs
+ *            u32 n, n * str                     path
+ *            u32 n, n * str                     comparisons
+ *            str                                status
+ *            u32 n, n * str                     newBlocks
+ *            u64 coveredBlocks
+ *   str:     u32 length, bytes
+ */
+class ResultWriter {
+private:
+    static const size_t BUFFER_CAPACITY = 1 << 20;
+    static const uint8_t BINARY_VERSION = 1;
+
+    const ResultFormat format;
+    FILE *file;
+    bool ownsFile;
+    std::string buffer;
+
+    // background writer, the buffer it writes is pendingBuffer
+    const bool async;
+    std::thread writerThread;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::string pendingBuffer;
+    bool hasPendingBuffer = false;
+    bool stopping = false;
+    bool writeFailed = false;
+
+    void writeToFile(const std::string &data) {
+        if (!data.empty() && std::fwrite(data.data(), 1, data.size(), file) != data.size()) {
+            writeFailed = true;
+        }
+    }
+
+    void runWriter() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            condition.wait(lock, [this] { return hasPendingBuffer || stopping; });
+            if (!hasPendingBuffer) {
+                return;
+            }
+            // the producer does not touch pendingBuffer until it is handed back
+            lock.unlock();
+            writeToFile(pendingBuffer);
+            lock.lock();
+            pendingBuffer.clear();
+            hasPendingBuffer = false;
+            condition.notify_all();
+        }
+    }
+
+    // hands the serialized records to the file or to the writer thread
+    void flushBuffer() {
+        if (!async) {
+            writeToFile(buffer);
+            buffer.clear();
+            return;
+        }
+        std::unique_lock<std::mutex> lock(mutex);
+        condition.wait(lock, [this] { return !hasPendingBuffer; });
+        std::swap(buffer, pendingBuffer);
+        hasPendingBuffer = true;
+        condition.notify_all();
+    }
+
+    // sizes the buffers, starts the writer thread and writes the binary header
+    void start() {
+        buffer.reserve(BUFFER_CAPACITY + BUFFER_CAPACITY / 4);
+        if (async) {
+            pendingBuffer.reserve(buffer.capacity());
+            writerThread = std::thread(&ResultWriter::runWriter, this);
+        }
+        if (format == ResultFormat::Binary) {
+            buffer += "LTTR";
+            buffer += (char) BINARY_VERSION;
+        }
+    }
+
+    void appendJsonStringArray(const char *key, const std::vector<std::string> &values) {
+        buffer += ",\"";
+        buffer += key;
+        buffer += "\":[";
+        for (size_t i = 0; i < values.size(); i++) {
+            if (i > 0) {
+                buffer += ',';
+            }
+            appendJsonString(buffer, values[i]);
+        }
+        buffer += ']';
+    }
+
+    void appendJson(const TestRecord &record) {
+        buffer += "{\"id\":";
+        buffer += std::to_string(record.id);
+        buffer += ",\"module\":";
+        appendJsonString(buffer, record.module);
+        buffer += ",\"function\":";
+        appendJsonString(buffer, record.function);
+        buffer += ",\"inputs\":{";
+        for (size_t i = 0; i < record.inputs.size(); i++) {
+            if (i > 0) {
+                buffer += ',';
+            }
+            appendJsonString(buffer, record.inputs[i].first);
+            buffer += ':';
+            buffer += std::to_string(record.inputs[i].second);
+        }
+        buffer += '}';
+        appendJsonStringArray("path", record.path);
+        appendJsonStringArray("comparisons", record.comparisons);
+        buffer += ",\"status\":";
+        appendJsonString(buffer, record.status);
+        appendJsonStringArray("newBlocks", record.newBlocks);
+        buffer += ",\"coveredBlocks\":";
+        buffer += std::to_string(record.coveredBlocks);
+        buffer += "}\n";
+    }
+
+    void appendUnsigned(uint64_t value, unsigned bytes) {
+        for (unsigned i = 0; i < bytes; i++) {
+            buffer += (char) ((value >> (8 * i)) & 0xff);
+        }
+    }
+
+    void appendBinaryString(const std::string &value) {
+        appendUnsigned(value.size(), 4);
+        buffer += value;
+    }
+
+    void appendBinaryStringArray(const std::vector<std::string> &values) {
+        appendUnsigned(values.size(), 4);
+        for (auto &value: values) {
+            appendBinaryString(value);
+        }
+    }
+
+    void appendBinary(const TestRecord &record) {
+        size_t sizeOffset = buffer.size();
+        appendUnsigned(0, 4);
+
+        appendUnsigned(record.id, 8);
+        appendBinaryString(record.module);
+        appendBinaryString(record.function);
+        appendUnsigned(record.inputs.size(), 4);
+        for (auto &input: record.inputs) {
+            appendBinaryString(input.first);
+            appendUnsigned((uint64_t) input.second, 8);
+        }
+        appendBinaryStringArray(record.path);
+        appendBinaryStringArray(record.comparisons);
+        appendBinaryString(record.status);
+        appendBinaryStringArray(record.newBlocks);
+        appendUnsigned(record.coveredBlocks, 8);
+
+        uint64_t recordSize = buffer.size() - sizeOffset - 4;
+        for (unsigned i = 0; i < 4; i++) {
+            buffer[sizeOffset + i] = (char) ((recordSize >> (8 * i)) & 0xff);
+        }
+    }
+
+public:
+    /**
+     * @param filename file the records are written to, "-" for the standard output
+     * @param async write full buffers from a background thread
+     */
+    ResultWriter(const std::string &filename, ResultFormat format, bool async = false)
+            : format(format), async(async) {
+        if (format == ResultFormat::Text) {
+            throw std::runtime_error("ResultWriter only writes jsonl and binary results");
+        }
+        if (filename == "-") {
+            file = stdout;
+            ownsFile = false;
+        } else {
+            file = std::fopen(filename.c_str(), "wb");
+            ownsFile = true;
+            if (file == nullptr) {
+                throw std::runtime_error("failed to open \"" + filename + "\" for writing");
+            }
+        }
+
+        start();
+    }
+
+    /**
+     * @brief Writes to an open file, e.g. a socket, that stays open when the writer is closed
+     */
+    ResultWriter(FILE *file, ResultFormat format)
+            : format(format), file(file), ownsFile(false), async(false) {
+        if (format == ResultFormat::Text) {
+            throw std::runtime_error("ResultWriter only writes jsonl and binary results");
+        }
+        start();
+    }
+
+    ResultWriter(const ResultWriter &) = delete;
+
+    ResultWriter &operator=(const ResultWriter &) = delete;
+
+    ~ResultWriter() {
+        try {
+            close();
+        } catch (const std::runtime_error &) {
+            // close reports errors, a destructor can not
+        }
+    }
+
+    void write(const TestRecord &record) {
+        if (format == ResultFormat::Jsonl) {
+            appendJson(record);
+        } else {
+            appendBinary(record);
+        }
+        if (buffer.size() >= BUFFER_CAPACITY) {
+            flushBuffer();
+        }
+    }
+
+    // appends value as a quoted JSON string
+    static void appendJsonString(std::string &out, const std::string &value) {
+        static const char hexDigits[] = "0123456789abcdef";
+        out += '"';
+        for (char c: value) {
+            switch (c) {
+                case '"':
+                    out += "\\\"";
+                    break;
+                case '\\':
+                    out += "\\\\";
+                    break;
+                case '\n':
+                    out += "\\n";
+                    break;
+                case '\t':
+                    out += "\\t";
+                    break;
+                default:
+                    if ((unsigned char) c < 0x20) {
+                        out += "\\u00";
+                        out += hexDigits[(unsigned char) c >> 4];
+                        out += hexDigits[(unsigned char) c & 0xf];
+                    } else {
+                        out += c;
+                    }
+            }
+        }
+        out += '"';
+    }
+
+    /**
+     * @brief Writes out the records so far, for readers that consume the stream while it is written
+     */
+    void flush() {
+        flushBuffer();
+        if (async) {
+            std::unique_lock<std::mutex> lock(mutex);
+            condition.wait(lock, [this] { return !hasPendingBuffer; });
+        }
+        if (std::fflush(file) != 0) {
+            writeFailed = true;
+        }
+    }
+
+    /**
+     * @brief Writes out every record and closes the file
+     *
+     * @throws std::runtime_error if a write failed
+     */
+    void close() {
+        if (file == nullptr) {
+            return;
+        }
+        flushBuffer();
+        if (async) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            condition.notify_all();
+            writerThread.join();
+        }
+        if (std::fflush(file) != 0) {
+            writeFailed = true;
+        }
+        if (ownsFile) {
+            std::fclose(file);
+        }
+        file = nullptr;
+        if (writeFailed) {
+            throw std::runtime_error("failed to write the results");
+        }
+    }
+};
+
+#endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_RESULTWRITER_H
@@ -2,6 +2,7 @@
 #define PHASE_1__RANDOM_TESTING_ON_LLVM_IR_UTILS_H
 
 #include <cstdio>
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <cstdlib>
@@ -12,21 +13,22 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "RandomEngine.h"
+
 using namespace llvm;
 
 int randomInRange(int startOfRange, int endOfRange) {
-    //the random device that will seed the generator
-    std::random_device seeder;
-    //then make a mersenne twister engine
-    std::mt19937 engine(seeder());
-    //then the easy part... the distribution
-    std::uniform_int_distribution<int> dist(startOfRange, endOfRange);
-    //then just generate the integer like this:
-    return dist(engine);
+    return threadRandomEngine().inRange(startOfRange, endOfRange);
+}
+
+// draws from a caller owned engine, e.g. the private stream of a campaign worker
+int randomInRange(RandomEngine &engine, int startOfRange, int endOfRange) {
+    return engine.inRange(startOfRange, endOfRange);
 }
 
 std::string getSimpleNodeName(const Value *node) {
@@ -38,6 +40,16 @@ std::string getSimpleNodeName(const Value *node) {
     return os.str();
 }
 
+// numbers unnamed values with the slot tracker of their function instead of building one for every value
+std::string getSimpleNodeName(const Value *node, ModuleSlotTracker &slotTracker) {
+    if (!node->getName().empty())
+        return node->getName().str();
+    std::string str;
+    raw_string_ostream os(str);
+    node->printAsOperand(os, false, slotTracker);
+    return os.str();
+}
+
 std::set<std::string> getInputArguments(BasicBlock *entryBlock, const std::string &prefix) {
     // get all variables that their variable name starts with "a"
     std::set<std::string> inputArguments;
@@ -52,14 +64,47 @@ std::set<std::string> getInputArguments(BasicBlock *entryBlock, const std::strin
     return inputArguments;
 }
 
-std::map<std::string, int> randomInitialize(std::set<std::string> inputArguments, int minRange, int maxRange) {
-    std::map<std::string, int> variableMap;
+/**
+ * @brief Input variables of a function: the allocas of its entry block whose name starts with prefix, the
+ * allocas its parameters are stored to (e.g. x.addr) and, in optimized code, the integer parameters that are
+ * used directly
+ */
+std::set<std::string> getInputArguments(Function &function, const std::string &prefix) {
+    std::set<std::string> inputArguments = getInputArguments(&function.getEntryBlock(), prefix);
+    std::set<const Argument *> storedArguments;
+    for (auto &I: function.getEntryBlock()) {
+        if (auto *storeInst = dyn_cast<StoreInst>(&I)) {
+            if (isa<Argument>(storeInst->getValueOperand()) && isa<AllocaInst>(storeInst->getPointerOperand())) {
+                inputArguments.insert(getSimpleNodeName(storeInst->getPointerOperand()));
+                storedArguments.insert(dyn_cast<Argument>(storeInst->getValueOperand()));
+            }
+        }
+    }
+    for (auto &argument: function.args()) {
+        if (argument.getType()->isIntegerTy() && storedArguments.count(&argument) == 0) {
+            inputArguments.insert(getSimpleNodeName(&argument));
+        }
+    }
+    return inputArguments;
+}
+
+std::map<std::string, int64_t> randomInitialize(std::set<std::string> inputArguments, int minRange, int maxRange) {
+    std::map<std::string, int64_t> variableMap;
     for (auto &variable: inputArguments) {
         variableMap[variable] = randomInRange(minRange, maxRange);
     }
     return variableMap;
 }
 
+std::map<std::string, int64_t> randomInitialize(const std::set<std::string> &inputArguments, int minRange, int maxRange,
+                                            RandomEngine &engine) {
+    std::map<std::string, int64_t> variableMap;
+    for (auto &variable: inputArguments) {
+        variableMap[variable] = randomInRange(engine, minRange, maxRange);
+    }
+    return variableMap;
+}
+
 std::string cmpPredicateToString(CmpInst::Predicate predicate) {
     switch (predicate) {
         case CmpInst::ICMP_EQ:
@@ -87,6 +132,12 @@ std::string cmpPredicateToString(CmpInst::Predicate predicate) {
     }
 }
 
+// comparison met on a navigated path and its outcome
+struct CmpRecord {
+    ICmpInst *cmpInst;
+    bool result;
+};
+
 std::string CmpInstructionToString(ICmpInst *cmpInst) {
     return "(" +
            getSimpleNodeName(cmpInst->getOperand(0)) + " " +
@@ -95,4 +146,36 @@ std::string CmpInstructionToString(ICmpInst *cmpInst) {
            + ")";
 }
 
+// prints the condition that held on the path, i.e. the inverse predicate when the comparison failed
+std::string CmpRecordToString(const CmpRecord &cmpRecord, ModuleSlotTracker &slotTracker) {
+    auto predicate = cmpRecord.result ? cmpRecord.cmpInst->getPredicate()
+                                      : cmpRecord.cmpInst->getInversePredicate();
+    return "(" +
+           getSimpleNodeName(cmpRecord.cmpInst->getOperand(0), slotTracker) + " " +
+           cmpPredicateToString(predicate) + " " +
+           getSimpleNodeName(cmpRecord.cmpInst->getOperand(1), slotTracker)
+           + ")";
+}
+
+std::string CmpRecordToString(const CmpRecord &cmpRecord) {
+    auto predicate = cmpRecord.result ? cmpRecord.cmpInst->getPredicate()
+                                      : cmpRecord.cmpInst->getInversePredicate();
+    return "(" +
+           getSimpleNodeName(cmpRecord.cmpInst->getOperand(0)) + " " +
+           cmpPredicateToString(predicate) + " " +
+           getSimpleNodeName(cmpRecord.cmpInst->getOperand(1))
+           + ")";
+}
+
+// the first line of a value as the IR printer writes it, like "%e = sext i8 %t to i32", for the errors of values
+// that are not modeled
+std::string valueToString(const Value *value) {
+    std::string text;
+    raw_string_ostream stream(text);
+    value->print(stream);
+    stream.flush();
+    size_t begin = std::min(text.find_first_not_of(' '), text.size());
+    return text.substr(begin, text.find('\n', begin) - begin);
+}
+
 #endif //PHASE_1__RANDOM_TESTING_ON_LLVM_IR_UTILS_H
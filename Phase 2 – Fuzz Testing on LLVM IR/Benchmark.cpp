@@ -0,0 +1,161 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <cstdlib>
+#include <limits>
+#include <random>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Benchmark.h"
+#include "BlockCoverage.h"
+#include "ControlFlowGraph.h"
+#include "GeneticSearch.h"
+#include "ModuleLoader.h"
+#include "PathPool.h"
+#include "PathSampler.h"
+#include "PathVariablesRangeAnalyzer.h"
+#include "ThreadPool.h"
+
+using namespace llvm;
+
+BlockIndex blockIndex;
+PathPool pathPool(blockIndex);
+ControlFlowGraph controlFlowGraph;
+
+static cl::OptionCategory benchmarkCategory("Benchmark options");
+
+static cl::list<std::string> inputFilenames(
+        cl::Positional, cl::desc("<input .ll or .bc files>"), cl::OneOrMore, cl::cat(benchmarkCategory)
+);
+
+static cl::opt<double> minTime(
+        "min-time",
+        cl::desc("Minimum number of seconds the measured round of a benchmark runs"),
+        cl::init(0.5),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<std::string> filter(
+        "filter",
+        cl::desc("Only run the benchmarks whose name contains the text"),
+        cl::value_desc("text"),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<unsigned> workers(
+        "workers",
+        cl::desc("Number of threads of the initial population and the searches"),
+        cl::init(1),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed of the benchmarked paths and searches"),
+        cl::cat(benchmarkCategory)
+);
+
+// the population and rates of the fuzz tester
+static const int CHROMOSOME_COUNT = 100;
+static const int CHROMOSOME_SIZE = 5;
+static const int CROSSOVER_RATE = 85, MUTATION_RATE = 40, PURGE_RATE = 20;
+static const int GENERATIONS = 10;
+
+void benchmarkFunction(BenchmarkRunner &runner, const std::string &input, Function &function) {
+    pathPool.clear();
+    blockIndex.clear();
+    for (auto &BB: function) {
+        blockIndex.add(&BB);
+    }
+
+    controlFlowGraph.build(function, blockIndex);
+    runner.run("ControlFlowGraph::build", input, "", [&] {
+        ControlFlowGraph graph;
+        graph.build(function, blockIndex);
+        return 1;
+    });
+
+    // nothing is covered yet, so coverage sampling has the weights of the first generation
+    PathSampler uniformPathSampler(controlFlowGraph, PathSampling::Uniform);
+    PathSampler coveragePathSampler(controlFlowGraph, PathSampling::Coverage);
+    runner.run("PathSampler::generatePath", input, "sampling=uniform", [&] {
+        return uniformPathSampler.generatePath().size() > 0 ? 1 : 0;
+    });
+    runner.run("PathSampler::generatePath", input, "sampling=coverage", [&] {
+        return coveragePathSampler.generatePath().size() > 0 ? 1 : 0;
+    });
+
+    // analyzed the way the fuzz tester does, from the last block of the path to the entry block
+    std::vector<BasicBlock *> path = uniformPathSampler.generatePath();
+    std::vector<BasicBlock *> reversedPath(path.rbegin(), path.rend());
+    runner.run("PathVariablesRangeAnalyzer::PathVariablesRangeAnalyzer", input,
+               "path=" + std::to_string(reversedPath.size()), [&] {
+                PathVariablesRangeAnalyzer analyzer(reversedPath, -20, 20, nulls());
+                return 1;
+            });
+
+    ThreadPool threadPool(workers);
+    threadRandomEngine() = RandomEngine(getMasterSeed(), 0);
+    Chromosome chromosome = Chromosome::createInitialPopulation(1, CHROMOSOME_SIZE, coveragePathSampler,
+                                                                threadPool)[0];
+    runner.run("Chromosome::computeFitness", input, "paths=" + std::to_string(CHROMOSOME_SIZE), [&] {
+        return chromosome.computeFitness() >= 0 ? 1 : 0;
+    });
+
+    std::string populationParameter = "chromosomes=" + std::to_string(CHROMOSOME_COUNT) + ",paths=" +
+                                      std::to_string(CHROMOSOME_SIZE) + ",workers=" + std::to_string(workers);
+    runner.run("Chromosome::createInitialPopulation", input, populationParameter, [&] {
+        Chromosome::createInitialPopulation(CHROMOSOME_COUNT, CHROMOSOME_SIZE, coveragePathSampler, threadPool);
+        return 1;
+    });
+
+    // every search starts from the same population and random state, an operation is one generation; the goal
+    // score is never reached, so a search always runs every generation
+    threadRandomEngine() = RandomEngine(getMasterSeed(), 0);
+    std::vector<Chromosome> initialPopulation = Chromosome::createInitialPopulation(CHROMOSOME_COUNT, CHROMOSOME_SIZE,
+                                                                                    coveragePathSampler, threadPool);
+    runner.run("GeneticSearch::run", input, populationParameter + ",generations=" + std::to_string(GENERATIONS), [&] {
+        threadRandomEngine() = RandomEngine(getMasterSeed(), 1);
+        GeneticSearch geneticSearch(initialPopulation, CROSSOVER_RATE, MUTATION_RATE, PURGE_RATE, threadPool);
+        geneticSearch.run(std::numeric_limits<double>::quiet_NaN(), GENERATIONS, nulls());
+        return GENERATIONS;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(benchmarkCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Benchmarks of the fuzz tester\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
+
+    BenchmarkRunner runner(minTime, filter, outs());
+    for (auto &inputFilename: inputFilenames) {
+        LLVMContext context;
+        ModuleLoader moduleLoader;
+        std::unique_ptr<Module> M;
+        Function *mainFunction;
+        try {
+            M = moduleLoader.load(inputFilename, context);
+            mainFunction = M->getFunction("main");
+            if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+                fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+                return EXIT_FAILURE;
+            }
+            moduleLoader.materialize(*mainFunction);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+
+        benchmarkFunction(runner, inputFilename, *mainFunction);
+    }
+    return 0;
+}
@@ -0,0 +1,119 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_BLOCKCOVERAGE_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_BLOCKCOVERAGE_H
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MathExtras.h"
+
+using namespace llvm;
+
+/**
+ * @brief Set of block ids, one bit per block
+ *
+ * Every bitset of a module has one word per 64 blocks, so the union of the coverage of several paths is a
+ * word-wise OR (vectorized by the compiler) and the number of covered blocks a popcount.
+ */
+class CoverageBitset {
+private:
+    std::vector<uint64_t> words;
+
+public:
+    CoverageBitset() = default;
+
+    explicit CoverageBitset(unsigned blockCount) : words((blockCount + 63) / 64) {}
+
+    void set(unsigned id) {
+        words[id / 64] |= uint64_t(1) << (id % 64);
+    }
+
+    bool test(unsigned id) const {
+        return (words[id / 64] >> (id % 64)) & 1;
+    }
+
+    void clear() {
+        std::fill(words.begin(), words.end(), 0);
+    }
+
+    // both bitsets must be of the same block index
+    CoverageBitset &operator|=(const CoverageBitset &other) {
+        uint64_t *dst = words.data();
+        const uint64_t *src = other.words.data();
+        for (size_t i = 0, n = words.size(); i < n; i++) {
+            dst[i] |= src[i];
+        }
+        return *this;
+    }
+
+    unsigned count() const {
+        unsigned count = 0;
+        for (uint64_t word: words) {
+            count += countPopulation(word);
+        }
+        return count;
+    }
+};
+
+/**
+ * @brief Dense ids 0..size()-1 of the basic blocks, in the order they are added
+ */
+class BlockIndex {
+private:
+    DenseMap<const BasicBlock *, unsigned> idOf;
+    std::vector<BasicBlock *> blocks;
+
+public:
+    // a block that is added again keeps its id
+    unsigned add(BasicBlock *basicBlock) {
+        auto inserted = idOf.insert({basicBlock, (unsigned) blocks.size()});
+        if (inserted.second) {
+            blocks.push_back(basicBlock);
+        }
+        return inserted.first->second;
+    }
+
+    // functions that were not materialized have no blocks
+    void addModule(Module &module) {
+        for (auto &F: module) {
+            for (auto &BB: F) {
+                add(&BB);
+            }
+        }
+    }
+
+    void clear() {
+        idOf.clear();
+        blocks.clear();
+    }
+
+    unsigned getId(const BasicBlock *basicBlock) const {
+        return idOf.lookup(basicBlock);
+    }
+
+    BasicBlock *getBlock(unsigned id) const {
+        return blocks[id];
+    }
+
+    unsigned size() const {
+        return blocks.size();
+    }
+
+    /**
+     * @brief The blocks of a path as a bitset, every block of the path must have been added
+     */
+    CoverageBitset getCoverage(const std::vector<BasicBlock *> &path) const {
+        CoverageBitset coverage(size());
+        for (auto *basicBlock: path) {
+            coverage.set(getId(basicBlock));
+        }
+        return coverage;
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_BLOCKCOVERAGE_H
@@ -0,0 +1,186 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_CONTROLFLOWGRAPH_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_CONTROLFLOWGRAPH_H
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "llvm/ADT/DenseMap.h"
+#include "llvm/ADT/SCCIterator.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/IR/CFG.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instruction.h"
+
+#include "BlockCoverage.h"
+
+using namespace llvm;
+
+/**
+ * @brief Control flow graph of a function in compressed sparse row form, built once and then only read
+ *
+ * The blocks reachable from the entry block get dense ids, component by component in topological order of the
+ * strongly connected components, so the blocks of component c are the ids [getComponentBegin(c),
+ * getComponentEnd(c)). The successors of block b are the slots [getSuccessorOffset(b), getSuccessorOffset(b) +
+ * getSuccessorCount(b)) of one array, in the order of its terminator, the predecessors likewise, so a random walk
+ * reads two arrays instead of chasing the terminators of the blocks.
+ *
+ * Every component also has the set of blocks reachable from it, one bit per block of the function, which is what
+ * the coverage-biased sampling of PathSampler counts uncovered blocks with.
+ */
+class ControlFlowGraph {
+private:
+    std::vector<BasicBlock *> blocks;
+    // ids of the blocks in the BlockIndex
+    std::vector<unsigned> blockIds;
+    unsigned entry = 0;
+
+    std::vector<unsigned> successorOffsets;
+    std::vector<unsigned> successors;
+    std::vector<unsigned> predecessorOffsets;
+    std::vector<unsigned> predecessors;
+
+    std::vector<unsigned> componentOf;
+    std::vector<unsigned> componentOffsets;
+    // blocks reachable from a block of the component, its own blocks included
+    std::vector<CoverageBitset> reachableBlocks;
+
+public:
+    /**
+     * @brief Builds the graph of the blocks of function reachable from its entry block
+     * @param blockIndex must have every block of the function, its ids must not change while the graph is used
+     */
+    void build(Function &function, const BlockIndex &blockIndex) {
+        // scc_iterator gives the components successors first, ids are given in the reverse order
+        std::vector<std::vector<BasicBlock *>> components;
+        for (auto it = scc_begin(&function); !it.isAtEnd(); ++it) {
+            components.push_back(*it);
+        }
+        std::reverse(components.begin(), components.end());
+
+        DenseMap<const BasicBlock *, unsigned> idOf;
+        blocks.clear();
+        componentOf.clear();
+        componentOffsets.assign(1, 0);
+        for (unsigned component = 0; component < components.size(); component++) {
+            for (auto *basicBlock: components[component]) {
+                idOf[basicBlock] = blocks.size();
+                blocks.push_back(basicBlock);
+                componentOf.push_back(component);
+            }
+            componentOffsets.push_back(blocks.size());
+        }
+        entry = idOf.lookup(&function.getEntryBlock());
+
+        blockIds.clear();
+        successorOffsets.assign(1, 0);
+        successors.clear();
+        std::vector<unsigned> predecessorCounts(blocks.size() + 1);
+        for (auto *basicBlock: blocks) {
+            blockIds.push_back(blockIndex.getId(basicBlock));
+            Instruction *terminatorInst = basicBlock->getTerminator();
+            for (unsigned i = 0, n = terminatorInst->getNumSuccessors(); i < n; i++) {
+                unsigned successor = idOf.lookup(terminatorInst->getSuccessor(i));
+                successors.push_back(successor);
+                predecessorCounts[successor + 1]++;
+            }
+            successorOffsets.push_back(successors.size());
+        }
+
+        predecessorOffsets.assign(blocks.size() + 1, 0);
+        for (unsigned block = 0; block < blocks.size(); block++) {
+            predecessorOffsets[block + 1] = predecessorOffsets[block] + predecessorCounts[block + 1];
+        }
+        predecessors.assign(successors.size(), 0);
+        std::vector<unsigned> nextPredecessor(predecessorOffsets.begin(), predecessorOffsets.end() - 1);
+        for (unsigned block = 0; block < blocks.size(); block++) {
+            for (unsigned slot = successorOffsets[block]; slot < successorOffsets[block + 1]; slot++) {
+                predecessors[nextPredecessor[successors[slot]]++] = block;
+            }
+        }
+
+        // the successors of a component are after it, so they are done first
+        reachableBlocks.assign(components.size(), CoverageBitset(blocks.size()));
+        for (unsigned component = components.size(); component-- > 0;) {
+            CoverageBitset &reachable = reachableBlocks[component];
+            for (unsigned block = componentOffsets[component]; block < componentOffsets[component + 1]; block++) {
+                reachable.set(block);
+                for (unsigned slot = successorOffsets[block]; slot < successorOffsets[block + 1]; slot++) {
+                    unsigned successorComponent = componentOf[successors[slot]];
+                    if (successorComponent != component) {
+                        reachable |= reachableBlocks[successorComponent];
+                    }
+                }
+            }
+        }
+    }
+
+    unsigned size() const {
+        return blocks.size();
+    }
+
+    unsigned getEntry() const {
+        return entry;
+    }
+
+    BasicBlock *getBlock(unsigned block) const {
+        return blocks[block];
+    }
+
+    // id of the block in the BlockIndex
+    unsigned getBlockId(unsigned block) const {
+        return blockIds[block];
+    }
+
+    unsigned getSuccessorOffset(unsigned block) const {
+        return successorOffsets[block];
+    }
+
+    unsigned getSuccessorCount(unsigned block) const {
+        return successorOffsets[block + 1] - successorOffsets[block];
+    }
+
+    // total number of successor slots of all blocks
+    unsigned getSuccessorSlotCount() const {
+        return successors.size();
+    }
+
+    unsigned getSuccessor(unsigned slot) const {
+        return successors[slot];
+    }
+
+    unsigned getPredecessorOffset(unsigned block) const {
+        return predecessorOffsets[block];
+    }
+
+    unsigned getPredecessorCount(unsigned block) const {
+        return predecessorOffsets[block + 1] - predecessorOffsets[block];
+    }
+
+    unsigned getPredecessor(unsigned slot) const {
+        return predecessors[slot];
+    }
+
+    unsigned getComponentCount() const {
+        return reachableBlocks.size();
+    }
+
+    unsigned getComponent(unsigned block) const {
+        return componentOf[block];
+    }
+
+    unsigned getComponentBegin(unsigned component) const {
+        return componentOffsets[component];
+    }
+
+    unsigned getComponentEnd(unsigned component) const {
+        return componentOffsets[component + 1];
+    }
+
+    const CoverageBitset &getReachableBlocks(unsigned component) const {
+        return reachableBlocks[component];
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_CONTROLFLOWGRAPH_H
@@ -3,6 +3,7 @@
 #include <set>
 #include <cstdlib>
 #include <random>
+#include <thread>
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -12,14 +13,223 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/Format.h"
 
+#include "BlockCoverage.h"
+#include "ControlFlowGraph.h"
 #include "GeneticSearch.h"
+#include "Instrumentation.h"
+#include "IslandSearch.h"
+#include "ModuleLoader.h"
+#include "PathPool.h"
+#include "PathSampler.h"
 #include "PathVariablesRangeAnalyzer.h"
+#include "ResultWriter.h"
+#include "ThreadPool.h"
 
 using namespace llvm;
 
 BasicBlock *mainBasicBlock;
-std::set<BasicBlock *> allBlocks;
+BlockIndex blockIndex;
+PathPool pathPool(blockIndex);
+ControlFlowGraph controlFlowGraph;
+
+static cl::OptionCategory fuzzTesterCategory("Fuzz tester options");
+
+static cl::opt<std::string> inputFilename(
+        cl::Positional, cl::desc("<input .ll file>"), cl::Required, cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed, the seed of every run is printed so it can be replayed"),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> workers(
+        "workers",
+        cl::desc("Number of threads that breed, mutate and evaluate the population, the result of a seed does not "
+                 "depend on it (default: all hardware threads)"),
+        cl::init(std::thread::hardware_concurrency()),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<SelectionStrategy> selection(
+        "selection",
+        cl::desc("How the parents of a generation are selected"),
+        cl::values(
+                clEnumValN(SelectionStrategy::Tournament, "tournament",
+                           "The fittest of --tournament-size random chromosomes (default)"),
+                clEnumValN(SelectionStrategy::Rank, "rank", "With a probability proportional to the fitness rank"),
+                clEnumValN(SelectionStrategy::Roulette, "roulette", "With a probability proportional to the fitness"),
+                clEnumValN(SelectionStrategy::Uniform, "uniform", "Every chromosome with a probability of 1/2")
+        ),
+        cl::init(SelectionStrategy::Tournament),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> tournamentSize(
+        "tournament-size",
+        cl::desc("Chromosomes of a tournament of --selection=tournament"),
+        cl::init(2),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<SurvivorStrategy> survivors(
+        "survivors",
+        cl::desc("Which chromosomes survive a generation"),
+        cl::values(
+                clEnumValN(SurvivorStrategy::Truncation, "truncation",
+                           "The --population-size fittest, after every generation (default)"),
+                clEnumValN(SurvivorStrategy::Average, "average",
+                           "Those not below the average fitness, after a purge with the purge rate")
+        ),
+        cl::init(SurvivorStrategy::Truncation),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> populationSize(
+        "population-size",
+        cl::desc("Chromosomes of the initial population, and of every generation with --survivors=truncation"),
+        cl::init(100),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> elitism(
+        "elitism",
+        cl::desc("Fittest chromosomes of a generation that are never mutated"),
+        cl::init(1),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<PathSampling> pathSampling(
+        "path-sampling",
+        cl::desc("How the random paths choose the successor of a branch"),
+        cl::values(
+                clEnumValN(PathSampling::Coverage, "coverage",
+                           "Favor the successors that reach blocks the population did not cover (default)"),
+                clEnumValN(PathSampling::Uniform, "uniform", "Every successor with the same probability")
+        ),
+        cl::init(PathSampling::Coverage),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> islands(
+        "islands",
+        cl::desc("Number of populations that evolve apart and exchange their best chromosomes (default: 1, a single "
+                 "genetic search)"),
+        cl::init(1),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::list<std::string> islandRates(
+        "island-rates",
+        cl::desc("Crossover, mutation and purge rates of the islands in order, islands without an entry use 85:40:20"),
+        cl::value_desc("crossover:mutation:purge,..."),
+        cl::CommaSeparated,
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<int> migrationInterval(
+        "migration-interval",
+        cl::desc("Generations between two migrations of the islands"),
+        cl::init(5),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<unsigned> migrants(
+        "migrants",
+        cl::desc("Best chromosomes an island sends to each island it is connected to at a migration"),
+        cl::init(2),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<MigrationTopology> topology(
+        "topology",
+        cl::desc("Islands every island receives migrants from"),
+        cl::values(
+                clEnumValN(MigrationTopology::Ring, "ring", "The previous island (default)"),
+                clEnumValN(MigrationTopology::FullyConnected, "full", "Every other island")
+        ),
+        cl::init(MigrationTopology::Ring),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<bool> printStats(
+        "print-stats",
+        cl::desc("Print the module load time and, in a build with INSTRUMENTATION, the timers, counters and "
+                 "histograms of the hot paths"),
+        cl::init(false),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<bool> materializeAll(
+        "materialize-all",
+        cl::desc("Read every function of a bitcode input, not only those reachable from main"),
+        cl::init(false),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<ResultFormat> outputFormat(
+        "output-format",
+        cl::desc("Format of the generated tests"),
+        cl::values(
+                clEnumValN(ResultFormat::Text, "text", "Banner-delimited text (default)"),
+                clEnumValN(ResultFormat::Jsonl, "jsonl", "One JSON object per test"),
+                clEnumValN(ResultFormat::Binary, "binary", "Length-prefixed binary records")
+        ),
+        cl::init(ResultFormat::Text),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<std::string> outputFilename(
+        "output",
+        cl::desc("File the jsonl or binary tests are written to (default: standard output)"),
+        cl::value_desc("filename"),
+        cl::init("-"),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<bool> asyncOutput(
+        "async-output",
+        cl::desc("Write jsonl or binary tests from a background thread"),
+        cl::init(false),
+        cl::cat(fuzzTesterCategory)
+);
+
+static cl::opt<std::string> traceFilename(
+        "trace",
+        cl::desc("Write the timed scopes of the hot paths as a Chrome trace (needs a build with INSTRUMENTATION)"),
+        cl::value_desc("filename"),
+        cl::cat(fuzzTesterCategory)
+);
+
+// the chromosomes and rates of the genetic search
+static const int CHROMOSOME_SIZE = 5;
+static const IslandRates DEFAULT_RATES = {85, 40, 20};
+static const double GOAL_SCORE = 1000;
+static const int MAX_GENERATION_NUMBER = 50;
+
+/**
+ * @brief Rates of every island, from --island-rates
+ * @throws std::runtime_error if an entry is not three rates separated by colons
+ */
+std::vector<IslandRates> getIslandRates() {
+    if (islandRates.size() > islands) {
+        throw std::runtime_error("--island-rates has more entries than --islands");
+    }
+    std::vector<IslandRates> rates(islands, DEFAULT_RATES);
+    for (size_t i = 0; i < islandRates.size(); i++) {
+        char rest;
+        if (sscanf(islandRates[i].c_str(), "%d:%d:%d%c", &rates[i].crossoverRate, &rates[i].mutationRate,
+                   &rates[i].purgeRate, &rest) != 3) {
+            throw std::runtime_error("invalid island rates \"" + islandRates[i] +
+                                     "\", expected crossover:mutation:purge");
+        }
+    }
+    return rates;
+}
 
 LLVMContext &getGlobalContext() {
     static LLVMContext context;
@@ -27,23 +237,72 @@ LLVMContext &getGlobalContext() {
 }
 
 int main(int argc, char *argv[]) {
-    // Read the IR file.
+    cl::HideUnrelatedOptions(fuzzTesterCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Genetic fuzz tester for LLVM IR\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
+
+    if (islands == 0 || migrationInterval <= 0 || populationSize == 0 || tournamentSize == 0) {
+        fprintf(stderr, "error: --islands, --migration-interval, --population-size and --tournament-size must be "
+                        "positive\n");
+        return EXIT_FAILURE;
+    }
+    std::vector<IslandRates> rates;
+    try {
+        rates = getIslandRates();
+    } catch (const std::runtime_error &error) {
+        fprintf(stderr, "error: %s\n", error.what());
+        return EXIT_FAILURE;
+    }
+
+    if (!traceFilename.empty()) {
+        if (!Instrumentation::ENABLED) {
+            fprintf(stderr, "error: --trace needs a build with INSTRUMENTATION defined\n");
+            return EXIT_FAILURE;
+        }
+        Instrumentation::get().setTracing(true);
+    }
+
+    // Read the IR file, a bitcode file only up to the functions main reaches.
     LLVMContext & context = getGlobalContext();
-    SMDiagnostic err;
-    std::unique_ptr<Module> M = parseIRFile(argv[1], err, context);
-    if (M == nullptr) {
-        fprintf(stderr, "error: failed to load LLVM IR file \"%s\"", argv[1]);
+    ModuleLoader moduleLoader(materializeAll);
+    std::unique_ptr<Module> M;
+    try {
+        M = moduleLoader.load(inputFilename, context);
+        Function *mainFunction = M->getFunction("main");
+        if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+            fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+            return EXIT_FAILURE;
+        }
+        moduleLoader.materialize(*mainFunction);
+    } catch (const std::runtime_error &error) {
+        fprintf(stderr, "error: %s\n", error.what());
         return EXIT_FAILURE;
     }
 
-    // find all blocks and store them in a set
-    for (auto &F: *M) {
-        for (auto &BB: F) {
-            allBlocks.insert(&BB);
+    if (outputFormat == ResultFormat::Text && outputFilename != "-") {
+        fprintf(stderr, "error: --output needs --output-format=jsonl or --output-format=binary\n");
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<ResultWriter> resultWriter;
+    if (outputFormat != ResultFormat::Text) {
+        try {
+            resultWriter = std::make_unique<ResultWriter>(outputFilename, outputFormat, asyncOutput);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
         }
     }
+    // with a structured format the output only has tests, summaries go to stderr
+    raw_ostream &summaryStream = resultWriter != nullptr ? errs() : outs();
 
-    llvm::outs() << "All blocks:" << allBlocks.size() << "\n";
+    // give every block of the module an id, functions that were not materialized have none
+    blockIndex.addModule(*M);
+
+    summaryStream << "All blocks:" << blockIndex.size() << "\n";
 
     // initial mainBasicBlock
     for (auto &F: *M) {
@@ -52,15 +311,44 @@ int main(int argc, char *argv[]) {
             break;
         }
     }
+    controlFlowGraph.build(*mainBasicBlock->getParent(), blockIndex);
+
+    SelectionOptions selectionOptions;
+    selectionOptions.selection = selection;
+    selectionOptions.tournamentSize = tournamentSize;
+    selectionOptions.survivors = survivors;
+    selectionOptions.populationSize = populationSize;
+    selectionOptions.elitism = elitism;
 
-    GeneticSearch geneticSearch(Chromosome::createInitialPopulation(100, 5),
-                                85,
-                                40,
-                                20
-    );
-    Chromosome bestChromosome = geneticSearch.run(1000, 50);
+    std::unique_ptr<Chromosome> bestChromosome;
+    if (islands > 1) {
+        IslandOptions islandOptions{rates, selectionOptions, (int) populationSize, CHROMOSOME_SIZE, migrationInterval,
+                                    migrants, topology, pathSampling, workers};
+        IslandSearch islandSearch(islandOptions);
+        bestChromosome = std::make_unique<Chromosome>(
+                islandSearch.run(GOAL_SCORE, MAX_GENERATION_NUMBER, summaryStream));
+    } else {
+        ThreadPool threadPool(workers);
+        PathSampler initialPathSampler(controlFlowGraph, pathSampling);
+        GeneticSearch geneticSearch(Chromosome::createInitialPopulation(populationSize, CHROMOSOME_SIZE,
+                                                                        initialPathSampler, threadPool),
+                                    rates[0].crossoverRate,
+                                    rates[0].mutationRate,
+                                    rates[0].purgeRate,
+                                    threadPool,
+                                    selectionOptions,
+                                    pathSampling
+        );
+        bestChromosome = std::make_unique<Chromosome>(
+                geneticSearch.run(GOAL_SCORE, MAX_GENERATION_NUMBER, summaryStream));
+    }
 
-    for (auto path: bestChromosome.getPathList()) {
+    TestRecord testRecord;
+    testRecord.module = M->getModuleIdentifier();
+    testRecord.function = "main";
+    std::set<BasicBlock *> coveredBlocks;
+    for (unsigned pathId: bestChromosome->getPathIds()) {
+        const std::vector<BasicBlock *> &path = pathPool.getPath(pathId);
 
         // reverse path and pass it to calculateVariableRanges
         std::vector<BasicBlock *> reversedPath;
@@ -69,9 +357,31 @@ int main(int argc, char *argv[]) {
         }
 
         auto rangeVariableMap =
-                PathVariablesRangeAnalyzer(reversedPath, -20, 20)
+                PathVariablesRangeAnalyzer(reversedPath, -20, 20, summaryStream)
                         .getVariablesRangeMap();
 
+        if (resultWriter != nullptr) {
+            // one test per path, with a random value in the range of each variable
+            testRecord.clear();
+            for (auto &it: rangeVariableMap) {
+                if (it.second.empty()) {
+                    continue;
+                }
+                unsigned rnd = randomInRange(0, it.second.size() - 1);
+                testRecord.inputs.emplace_back(it.first, *std::next(it.second.begin(), rnd));
+            }
+            for (auto &basicBlock: path) {
+                testRecord.path.push_back(getSimpleNodeName(basicBlock));
+                if (coveredBlocks.insert(basicBlock).second) {
+                    testRecord.newBlocks.push_back(testRecord.path.back());
+                }
+            }
+            testRecord.coveredBlocks = coveredBlocks.size();
+            resultWriter->write(testRecord);
+            testRecord.id++;
+            continue;
+        }
+
         outs() << "************** Path **************" << "\n";
         for (auto &basicBlock: path) {
             outs() << getSimpleNodeName(basicBlock) << "\n";
@@ -81,11 +391,11 @@ int main(int argc, char *argv[]) {
 
         // print data of variablesRangeMap
         for (auto &it: rangeVariableMap) {
-            std::cout << it.first << ": ";
+            outs() << it.first << ": ";
             for (auto &i: it.second) {
-                std::cout << i << " ";
+                outs() << i << " ";
             }
-            std::cout << "\n";
+            outs() << "\n";
         }
 
         outs() << "======= Random Test Output =======" << "\n";
@@ -100,6 +410,31 @@ int main(int argc, char *argv[]) {
         }
     }
 
+    if (printStats) {
+        summaryStream << "******************* Startup ********************" << "\n";
+        summaryStream << "Module load: " << format("%.3f", moduleLoader.getLoadSeconds() * 1000) << " ms\n";
+        summaryStream << "Materialized functions: " << ModuleLoader::getMaterializedFunctionCount(*M) << "/"
+                      << ModuleLoader::getDefinedFunctionCount(*M) << "\n";
+        Instrumentation::get().printSummary(summaryStream);
+    }
+    if (!traceFilename.empty()) {
+        try {
+            Instrumentation::get().writeTrace(traceFilename);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
+
+    if (resultWriter != nullptr) {
+        try {
+            resultWriter->close();
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
+
     return 0;
 }
 
@@ -7,6 +7,8 @@
 #include <iostream>
 #include <cstdlib>
 #include <ctime>
+#include <algorithm>
+#include <iterator>
 #include <random>
 #include <utility>
 
@@ -19,174 +21,300 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
-#include "RandomPath.h"
+#include "BlockCoverage.h"
+#include "ControlFlowGraph.h"
+#include "Instrumentation.h"
+#include "PathPool.h"
+#include "PathSampler.h"
+#include "Selection.h"
+#include "ThreadPool.h"
 #include "Utils.h"
 
 using namespace llvm;
 
-extern BasicBlock *mainBasicBlock;
-extern std::set<BasicBlock *> allBlocks;
+extern ControlFlowGraph controlFlowGraph;
+extern BlockIndex blockIndex;
+extern PathPool pathPool;
+
+/**
+ * @brief Runs task(i) for every i in [0, count) on the thread pool
+ *
+ * Task i draws its random numbers from RandomEngine(seed, i), with a seed drawn from the engine of the calling
+ * thread, so the results only depend on the master seed and not on the number of threads or which thread runs a
+ * task. The engine of the calling thread is restored afterwards.
+ */
+template<typename Task>
+void runRandomTasks(ThreadPool &threadPool, size_t count, const Task &task) {
+    RandomEngine &callerEngine = threadRandomEngine();
+    uint64_t seed = callerEngine.next();
+    RandomEngine savedEngine = callerEngine;
+    threadPool.parallelFor(count, [&](size_t i) {
+        threadRandomEngine() = RandomEngine(seed, i);
+        task(i);
+    });
+    threadRandomEngine() = savedEngine;
+}
 
 class Chromosome {
 private:
-    std::vector<std::vector<BasicBlock *>> pathList;
-
-    static std::vector<std::vector<BasicBlock *>> selectRandomNumberOfPaths(const Chromosome *chromosome) {
-        std::vector<std::vector<BasicBlock *>> newPathList;
-        for (const auto &path: chromosome->pathList) {
+    // ids of the paths in pathPool, a path can be in the list more than once
+    std::vector<unsigned> pathIds;
+    // computed by the first getFitness, until mutate changes the path list
+    mutable double fitness = 0;
+    mutable bool isFitnessValid = false;
+
+    // adds every path of the chromosome with a probability of 1/2
+    void addRandomNumberOfPaths(const Chromosome *chromosome) {
+        for (unsigned pathId: chromosome->pathIds) {
             if (randomInRange(0, 1)) {
-                newPathList.push_back(path);
+                pathIds.push_back(pathId);
             }
         }
-        return newPathList;
     }
 
 public:
-    Chromosome(std::vector<std::vector<BasicBlock *>> _pathList) {
-        // copy pathList to this pathList
-        for (const auto &path: _pathList) {
-            std::vector<BasicBlock *> newPath;
-
-            for (const auto &basicBlock: path) {
-                newPath.push_back(basicBlock);
-            }
+    explicit Chromosome(std::vector<unsigned> pathIds) : pathIds(std::move(pathIds)) {}
 
-            pathList.push_back(newPath);
-        }
+    const std::vector<unsigned> &getPathIds() const {
+        return pathIds;
     }
 
-    const std::vector<std::vector<BasicBlock *>> &getPathList() const {
-        return pathList;
+    double getFitness() const {
+        if (!isFitnessValid) {
+            fitness = computeFitness();
+            isFitnessValid = true;
+        }
+        return fitness;
     }
 
-    double getFitness() const {
+    double computeFitness() const {
+        INSTRUMENT_COUNT("Chromosome::computeFitness", 1);
         // for better score:
         // 1. code coverage should be max
         // 2. pathList size should be min
-        std::set<BasicBlock *> allBlocksInPathList;
-        for (const auto &path: pathList) {
-            for (const auto &block: path) {
-                allBlocksInPathList.insert(block);
-            }
+        CoverageBitset coveredBlocks(blockIndex.size());
+        for (unsigned pathId: pathIds) {
+            coveredBlocks |= pathPool.getCoverage(pathId);
         }
-        double pathListCoverage = ((double) allBlocksInPathList.size() / allBlocks.size()) * 100;
-        // print path list
-
-
-//        std::cout << "AA " << std::endl;
-//        std::cout << "SIZE: " << pathList.size() << std::endl;
-
-        return pathListCoverage + allBlocks.size() - pathList.size();
-//        return  pathListCoverage;
+        double pathListCoverage = ((double) coveredBlocks.count() / blockIndex.size()) * 100;
+        return pathListCoverage + blockIndex.size() - pathIds.size();
     }
 
-    Chromosome *crossover(Chromosome *other) const {
+    /**
+     * @brief Replaces the paths of child with a random number of paths of this and other
+     *
+     * The child keeps the capacity of its path list, so a recycled chromosome is usually filled without allocating.
+     */
+    void crossover(const Chromosome &other, Chromosome &child) const {
+        child.pathIds.clear();
+        child.isFitnessValid = false;
         // merge random number of path from this and other
-        auto r1 = selectRandomNumberOfPaths(this);
-        auto r2 = selectRandomNumberOfPaths(other);
-
-
-        // merge r1 and r2
-        std::vector<std::vector<BasicBlock *>> newPathList;
-        for (const auto path: r1) {
-            newPathList.push_back(path);
-        }
-        for (const auto path: r2) {
-            newPathList.push_back(path);
-        }
-
-        return new Chromosome(newPathList);
+        child.addRandomNumberOfPaths(this);
+        child.addRandomNumberOfPaths(&other);
     }
 
-    void mutate() {
+    // new paths are drawn from pathSampler
+    void mutate(const PathSampler &pathSampler) {
+        isFitnessValid = false;
         // add random number of new paths or delete random number of paths
         int mutationType = randomInRange(0, 1);
         if (mutationType == 0) {
             // add new paths
-            int newPathsCount = randomInRange(0, pathList.size());
+            int newPathsCount = randomInRange(0, pathIds.size());
             for (int i = 0; i < newPathsCount; i++) {
-                std::vector<BasicBlock *> newPath = generateRandomPath(mainBasicBlock);
-                pathList.push_back(newPath);
+                pathIds.push_back(pathPool.intern(pathSampler.generatePath()));
             }
         } else {
             // delete paths
-            int deletePathsCount = randomInRange(0, pathList.size());
+            int deletePathsCount = randomInRange(0, pathIds.size());
             for (int i = 0; i < deletePathsCount; i++) {
-                int deletePathIndex = randomInRange(0, pathList.size());
-                pathList.erase(pathList.begin() + deletePathIndex);
+                // an index of pathIds.size() deletes the last path
+                int deletePathIndex = std::min<int>(randomInRange(0, pathIds.size()), pathIds.size() - 1);
+                pathIds.erase(pathIds.begin() + deletePathIndex);
             }
         }
     }
 
-    static std::vector<Chromosome> createInitialPopulation(int chromosomeCount, int chromosomeSize) {
-        std::vector<Chromosome> population;
-        for (int i = 0; i < chromosomeCount; i++) {
-            std::vector<std::vector<BasicBlock *>> pathList;
+    // the chromosomes are generated in parallel
+    static std::vector<Chromosome> createInitialPopulation(int chromosomeCount, int chromosomeSize,
+                                                           const PathSampler &pathSampler, ThreadPool &threadPool) {
+        std::vector<std::vector<unsigned>> pathIdsList(chromosomeCount);
+        runRandomTasks(threadPool, chromosomeCount, [&](size_t i) {
             for (int j = 0; j < chromosomeSize; j++) {
-                std::vector<BasicBlock *> path = generateRandomPath(mainBasicBlock);
-                pathList.push_back(path);
+                pathIdsList[i].push_back(pathPool.intern(pathSampler.generatePath()));
             }
-            population.emplace_back(pathList);
+        });
+        std::vector<Chromosome> population;
+        for (auto &pathIds: pathIdsList) {
+            population.emplace_back(std::move(pathIds));
         }
         return population;
     }
 };
 
+/**
+ * @brief Genetic search of a chromosome with a high fitness
+ *
+ * How parents are selected and which chromosomes survive a generation is set by the SelectionOptions, uniform
+ * selection and average survivors are the original search, where the population size drifts.
+ *
+ * The random choices of a generation that change the population (which chromosomes are selected, how many
+ * offspring there are, which chromosomes mutate) are made on the calling thread. The work they lead to (breeding
+ * the offspring, mutating and the random paths it generates, evaluating the fitness) runs on the thread pool with
+ * runRandomTasks, so a search gives the same result for a seed with any number of threads.
+ *
+ * The population is one vector that keeps its capacity between generations. Chromosomes removed by a purge or a
+ * truncation are kept with their path lists as spare chromosomes, offspring are bred into them, so once the
+ * population stops growing a generation allocates no chromosome.
+ */
 class GeneticSearch {
 private:
     std::vector<Chromosome> population;
     int crossoverRate;
     int mutationRate;
     int purgeRate;
-
-    std::vector<Chromosome> getRandomCountOfSelectedPopulation(std::vector<Chromosome> selectedPopulation) {
-        std::vector<Chromosome> result;
+    ThreadPool &threadPool;
+    SelectionOptions selectionOptions;
+    // random paths of the mutations, biased away from the blocks the population covered so far
+    PathSampler pathSampler;
+    // removed chromosomes whose path lists are reused by the offspring
+    std::vector<Chromosome> spareChromosomes;
+    // best chromosome of all generations, set by start
+    Chromosome bestScoreElement = Chromosome(std::vector<unsigned>());
+
+    std::vector<double> getFitnessList() const {
+        std::vector<double> fitnessList;
         for (const auto &p: population) {
-            if (randomInRange(0, 1)) {
-                result.push_back(p);
-            }
+            fitnessList.push_back(p.getFitness());
         }
-        return result;
+        return fitnessList;
     }
 
     static bool probabilityToHappen(int rate) {
         return randomInRange(0, 100) < rate;
     }
 
-    Chromosome findBestScoreElement() {
-        Chromosome bestScoreElement = population[0];
-        for (auto &element: population) {
-            if (element.getFitness() > bestScoreElement.getFitness()) {
-                bestScoreElement = element;
+    // computes the fitness of every chromosome that changed, in parallel
+    void evaluateFitness() {
+        INSTRUMENT_SCOPE("GeneticSearch::evaluateFitness");
+        threadPool.parallelFor(population.size(), [&](size_t i) {
+            population[i].getFitness();
+        });
+    }
+
+    // index of the first chromosome with the best fitness of the population
+    size_t findBestScoreElement() const {
+        INSTRUMENT_SCOPE("GeneticSearch::findBestScoreElement");
+        size_t bestIndex = 0;
+        for (size_t i = 1; i < population.size(); i++) {
+            if (population[i].getFitness() > population[bestIndex].getFitness()) {
+                bestIndex = i;
             }
         }
-        return bestScoreElement;
+        return bestIndex;
+    }
+
+    // adds the blocks the population covers to the coverage of the path sampler
+    void updatePathSampler() {
+        if (pathSampler.getSampling() == PathSampling::Uniform) {
+            return;
+        }
+        CoverageBitset populationCoverage(blockIndex.size());
+        for (const auto &chromosome: population) {
+            for (unsigned pathId: chromosome.getPathIds()) {
+                populationCoverage |= pathPool.getCoverage(pathId);
+            }
+        }
+        pathSampler.addCoverage(populationCoverage);
+    }
+
+    // copies the best chromosome of the population if it beats the best of all generations
+    void updateBestScoreElement() {
+        const Chromosome &generationBestElement = population[findBestScoreElement()];
+        if (generationBestElement.getFitness() > bestScoreElement.getFitness()) {
+            bestScoreElement = generationBestElement;
+        }
+    }
+
+    // a spare chromosome, or a new one when there is none
+    Chromosome takeSpareChromosome() {
+        if (spareChromosomes.empty()) {
+            INSTRUMENT_COUNT("GeneticSearch::newChromosomes", 1);
+            return Chromosome(std::vector<unsigned>());
+        }
+        Chromosome chromosome = std::move(spareChromosomes.back());
+        spareChromosomes.pop_back();
+        return chromosome;
+    }
+
+    /**
+     * @brief Keeps the chromosomes for which keep is true in their order, the others become spare chromosomes
+     *
+     * Chromosomes are swapped rather than assigned, so the removed ones keep their path lists.
+     */
+    void keepChromosomes(const std::vector<bool> &keep) {
+        size_t keptCount = 0;
+        for (size_t i = 0; i < population.size(); i++) {
+            if (keep[i]) {
+                // a chromosome already in place is left alone, moving it onto itself would empty its path list
+                if (keptCount != i) {
+                    std::swap(population[keptCount], population[i]);
+                }
+                keptCount++;
+            }
+        }
+        std::move(population.begin() + keptCount, population.end(), std::back_inserter(spareChromosomes));
+        population.erase(population.begin() + keptCount, population.end());
     }
 
-    std::vector<Chromosome> selection() {
-        return getRandomCountOfSelectedPopulation(population);
+    // indexes of the parents in the population
+    std::vector<size_t> selection() {
+        INSTRUMENT_SCOPE("GeneticSearch::selection");
+        return selectParents(getFitnessList(), selectionOptions, threadRandomEngine());
     }
 
-    void crossover(std::vector<Chromosome> selectElements) {
-        std::vector<Chromosome> newGeneration;
-        for (int i = 0; i < randomInRange(0, selectElements.size() - 1); i++) {
-            int parent1Index = randomInRange(0, selectElements.size() - 1);
-            int parent2Index = randomInRange(0, selectElements.size() - 1);
-            Chromosome parent1 = selectElements[parent1Index];
-            Chromosome parent2 = selectElements[parent2Index];
-            Chromosome *child = parent1.crossover(&parent2);
-            newGeneration.push_back(*child);
+    void crossover(const std::vector<size_t> &selectedIndexes) {
+        INSTRUMENT_SCOPE("GeneticSearch::crossover");
+        // the loop bound is drawn again before every offspring
+        int offspringCount = 0;
+        while (offspringCount < randomInRange(0, selectedIndexes.size() - 1)) {
+            offspringCount++;
+        }
+        // the offspring are bred in place after the parents, the population does not move while they are
+        size_t firstChildIndex = population.size();
+        for (int i = 0; i < offspringCount; i++) {
+            population.push_back(takeSpareChromosome());
         }
-        population.insert(population.end(), newGeneration.begin(), newGeneration.end());
+        runRandomTasks(threadPool, offspringCount, [&](size_t i) {
+            const Chromosome &parent1 = population[selectedIndexes[randomInRange(0, selectedIndexes.size() - 1)]];
+            const Chromosome &parent2 = population[selectedIndexes[randomInRange(0, selectedIndexes.size() - 1)]];
+            parent1.crossover(parent2, population[firstChildIndex + i]);
+        });
     }
 
-    void mutate(const std::vector<Chromosome> selectElements) {
-        for (auto &element: getRandomCountOfSelectedPopulation(selectElements)) {
-            element.mutate();
+    // every chromosome of the population but the elite mutates with a probability of 1/2
+    void mutate() {
+        INSTRUMENT_SCOPE("GeneticSearch::mutate");
+        std::vector<bool> isElite(population.size());
+        if (selectionOptions.elitism > 0) {
+            evaluateFitness();
+            for (size_t i: selectFittest(getFitnessList(), selectionOptions.elitism)) {
+                isElite[i] = true;
+            }
         }
+        std::vector<size_t> mutatingIndexes;
+        for (size_t i = 0; i < population.size(); i++) {
+            if (randomInRange(0, 1) && !isElite[i]) {
+                mutatingIndexes.push_back(i);
+            }
+        }
+        runRandomTasks(threadPool, mutatingIndexes.size(), [&](size_t i) {
+            population[mutatingIndexes[i]].mutate(pathSampler);
+        });
     }
 
     void purge() {
+        INSTRUMENT_SCOPE("GeneticSearch::purge");
         // calculate average score
         int averageScore = 0;
         for (const auto &p: population) {
@@ -194,66 +322,129 @@ private:
         }
         averageScore /= population.size();
 
-        // purge
-        std::vector<Chromosome> purgeList;
-        for (const auto &p: population) {
-            if (p.getFitness() < averageScore) {
-                purgeList.push_back(p);
-            }
+        // purge, a chromosome with the fitness of a purged one is below the average as well
+        std::vector<bool> survives(population.size());
+        for (size_t i = 0; i < population.size(); i++) {
+            survives[i] = population[i].getFitness() >= averageScore;
         }
-        population.erase(std::remove_if(population.begin(), population.end(),
-                                        [&](const Chromosome &p) {
-                                            for (const auto &purgeElement: purgeList) {
-                                                if (purgeElement.getFitness() == p.getFitness()) {
-                                                    return true;
-                                                }
-                                            }
-                                            return false;
-                                        }), population.end()
-        );
+        keepChromosomes(survives);
+    }
+
+    // keeps the populationSize fittest chromosomes, in their order
+    void truncate() {
+        INSTRUMENT_SCOPE("GeneticSearch::truncate");
+        if (population.size() <= selectionOptions.populationSize) {
+            return;
+        }
+        std::vector<bool> survives(population.size());
+        for (size_t i: selectFittest(getFitnessList(), selectionOptions.populationSize)) {
+            survives[i] = true;
+        }
+        keepChromosomes(survives);
     }
 
 public:
 
-    GeneticSearch(std::vector<Chromosome> population, int crossoverRate, int mutationRate, int purgeRate) :
+    GeneticSearch(std::vector<Chromosome> population, int crossoverRate, int mutationRate, int purgeRate,
+                  ThreadPool &threadPool, const SelectionOptions &selectionOptions = SelectionOptions(),
+                  PathSampling pathSampling = PathSampling::Coverage) :
             population(std::move(population)), crossoverRate(crossoverRate), mutationRate(mutationRate),
-            purgeRate(purgeRate) {}
+            purgeRate(purgeRate), threadPool(threadPool), selectionOptions(selectionOptions),
+            pathSampler(controlFlowGraph, pathSampling) {}
+
+    /**
+     * @brief Evaluates the initial population, must be called before the first generation
+     */
+    void start() {
+        evaluateFitness();
+        bestScoreElement = population[findBestScoreElement()];
+        updatePathSampler();
+    }
+
+    void runGeneration() {
+        INSTRUMENT_SCOPE("GeneticSearch::generation");
+        INSTRUMENT_HISTOGRAM("GeneticSearch::population", population.size());
+
+        std::vector<size_t> selectedIndexes = selection();
+
+        if (probabilityToHappen(crossoverRate)) crossover(selectedIndexes);
+
+        if (probabilityToHappen(mutationRate)) mutate();
+
+        evaluateFitness();
 
-    Chromosome run(double goalScore, int maxGenerationNumber) {
-        Chromosome bestScoreElement = findBestScoreElement();
+        if (selectionOptions.survivors == SurvivorStrategy::Truncation) {
+            truncate();
+        } else if (probabilityToHappen(purgeRate)) {
+            purge();
+        }
+
+        updateBestScoreElement();
+        updatePathSampler();
+    }
+
+    // the best chromosome of all generations, mutation can make the best chromosome of a generation worse
+    const Chromosome &getBestScoreElement() const {
+        return bestScoreElement;
+    }
+
+    size_t getPopulationSize() const {
+        return population.size();
+    }
+
+    /**
+     * @brief Copies of the count fittest chromosomes of the population, fittest first
+     */
+    std::vector<Chromosome> getBestChromosomes(size_t count) const {
+        std::vector<double> fitnessList = getFitnessList();
+        std::vector<size_t> order = selectFittest(fitnessList, count);
+        std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+            return isFitter(fitnessList, i, j);
+        });
+        std::vector<Chromosome> best;
+        for (size_t i: order) {
+            best.push_back(population[i]);
+        }
+        return best;
+    }
+
+    // adds chromosomes of another search, like migrants of another island
+    void addChromosomes(std::vector<Chromosome> chromosomes) {
+        std::move(chromosomes.begin(), chromosomes.end(), std::back_inserter(population));
+        evaluateFitness();
+        updateBestScoreElement();
+        updatePathSampler();
+    }
+
+    /**
+     * @brief Runs generations until the goal score or the maximum generation number is reached
+     * @param log stream of the progress messages
+     * @return the best chromosome of all generations
+     */
+    Chromosome run(double goalScore, int maxGenerationNumber, raw_ostream &log = outs()) {
+        start();
         double globalMaxScore = bestScoreElement.getFitness();
-        llvm::outs() << "Best founded of initial generation, Score: " << (int) globalMaxScore << "\n";
+        log << "Best founded of initial generation, Score: " << (int) globalMaxScore << "\n";
 
         int generationNumber;
         for (generationNumber = 1; bestScoreElement.getFitness() != goalScore; generationNumber++) {
-
-            llvm::outs() << "Current population : " << population.size() << "\n";
+            log << "Current population : " << population.size() << "\n";
 
             if (generationNumber > maxGenerationNumber) {
-                llvm::outs() << "Maximum generation number exceeded\n";
+                log << "Maximum generation number exceeded\n";
                 return bestScoreElement;
             }
 
             if (bestScoreElement.getFitness() > globalMaxScore) {
                 globalMaxScore = bestScoreElement.getFitness();
-                llvm::outs() << "New Best founded in generation(" << generationNumber << ") Score: "
-                             << (int) globalMaxScore << "\n";
-                llvm::outs() << "Current population : " << population.size() << "\n";
+                log << "New Best founded in generation(" << generationNumber << ") Score: "
+                    << (int) globalMaxScore << "\n";
+                log << "Current population : " << population.size() << "\n";
             }
 
-//            llvm::outs() << "start of selection" << "\n";
-            std::vector<Chromosome> selectElements = selection();
-
-            if (probabilityToHappen(crossoverRate)) crossover(selectElements);
-
-            if (probabilityToHappen(mutationRate)) mutate(selectElements);
-//            llvm::outs() << "end of selection" << "\n";
-
-            if (probabilityToHappen(purgeRate)) purge();
-
-            bestScoreElement = findBestScoreElement();
+            runGeneration();
         }
-        llvm::outs() << "Solution found in generation(" << generationNumber << ")\n";
+        log << "Solution found in generation(" << generationNumber << ")\n";
         return bestScoreElement;
     }
 };
@@ -0,0 +1,194 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_ISLANDSEARCH_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_ISLANDSEARCH_H
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "llvm/Support/raw_ostream.h"
+
+#include "GeneticSearch.h"
+#include "Instrumentation.h"
+#include "PathSampler.h"
+#include "RandomEngine.h"
+#include "Selection.h"
+#include "ThreadPool.h"
+
+using namespace llvm;
+
+enum class MigrationTopology {
+    // island i receives the migrants of island i - 1
+    Ring,
+    // every island receives the migrants of every other island
+    FullyConnected,
+};
+
+struct IslandRates {
+    int crossoverRate;
+    int mutationRate;
+    int purgeRate;
+};
+
+struct IslandOptions {
+    // one entry per island
+    std::vector<IslandRates> islandRates;
+    SelectionOptions selectionOptions;
+    int chromosomeCount;
+    int chromosomeSize;
+    // generations between two migrations
+    int migrationInterval;
+    // chromosomes an island sends to each island it is connected to
+    unsigned migrants;
+    MigrationTopology topology;
+    PathSampling pathSampling;
+    // threads of all the islands together
+    unsigned workers;
+};
+
+/**
+ * @brief Island model of the genetic search: several populations evolve apart and exchange their best chromosomes
+ *
+ * Every island is a GeneticSearch with its own rates, population and random stream, the islands run on a thread
+ * pool of their own for migrationInterval generations at a time. In between, the calling thread copies the fittest
+ * chromosomes of every island to the islands the topology connects it to. Islands only meet at migrations and an
+ * island always draws from its own stream, so a seed gives the same result with any number of workers.
+ */
+class IslandSearch {
+private:
+    struct Island {
+        std::unique_ptr<ThreadPool> threadPool;
+        std::unique_ptr<GeneticSearch> search;
+        RandomEngine engine;
+        int generationNumber = 0;
+
+        explicit Island(const RandomEngine &engine) : engine(engine) {}
+    };
+
+    const IslandOptions options;
+    std::vector<Island> islands;
+    ThreadPool islandPool;
+
+    // runs task(island) for every island, each on its own random stream
+    template<typename Task>
+    void runIslands(const Task &task) {
+        RandomEngine savedEngine = threadRandomEngine();
+        islandPool.parallelFor(islands.size(), [&](size_t i) {
+            threadRandomEngine() = islands[i].engine;
+            task(islands[i]);
+            islands[i].engine = threadRandomEngine();
+        });
+        threadRandomEngine() = savedEngine;
+    }
+
+    std::vector<size_t> getSources(size_t island) const {
+        std::vector<size_t> sources;
+        if (options.topology == MigrationTopology::Ring) {
+            sources.push_back((island + islands.size() - 1) % islands.size());
+        } else {
+            for (size_t source = 0; source < islands.size(); source++) {
+                if (source != island) {
+                    sources.push_back(source);
+                }
+            }
+        }
+        return sources;
+    }
+
+    void migrate() {
+        INSTRUMENT_SCOPE("IslandSearch::migrate");
+        // every island sends the best chromosomes it had before the migration
+        std::vector<std::vector<Chromosome>> emigrants;
+        for (auto &island: islands) {
+            emigrants.push_back(island.search->getBestChromosomes(options.migrants));
+        }
+        runIslands([&](Island &island) {
+            std::vector<Chromosome> immigrants;
+            for (size_t source: getSources(&island - islands.data())) {
+                immigrants.insert(immigrants.end(), emigrants[source].begin(), emigrants[source].end());
+            }
+            island.search->addChromosomes(std::move(immigrants));
+        });
+    }
+
+public:
+    /**
+     * @brief Creates the initial population of every island
+     * @param options at least one island, the workers are split evenly between the islands
+     */
+    explicit IslandSearch(const IslandOptions &options)
+            : options(options), islandPool(std::min<size_t>(options.islandRates.size(), options.workers)) {
+        uint64_t seed = threadRandomEngine().next();
+        unsigned islandWorkers = std::max<size_t>(options.workers / options.islandRates.size(), 1);
+        for (size_t i = 0; i < options.islandRates.size(); i++) {
+            islands.emplace_back(RandomEngine(seed, i));
+            islands.back().threadPool = std::make_unique<ThreadPool>(islandWorkers);
+        }
+        runIslands([&](Island &island) {
+            const IslandRates &rates = options.islandRates[&island - islands.data()];
+            PathSampler initialPathSampler(controlFlowGraph, options.pathSampling);
+            island.search = std::make_unique<GeneticSearch>(
+                    Chromosome::createInitialPopulation(options.chromosomeCount, options.chromosomeSize,
+                                                        initialPathSampler, *island.threadPool),
+                    rates.crossoverRate, rates.mutationRate, rates.purgeRate, *island.threadPool,
+                    options.selectionOptions, options.pathSampling);
+            island.search->start();
+        });
+    }
+
+    /**
+     * @brief Runs the islands until one reaches the goal score or all ran maxGenerationNumber generations
+     *
+     * An island that reaches the goal score stops, the others finish the generations before the next migration.
+     * @param log stream of the progress messages
+     * @return the best chromosome of all islands and generations
+     */
+    Chromosome run(double goalScore, int maxGenerationNumber, raw_ostream &log = outs()) {
+        auto isGoalReached = [&] {
+            for (auto &island: islands) {
+                if (island.search->getBestScoreElement().getFitness() == goalScore) {
+                    return true;
+                }
+            }
+            return false;
+        };
+
+        int generationNumber = 0;
+        while (!isGoalReached() && generationNumber < maxGenerationNumber) {
+            int epochEnd = std::min(generationNumber + options.migrationInterval, maxGenerationNumber);
+            runIslands([&](Island &island) {
+                while (island.generationNumber < epochEnd &&
+                       island.search->getBestScoreElement().getFitness() != goalScore) {
+                    island.search->runGeneration();
+                    island.generationNumber++;
+                }
+            });
+            generationNumber = epochEnd;
+
+            for (size_t i = 0; i < islands.size(); i++) {
+                log << "Island " << i << " generation(" << islands[i].generationNumber << ") Score: "
+                    << (int) islands[i].search->getBestScoreElement().getFitness() << ", population : "
+                    << islands[i].search->getPopulationSize() << "\n";
+            }
+            if (!isGoalReached() && generationNumber < maxGenerationNumber) {
+                migrate();
+            }
+        }
+        log << (isGoalReached() ? "Solution found\n" : "Maximum generation number exceeded\n");
+
+        size_t bestIsland = 0;
+        for (size_t i = 1; i < islands.size(); i++) {
+            if (islands[i].search->getBestScoreElement().getFitness() >
+                islands[bestIsland].search->getBestScoreElement().getFitness()) {
+                bestIsland = i;
+            }
+        }
+        log << "Best founded on island " << bestIsland << ", Score: "
+            << (int) islands[bestIsland].search->getBestScoreElement().getFitness() << "\n";
+        return islands[bestIsland].search->getBestScoreElement();
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_ISLANDSEARCH_H
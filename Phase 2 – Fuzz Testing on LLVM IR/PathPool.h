@@ -0,0 +1,111 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHPOOL_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHPOOL_H
+
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "llvm/ADT/Hashing.h"
+#include "llvm/IR/BasicBlock.h"
+#include "llvm/Support/MathExtras.h"
+
+#include "BlockCoverage.h"
+#include "Instrumentation.h"
+
+using namespace llvm;
+
+/**
+ * @brief Interned random paths, every distinct path is stored once with its coverage
+ *
+ * Chromosomes only hold the ids of their paths, so copying a chromosome, crossover and mutation move small
+ * integer arrays instead of block vectors. Paths are never removed, an id stays valid until clear().
+ *
+ * intern can be called from several threads at once. Paths are kept in chunks that never move (chunk k holds
+ * FIRST_CHUNK_SIZE * 2^k paths), so getPath and getCoverage of an id the caller got do not lock.
+ */
+class PathPool {
+private:
+    struct Entry {
+        std::vector<BasicBlock *> blocks;
+        CoverageBitset coverage;
+    };
+
+    static const unsigned FIRST_CHUNK_BITS = 10;
+    static const unsigned FIRST_CHUNK_SIZE = 1u << FIRST_CHUNK_BITS;
+    // enough chunks for every unsigned id
+    static const unsigned MAX_CHUNKS = 33 - FIRST_CHUNK_BITS;
+
+    const BlockIndex &blockIndex;
+    std::unique_ptr<Entry[]> chunks[MAX_CHUNKS];
+    std::atomic<unsigned> pathCount{0};
+
+    // guards the hash table and the chunks that are filled
+    std::mutex mutex;
+    // hash of the blocks of a path to the ids of the paths with that hash
+    std::unordered_multimap<size_t, unsigned> idsOfHash;
+
+    Entry &getEntry(unsigned id) const {
+        uint64_t biasedId = (uint64_t) id + FIRST_CHUNK_SIZE;
+        unsigned chunk = Log2_64(biasedId) - FIRST_CHUNK_BITS;
+        return chunks[chunk][biasedId - ((uint64_t) FIRST_CHUNK_SIZE << chunk)];
+    }
+
+public:
+    explicit PathPool(const BlockIndex &blockIndex) : blockIndex(blockIndex) {}
+
+    /**
+     * @brief Id of the path, the path is added if the pool does not have it yet
+     * @param path every block must be in the block index
+     */
+    unsigned intern(std::vector<BasicBlock *> path) {
+        size_t hash = hash_combine_range(path.begin(), path.end());
+        std::lock_guard<std::mutex> lock(mutex);
+        auto range = idsOfHash.equal_range(hash);
+        for (auto it = range.first; it != range.second; ++it) {
+            if (getEntry(it->second).blocks == path) {
+                INSTRUMENT_COUNT("PathPool::duplicates", 1);
+                return it->second;
+            }
+        }
+        unsigned id = pathCount.load(std::memory_order_relaxed);
+        uint64_t biasedId = (uint64_t) id + FIRST_CHUNK_SIZE;
+        unsigned chunk = Log2_64(biasedId) - FIRST_CHUNK_BITS;
+        if (chunks[chunk] == nullptr) {
+            chunks[chunk].reset(new Entry[(size_t) FIRST_CHUNK_SIZE << chunk]);
+        }
+        Entry &entry = getEntry(id);
+        entry.coverage = blockIndex.getCoverage(path);
+        entry.blocks = std::move(path);
+        idsOfHash.emplace(hash, id);
+        pathCount.store(id + 1, std::memory_order_release);
+        return id;
+    }
+
+    const std::vector<BasicBlock *> &getPath(unsigned id) const {
+        return getEntry(id).blocks;
+    }
+
+    const CoverageBitset &getCoverage(unsigned id) const {
+        return getEntry(id).coverage;
+    }
+
+    size_t size() const {
+        return pathCount.load(std::memory_order_acquire);
+    }
+
+    // no other thread may use the pool
+    void clear() {
+        for (auto &chunk: chunks) {
+            chunk.reset();
+        }
+        idsOfHash.clear();
+        pathCount.store(0);
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHPOOL_H
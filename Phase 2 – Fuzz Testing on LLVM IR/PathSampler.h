@@ -0,0 +1,193 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHSAMPLER_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHSAMPLER_H
+
+#include <cstdio>
+#include <cstdint>
+#include <vector>
+
+#include "llvm/IR/BasicBlock.h"
+
+#include "BlockCoverage.h"
+#include "ControlFlowGraph.h"
+#include "Instrumentation.h"
+#include "RandomEngine.h"
+
+using namespace llvm;
+
+enum class PathSampling {
+    // every successor of a branch with the same probability
+    Uniform,
+    // successors weighted by the number of uncovered blocks they reach
+    Coverage,
+};
+
+/**
+ * @brief Random paths from the entry block of a ControlFlowGraph to a block without successors
+ *
+ * Uniform sampling draws the same numbers as the original walk over the terminators. Coverage sampling takes the
+ * successors of a branch from an alias table, in O(1) whatever the number of successors, with weights that favor
+ * the successors from which many blocks are still uncovered (see getWeight), so the paths go where the coverage can
+ * still grow.
+ *
+ * addCoverage only updates the uncovered counts of the components that reach a newly covered block and rebuilds
+ * the alias tables of their predecessors. generatePath only reads, so several threads can sample at once, but not
+ * while addCoverage runs.
+ */
+class PathSampler {
+private:
+    const ControlFlowGraph &graph;
+    PathSampling sampling;
+    // by block id of the graph
+    CoverageBitset coveredBlocks;
+    // by component, the uncovered blocks reachable from it and the uncovered blocks of its own
+    std::vector<unsigned> uncoveredCounts;
+    std::vector<unsigned> ownUncoveredCounts;
+    // alias tables of the branches, by successor slot of the graph, an alias is a successor index of the branch
+    std::vector<double> aliasProbabilities;
+    std::vector<unsigned> aliases;
+
+    /**
+     * @brief Weight of the successor in the slot of the block, plus one so that no successor is impossible
+     *
+     * A successor in another component weighs the uncovered blocks it reaches. One in the component of the block,
+     * like the header of the loop the block is in, only weighs the uncovered blocks of the component: what the
+     * component reaches beyond it can be reached by leaving it as well, so loops are not favored over their exits.
+     */
+    double getWeight(unsigned block, unsigned slot) const {
+        unsigned component = graph.getComponent(graph.getSuccessor(slot));
+        if (component == graph.getComponent(block)) {
+            return 1 + ownUncoveredCounts[component];
+        }
+        return 1 + uncoveredCounts[component];
+    }
+
+    // Vose's alias method over the weights of the successors of the block
+    void buildAliasTable(unsigned block) {
+        unsigned offset = graph.getSuccessorOffset(block);
+        unsigned count = graph.getSuccessorCount(block);
+        if (count < 2) {
+            return;
+        }
+        double totalWeight = 0;
+        for (unsigned i = 0; i < count; i++) {
+            totalWeight += getWeight(block, offset + i);
+        }
+        // weights scaled to a mean of 1, the small ones are topped up by a large one
+        std::vector<double> scaledWeights(count);
+        std::vector<unsigned> small, large;
+        for (unsigned i = 0; i < count; i++) {
+            scaledWeights[i] = getWeight(block, offset + i) * count / totalWeight;
+            (scaledWeights[i] < 1 ? small : large).push_back(i);
+        }
+        while (!small.empty() && !large.empty()) {
+            unsigned lighter = small.back();
+            unsigned heavier = large.back();
+            small.pop_back();
+            aliasProbabilities[offset + lighter] = scaledWeights[lighter];
+            aliases[offset + lighter] = heavier;
+            scaledWeights[heavier] -= 1 - scaledWeights[lighter];
+            if (scaledWeights[heavier] < 1) {
+                large.pop_back();
+                small.push_back(heavier);
+            }
+        }
+        // what is left has a weight of 1 up to rounding
+        for (unsigned i: small) {
+            aliasProbabilities[offset + i] = 1;
+        }
+        for (unsigned i: large) {
+            aliasProbabilities[offset + i] = 1;
+        }
+    }
+
+public:
+    PathSampler(const ControlFlowGraph &graph, PathSampling sampling)
+            : graph(graph), sampling(sampling), coveredBlocks(graph.size()),
+              aliasProbabilities(graph.getSuccessorSlotCount(), 1), aliases(graph.getSuccessorSlotCount()) {
+        if (sampling == PathSampling::Uniform) {
+            return;
+        }
+        for (unsigned component = 0; component < graph.getComponentCount(); component++) {
+            uncoveredCounts.push_back(graph.getReachableBlocks(component).count());
+            ownUncoveredCounts.push_back(graph.getComponentEnd(component) - graph.getComponentBegin(component));
+        }
+        for (unsigned block = 0; block < graph.size(); block++) {
+            buildAliasTable(block);
+        }
+    }
+
+    PathSampling getSampling() const {
+        return sampling;
+    }
+
+    /**
+     * @brief Marks the blocks of coverage as covered, for the paths drawn from now on
+     * @param coverage block ids of the BlockIndex of the graph, blocks that are not in the graph are ignored
+     */
+    void addCoverage(const CoverageBitset &coverage) {
+        if (sampling == PathSampling::Uniform) {
+            return;
+        }
+        INSTRUMENT_SCOPE("PathSampler::addCoverage");
+        std::vector<bool> isChanged(graph.getComponentCount());
+        for (unsigned block = 0; block < graph.size(); block++) {
+            if (coveredBlocks.test(block) || !coverage.test(graph.getBlockId(block))) {
+                continue;
+            }
+            coveredBlocks.set(block);
+            ownUncoveredCounts[graph.getComponent(block)]--;
+            // the components are in topological order, so only the ones up to its own can reach the block
+            for (unsigned component = 0; component <= graph.getComponent(block); component++) {
+                if (graph.getReachableBlocks(component).test(block)) {
+                    uncoveredCounts[component]--;
+                    isChanged[component] = true;
+                }
+            }
+        }
+        // the weights of a branch are the counts of the components of its successors, a component whose own count
+        // changed reaches the block as well
+        std::vector<bool> isRebuilt(graph.size());
+        for (unsigned component = 0; component < graph.getComponentCount(); component++) {
+            if (!isChanged[component]) {
+                continue;
+            }
+            for (unsigned block = graph.getComponentBegin(component); block < graph.getComponentEnd(component);
+                 block++) {
+                unsigned offset = graph.getPredecessorOffset(block);
+                for (unsigned slot = offset; slot < offset + graph.getPredecessorCount(block); slot++) {
+                    unsigned predecessor = graph.getPredecessor(slot);
+                    if (!isRebuilt[predecessor]) {
+                        isRebuilt[predecessor] = true;
+                        buildAliasTable(predecessor);
+                    }
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief A random path from the entry block, with the random engine of the calling thread
+     */
+    std::vector<BasicBlock *> generatePath() const {
+        RandomEngine &engine = threadRandomEngine();
+        unsigned block = graph.getEntry();
+        std::vector<BasicBlock *> path = {graph.getBlock(block)};
+        unsigned successorCount;
+        while ((successorCount = graph.getSuccessorCount(block)) > 0) {
+            unsigned slot = graph.getSuccessorOffset(block);
+            if (successorCount > 1) {
+                unsigned successor = engine.inRange(0, successorCount - 1);
+                if (sampling == PathSampling::Coverage && engine.nextDouble() >= aliasProbabilities[slot + successor]) {
+                    successor = aliases[slot + successor];
+                }
+                slot += successor;
+            }
+            block = graph.getSuccessor(slot);
+            path.push_back(graph.getBlock(block));
+        }
+        INSTRUMENT_HISTOGRAM("PathSampler::pathLength", path.size());
+        return path;
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_PATHSAMPLER_H
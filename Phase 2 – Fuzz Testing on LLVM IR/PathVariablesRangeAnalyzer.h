@@ -16,6 +16,7 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "Instrumentation.h"
 #include "Utils.h"
 
 using namespace llvm;
@@ -201,12 +202,41 @@ private:
         }
     }
 
+    /**
+     * @brief Finds the variable or the constant an operand of a comparison stands for
+     *
+     * A load is its variable and a parameter (of optimized code) itself. A phi is resolved by the block that
+     * precedes its own block on the path, operations and unresolved phis are no variable.
+     * @param position index in the path from which the block of a phi is searched
+     */
+    void resolveOperand(Value *operand, size_t position, std::string &variableName, int &immediateValue) const {
+        if (auto *phi = dyn_cast<PHINode>(operand)) {
+            // the path is reversed, the block executed before path[i] is path[i + 1]
+            for (size_t i = position; i + 1 < path.size(); i++) {
+                if (path[i] == phi->getParent()) {
+                    int incoming = phi->getBasicBlockIndex(path[i + 1]);
+                    if (incoming >= 0) {
+                        resolveOperand(phi->getIncomingValue(incoming), i + 1, variableName, immediateValue);
+                    }
+                    return;
+                }
+            }
+        } else if (auto *loadInst = dyn_cast<LoadInst>(operand)) {
+            variableName = getSimpleNodeName(loadInst->getPointerOperand());
+        } else if (auto *constantInt = dyn_cast<ConstantInt>(operand)) {
+            immediateValue = (int) constantInt->getSExtValue();
+        } else if (isa<Argument>(operand)) {
+            variableName = getSimpleNodeName(operand);
+        }
+    }
+
     /**
      * @brief get basic block and return comparison data of block if its present
      * @param basicBlock
+     * @param position index in the path of the block, where its phis are resolved from
      * @return comparison data of block if its present
      */
-    static std::tuple<CmpInst::Predicate, std::string, int> *getCmpData(BasicBlock *basicBlock) {
+    std::tuple<CmpInst::Predicate, std::string, int> *getCmpData(BasicBlock *basicBlock, size_t position) const {
 
         if (basicBlock == nullptr) return nullptr;
 
@@ -215,27 +245,13 @@ private:
             if (isa<ICmpInst>(I)) {
                 auto *cmp = dyn_cast<ICmpInst>(&I);
 
-                auto opCmp1 = cmp->getOperand(0);
-                auto opCmp2 = cmp->getOperand(1);
-
                 // get compare type of ICmpInst in string format and print it
                 auto cmpType = cmp->getPredicate();
                 std::string cmpVariableName;
-                int cmpImmediateValue;
-
-                if (isa<LoadInst>(opCmp1)) {
-                    auto *loadInst = dyn_cast<LoadInst>(opCmp1);
-                    cmpVariableName = loadInst->getPointerOperand()->getName().str();
-                } else {
-                    cmpImmediateValue = std::stoi(getSimpleNodeName(opCmp1));
-                }
+                int cmpImmediateValue = 0;
 
-                if (isa<LoadInst>(opCmp2)) {
-                    auto *loadInst = dyn_cast<LoadInst>(opCmp2);
-                    cmpVariableName = loadInst->getPointerOperand()->getName().str();
-                } else {
-                    cmpImmediateValue = std::stoi(getSimpleNodeName(opCmp2));
-                }
+                resolveOperand(cmp->getOperand(0), position, cmpVariableName, cmpImmediateValue);
+                resolveOperand(cmp->getOperand(1), position, cmpVariableName, cmpImmediateValue);
 
                 return new std::tuple<CmpInst::Predicate, std::string, int>(cmpType, cmpVariableName,
                                                                             cmpImmediateValue);
@@ -408,29 +424,36 @@ private:
      * @param predicate
      * @return string representation of comparison type
      */
-    static void printCmpData(std::tuple<CmpInst::Predicate, std::string, int> *cmpData) {
+    static void printCmpData(std::tuple<CmpInst::Predicate, std::string, int> *cmpData, raw_ostream &log) {
         CmpInst::Predicate predicate = std::get<0>(*cmpData);
         std::string variableName = std::get<1>(*cmpData);
         int immediateValue = std::get<2>(*cmpData);
-        outs() << variableName << " " << getCmpTypeString(predicate) << " " << immediateValue << "\n";
+        log << variableName << " " << getCmpTypeString(predicate) << " " << immediateValue << "\n";
     }
 
     // ==========================================================================
 
 public:
-    explicit PathVariablesRangeAnalyzer(std::vector<BasicBlock *> &path, int minRange, int maxRange)
+    /**
+     * @param path the blocks of a path from the last one to the entry block
+     * @param log stream the conditions of the path are printed to
+     */
+    explicit PathVariablesRangeAnalyzer(std::vector<BasicBlock *> &path, int minRange, int maxRange,
+                                        raw_ostream &log = outs())
             : path(path), minRange(minRange), maxRange(maxRange) {
+        INSTRUMENT_SCOPE("PathVariablesRangeAnalyzer::PathVariablesRangeAnalyzer");
 
-        outs() << "----------- Conditions -----------" << "\n";
+        log << "----------- Conditions -----------" << "\n";
 
         std::map<BasicBlock *, std::tuple<CmpInst::Predicate, std::string, int> *> cmpDataOfBlocks;
 
-        for (BasicBlock *bb: path) {
-            BasicBlock *prevBB = bb->getSinglePredecessor();
-            auto cmpData = getCmpData(prevBB);
+        for (size_t position = 0; position < path.size(); position++) {
+            BasicBlock *prevBB = path[position]->getSinglePredecessor();
+            auto cmpData = getCmpData(prevBB, position + 1);
             cmpDataOfBlocks[prevBB] = cmpData;
 
-            if (cmpData == nullptr) continue;
+            // a comparison of a computed value constrains no variable
+            if (cmpData == nullptr || std::get<1>(*cmpData).empty()) continue;
 
             std::string cmpVariableName = std::get<1>(*cmpData);
             // if the variable is not in the map, add it with its range
@@ -463,9 +486,9 @@ public:
 
                 analyzeVariableRange(cmpData);
 
-                outs() << getSimpleNodeName(bb) << "\n";
-                printCmpData(cmpData);
-                outs() << "----------------------------------" << "\n";
+                log << getSimpleNodeName(bb) << "\n";
+                printCmpData(cmpData, log);
+                log << "----------------------------------" << "\n";
 
 
                 // TODO: fix this later!
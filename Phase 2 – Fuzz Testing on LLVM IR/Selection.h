@@ -0,0 +1,146 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_SELECTION_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_SELECTION_H
+
+#include <cstdio>
+#include <cstdint>
+#include <algorithm>
+#include <vector>
+
+#include "RandomEngine.h"
+
+/**
+ * Parent selection and survivor strategies of the genetic search.
+ *
+ * They only see the fitness of every chromosome of the population and answer with indexes into it. Fitness ties
+ * are broken by the lower index, so a strategy gives the same answer for the same fitness and random stream.
+ */
+
+enum class SelectionStrategy {
+    // every chromosome with a probability of 1/2, whatever its fitness
+    Uniform,
+    // the fittest of tournamentSize chromosomes drawn uniformly
+    Tournament,
+    // chromosomes with a probability proportional to their rank, 1 for the least fit
+    Rank,
+    // chromosomes with a probability proportional to their fitness, shifted so the least fit one has a weight of 1
+    Roulette,
+};
+
+enum class SurvivorStrategy {
+    // a purge (with the purge rate) removes the chromosomes below the average fitness
+    Average,
+    // after every generation only the populationSize fittest chromosomes survive
+    Truncation,
+};
+
+struct SelectionOptions {
+    SelectionStrategy selection = SelectionStrategy::Tournament;
+    unsigned tournamentSize = 2;
+    SurvivorStrategy survivors = SurvivorStrategy::Truncation;
+    // only for Truncation
+    size_t populationSize = 100;
+    // the fittest chromosomes of a generation, they are never mutated
+    size_t elitism = 1;
+};
+
+inline bool isFitter(const std::vector<double> &fitness, size_t i, size_t j) {
+    return fitness[i] > fitness[j] || (fitness[i] == fitness[j] && i < j);
+}
+
+/**
+ * @brief Indexes of the count fittest chromosomes in no particular order, in O(n)
+ */
+inline std::vector<size_t> selectFittest(const std::vector<double> &fitness, size_t count) {
+    std::vector<size_t> indexes(fitness.size());
+    for (size_t i = 0; i < indexes.size(); i++) {
+        indexes[i] = i;
+    }
+    count = std::min(count, indexes.size());
+    if (count < indexes.size()) {
+        std::nth_element(indexes.begin(), indexes.begin() + count, indexes.end(), [&](size_t i, size_t j) {
+            return isFitter(fitness, i, j);
+        });
+        indexes.resize(count);
+    }
+    return indexes;
+}
+
+// draws count indexes, index i with a probability proportional to weights[i], in O(n + count log n)
+inline std::vector<size_t> selectByWeight(const std::vector<double> &weights, size_t count, RandomEngine &engine) {
+    std::vector<double> cumulativeWeights(weights.size());
+    double total = 0;
+    for (size_t i = 0; i < weights.size(); i++) {
+        total += weights[i];
+        cumulativeWeights[i] = total;
+    }
+    std::vector<size_t> selected;
+    for (size_t n = 0; n < count; n++) {
+        double point = engine.nextDouble() * total;
+        size_t index = std::upper_bound(cumulativeWeights.begin(), cumulativeWeights.end(), point) -
+                       cumulativeWeights.begin();
+        selected.push_back(std::min(index, weights.size() - 1));
+    }
+    return selected;
+}
+
+/**
+ * @brief Indexes of the parents of a generation, a chromosome can be selected more than once
+ *
+ * Uniform selects a random subset of the population, the other strategies draw as many parents as there are
+ * chromosomes.
+ */
+inline std::vector<size_t> selectParents(const std::vector<double> &fitness, const SelectionOptions &options,
+                                         RandomEngine &engine) {
+    std::vector<size_t> selected;
+    if (fitness.empty()) {
+        return selected;
+    }
+    switch (options.selection) {
+        case SelectionStrategy::Uniform:
+            for (size_t i = 0; i < fitness.size(); i++) {
+                if (engine.inRange(0, 1)) {
+                    selected.push_back(i);
+                }
+            }
+            break;
+        case SelectionStrategy::Tournament:
+            for (size_t n = 0; n < fitness.size(); n++) {
+                size_t winner = engine.inRange(0, fitness.size() - 1);
+                for (unsigned round = 1; round < options.tournamentSize; round++) {
+                    size_t challenger = engine.inRange(0, fitness.size() - 1);
+                    if (isFitter(fitness, challenger, winner)) {
+                        winner = challenger;
+                    }
+                }
+                selected.push_back(winner);
+            }
+            break;
+        case SelectionStrategy::Rank: {
+            std::vector<size_t> order(fitness.size());
+            for (size_t i = 0; i < order.size(); i++) {
+                order[i] = i;
+            }
+            std::sort(order.begin(), order.end(), [&](size_t i, size_t j) {
+                return isFitter(fitness, j, i);
+            });
+            std::vector<double> weights(fitness.size());
+            for (size_t rank = 0; rank < order.size(); rank++) {
+                weights[order[rank]] = rank + 1;
+            }
+            selected = selectByWeight(weights, fitness.size(), engine);
+            break;
+        }
+        case SelectionStrategy::Roulette: {
+            double minFitness = *std::min_element(fitness.begin(), fitness.end());
+            std::vector<double> weights(fitness.size());
+            for (size_t i = 0; i < fitness.size(); i++) {
+                weights[i] = fitness[i] - minFitness + 1;
+            }
+            selected = selectByWeight(weights, fitness.size(), engine);
+            break;
+        }
+    }
+    return selected;
+}
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_SELECTION_H
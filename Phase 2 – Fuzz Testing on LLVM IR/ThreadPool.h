@@ -0,0 +1,117 @@
+#ifndef PHASE_2__FUZZ_TESTING_ON_LLVM_IR_THREADPOOL_H
+#define PHASE_2__FUZZ_TESTING_ON_LLVM_IR_THREADPOOL_H
+
+#include <cstdio>
+#include <cstdint>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @brief Fixed set of threads that run the iterations of parallel loops
+ *
+ * The threads are started once and wait between loops, the calling thread runs iterations as well, so a pool of
+ * one thread runs every loop on the caller. Iterations are claimed one at a time, which thread runs an iteration
+ * depends on scheduling, so an iteration must not depend on it. Iterations must not throw.
+ */
+class ThreadPool {
+private:
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable loopStarted;
+    std::condition_variable loopFinished;
+    // the loop that runs, changed only while no worker is busy
+    const std::function<void(size_t)> *body = nullptr;
+    size_t iterationCount = 0;
+    uint64_t loopNumber = 0;
+    unsigned busyWorkers = 0;
+    bool stopping = false;
+
+    std::atomic<size_t> nextIteration{0};
+
+    void runIterations() {
+        size_t iteration;
+        while ((iteration = nextIteration.fetch_add(1, std::memory_order_relaxed)) < iterationCount) {
+            (*body)(iteration);
+        }
+    }
+
+    void runWorker() {
+        uint64_t lastLoopNumber = 0;
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            loopStarted.wait(lock, [&] {
+                return stopping || loopNumber != lastLoopNumber;
+            });
+            if (stopping) {
+                return;
+            }
+            lastLoopNumber = loopNumber;
+            lock.unlock();
+            runIterations();
+            lock.lock();
+            if (--busyWorkers == 0) {
+                loopFinished.notify_one();
+            }
+        }
+    }
+
+public:
+    // a thread count of 0 is taken as 1
+    explicit ThreadPool(unsigned threads) {
+        for (unsigned i = 1; i < threads; i++) {
+            workers.emplace_back(&ThreadPool::runWorker, this);
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    ~ThreadPool() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        loopStarted.notify_all();
+        for (auto &worker: workers) {
+            worker.join();
+        }
+    }
+
+    unsigned getThreadCount() const {
+        return workers.size() + 1;
+    }
+
+    /**
+     * @brief Runs loopBody(i) for every i in [0, count) and returns when all are done
+     */
+    void parallelFor(size_t count, const std::function<void(size_t)> &loopBody) {
+        if (workers.empty() || count <= 1) {
+            for (size_t i = 0; i < count; i++) {
+                loopBody(i);
+            }
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            body = &loopBody;
+            iterationCount = count;
+            nextIteration.store(0, std::memory_order_relaxed);
+            busyWorkers = workers.size();
+            loopNumber++;
+        }
+        loopStarted.notify_all();
+        runIterations();
+        std::unique_lock<std::mutex> lock(mutex);
+        loopFinished.wait(lock, [&] {
+            return busyWorkers == 0;
+        });
+    }
+};
+
+#endif //PHASE_2__FUZZ_TESTING_ON_LLVM_IR_THREADPOOL_H
@@ -16,17 +16,12 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "RandomEngine.h"
+
 using namespace llvm;
 
 int randomInRange(int startOfRange, int endOfRange) {
-    //the random device that will seed the generator
-    std::random_device seeder;
-    //then make a mersenne twister engine
-    std::mt19937 engine(seeder());
-    //then the easy part... the distribution
-    std::uniform_int_distribution<int> dist(startOfRange, endOfRange);
-    //then just generate the integer like this:
-    return dist(engine);
+    return threadRandomEngine().inRange(startOfRange, endOfRange);
 }
 
 std::string getSimpleNodeName(const Value *node) {
@@ -0,0 +1,127 @@
+#ifndef PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_ALLOCATIONCOUNTER_H
+#define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_ALLOCATIONCOUNTER_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+/**
+ * Counts the heap allocations of the whole process by replacing the global operator new.
+ *
+ * The replacement allocation functions may only be defined once, so this header is only included by the
+ * translation unit that has main. They allocate with malloc and release with free, which GCC reports as a
+ * mismatch wherever it inlines a replaced operator delete, so that warning is disabled for them.
+ */
+
+inline std::atomic<uint64_t> &heapAllocationCounter() {
+    static std::atomic<uint64_t> counter(0);
+    return counter;
+}
+
+inline uint64_t getHeapAllocationCount() {
+    return heapAllocationCounter().load(std::memory_order_relaxed);
+}
+
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wpragmas"
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+
+void *operator new(std::size_t size) {
+    heapAllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    if (void *pointer = std::malloc(size == 0 ? 1 : size)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void *operator new(std::size_t size, const std::nothrow_t &) noexcept {
+    heapAllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+void *operator new[](std::size_t size, const std::nothrow_t &tag) noexcept {
+    return operator new(size, tag);
+}
+
+void operator delete(void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
+
+#ifdef __cpp_aligned_new
+// over-aligned types, e.g. alignas(64) members, are allocated through these
+void *operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t &) noexcept {
+    heapAllocationCounter().fetch_add(1, std::memory_order_relaxed);
+    void *pointer = nullptr;
+    std::size_t pointerAlignment = std::max(static_cast<std::size_t>(alignment), sizeof(void *));
+    return posix_memalign(&pointer, pointerAlignment, size == 0 ? 1 : size) == 0 ? pointer : nullptr;
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment) {
+    if (void *pointer = operator new(size, alignment, std::nothrow)) {
+        return pointer;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t &tag) noexcept {
+    return operator new(size, alignment, tag);
+}
+
+void operator delete(void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void *pointer, std::align_val_t, const std::nothrow_t &) noexcept {
+    std::free(pointer);
+}
+#endif
+
+#pragma GCC diagnostic pop
+
+#endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_ALLOCATIONCOUNTER_H
@@ -0,0 +1,204 @@
+#include <cstdio>
+#include <iostream>
+#include <set>
+#include <cstdlib>
+#include <random>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+
+#include "Benchmark.h"
+#include "BlockSummary.h"
+#include "JitNavigator.h"
+#include "ModuleLoader.h"
+#include "PathNavigator.h"
+#include "Solver.h"
+#include "DseTester.h"
+
+using namespace llvm;
+
+static cl::OptionCategory benchmarkCategory("Benchmark options");
+
+static cl::list<std::string> inputFilenames(
+        cl::Positional, cl::desc("<input .ll or .bc files>"), cl::OneOrMore, cl::cat(benchmarkCategory)
+);
+
+static cl::opt<double> minTime(
+        "min-time",
+        cl::desc("Minimum number of seconds the measured round of a benchmark runs"),
+        cl::init(0.5),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<std::string> filter(
+        "filter",
+        cl::desc("Only run the benchmarks whose name contains the text"),
+        cl::value_desc("text"),
+        cl::cat(benchmarkCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed of the benchmarked inputs"),
+        cl::cat(benchmarkCategory)
+);
+
+// random inputs a navigation benchmark cycles through, drawn before the timing starts
+static const unsigned INPUT_SETS = 1024;
+
+// the range and budget of the DSE tester
+static const int RANGE = 200'000;
+static const ExecutionBudget BUDGET{100000, 0};
+
+// half widths of the input range the solver is benchmarked with
+static const int SOLVER_RANGES[] = {100, 10'000, RANGE, 100'000'000};
+
+std::vector<std::vector<int>> drawInputSets(size_t inputCount, int range) {
+    std::vector<std::vector<int>> inputSets(INPUT_SETS, std::vector<int>(inputCount));
+    for (auto &inputValues: inputSets) {
+        for (auto &value: inputValues) {
+            value = randomInRange(-range, range);
+        }
+    }
+    return inputSets;
+}
+
+template<typename Navigator>
+void setInputs(Navigator &navigator, const std::vector<int> &inputSlots, const std::vector<int> &inputValues) {
+    navigator.reset();
+    for (size_t i = 0; i < inputSlots.size(); i++) {
+        if (inputSlots[i] >= 0) {
+            navigator.setArgument(inputSlots[i], inputValues[i]);
+        }
+    }
+}
+
+// navigates the input sets in turn with a reused navigator, the way a DSE run does
+template<typename Navigator>
+void benchmarkNavigator(BenchmarkRunner &runner, const std::string &name, const std::string &input,
+                        Navigator &navigator, const std::vector<int> &inputSlots) {
+    auto inputSets = drawInputSets(inputSlots.size(), RANGE);
+    size_t nextInputSet = 0;
+    runner.run(name, input, "", [&] {
+        setInputs(navigator, inputSlots, inputSets[nextInputSet++ % INPUT_SETS]);
+        navigator.navigate();
+        return 1;
+    });
+}
+
+/**
+ * @brief Solves the conditions of a random path for several input ranges
+ *
+ * The path is navigated with inputs of the benchmarked range, so its conditions are always satisfiable.
+ */
+void benchmarkSolver(BenchmarkRunner &runner, const std::string &input, Function &function,
+                     const std::set<std::string> &inputArguments, const BlockSummaryTable &summary) {
+    std::vector<int> inputSlots;
+    for (auto &variable: inputArguments) {
+        inputSlots.push_back(summary.getSlot(variable));
+    }
+    PathNavigator pathNavigator(summary, BUDGET);
+
+    for (int range: SOLVER_RANGES) {
+        Solver solver(function, inputArguments, -range, range);
+        setInputs(pathNavigator, inputSlots, drawInputSets(inputSlots.size(), range)[0]);
+        pathNavigator.navigate();
+        std::vector<PathCondition> conditions;
+        for (auto &condition: pathNavigator.getConditions()) {
+            if (solver.isSolvable(condition)) {
+                conditions.push_back(condition);
+            }
+        }
+
+        InputAssignment result;
+        runner.run("Solver::solve", input,
+                   "range=" + std::to_string(range) + ",conditions=" + std::to_string(conditions.size()), [&] {
+                    solver.solve(conditions, result);
+                    return 1;
+                });
+    }
+}
+
+void benchmarkFunction(BenchmarkRunner &runner, const std::string &input, Function &function) {
+    auto inputArguments = getInputArguments(function, "a");
+
+    runner.run("BlockSummaryTable::BlockSummaryTable", input, "", [&] {
+        BlockSummaryTable summary(function);
+        return 1;
+    });
+
+    BlockSummaryTable summary(function);
+    std::vector<int> inputSlots;
+    for (auto &variable: inputArguments) {
+        inputSlots.push_back(summary.getSlot(variable));
+    }
+    PathNavigator pathNavigator(summary, BUDGET);
+    benchmarkNavigator(runner, "PathNavigator::navigate", input, pathNavigator, inputSlots);
+
+    if (runner.isEnabled("JitNavigator::navigate")) {
+        try {
+            JitFunction jitFunction(function, inputArguments);
+            std::vector<int> jitInputSlots;
+            for (auto &variable: inputArguments) {
+                jitInputSlots.push_back(jitFunction.getInputSlot(variable));
+            }
+            JitNavigator jitNavigator(jitFunction, BUDGET);
+            benchmarkNavigator(runner, "JitNavigator::navigate", input, jitNavigator, jitInputSlots);
+        } catch (const std::runtime_error &error) {
+            errs() << input << ": JitNavigator::navigate skipped: " << error.what() << "\n";
+        }
+    }
+
+    benchmarkSolver(runner, input, function, inputArguments, summary);
+
+    // every run starts from the same random inputs, so all of them take the same paths
+    runner.run("DseTester::run", input, "range=" + std::to_string(RANGE), [&] {
+        threadRandomEngine() = RandomEngine(getMasterSeed(), 0);
+        DseTester dseTester(&function.getEntryBlock(), inputArguments, -RANGE, RANGE, BUDGET);
+        dseTester.run(summary);
+        return 1;
+    });
+}
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(benchmarkCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Benchmarks of the dynamic symbolic execution tester\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
+
+    int exitCode = 0;
+    BenchmarkRunner runner(minTime, filter, outs());
+    for (auto &inputFilename: inputFilenames) {
+        LLVMContext context;
+        ModuleLoader moduleLoader;
+        std::unique_ptr<Module> M;
+        Function *mainFunction;
+        try {
+            M = moduleLoader.load(inputFilename, context);
+            mainFunction = M->getFunction("main");
+            if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+                fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+                return EXIT_FAILURE;
+            }
+            moduleLoader.materialize(*mainFunction);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+
+        try {
+            benchmarkFunction(runner, inputFilename, *mainFunction);
+        } catch (const std::runtime_error &error) {
+            // e.g. a DSE run that reaches an input the solver left unassigned
+            fprintf(stderr, "error: %s: %s\n", inputFilename.c_str(), error.what());
+            exitCode = EXIT_FAILURE;
+        }
+    }
+    return exitCode;
+}
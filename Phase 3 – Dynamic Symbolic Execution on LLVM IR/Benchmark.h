@@ -0,0 +1,100 @@
+#ifndef PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_BENCHMARK_H
+#define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_BENCHMARK_H
+
+#include <cstdio>
+#include <cstdint>
+#include <chrono>
+#include <string>
+
+#include <sys/resource.h>
+
+#include "llvm/Support/Format.h"
+#include "llvm/Support/raw_ostream.h"
+
+#include "AllocationCounter.h"
+#include "ResultWriter.h"
+
+using namespace llvm;
+
+/**
+ * @brief Times benchmarked operations and writes one JSON object per benchmark
+ *
+ * An operation is run once to warm up caches and grow reused buffers, then in rounds of doubling length
+ * until a round lasts at least the minimum time; the last round is reported. Allocations are counted by
+ * AllocationCounter.h, so this header is only included by the translation unit that has main. The peak
+ * resident set size is the one of the whole process so far.
+ *
+ *   {"benchmark":"PathNavigator::navigate","input":"test1.ll","parameter":"","operations":2097152,
+ *    "nsPerOp":38.4,"allocationsPerOp":0.000,"peakRssKiB":21480}
+ */
+class BenchmarkRunner {
+private:
+    const double minSeconds;
+    const std::string filter;
+    raw_ostream &out;
+
+    static long getPeakRssKiB() {
+        rusage usage{};
+        getrusage(RUSAGE_SELF, &usage);
+        return usage.ru_maxrss;
+    }
+
+public:
+    /**
+     * @param minSeconds length of the reported round
+     * @param filter only the benchmarks whose name contains it run, empty for all
+     */
+    BenchmarkRunner(double minSeconds, std::string filter, raw_ostream &out)
+            : minSeconds(minSeconds), filter(std::move(filter)), out(out) {}
+
+    bool isEnabled(const std::string &name) const {
+        return filter.empty() || name.find(filter) != std::string::npos;
+    }
+
+    /**
+     * @param parameter what the operation depends on besides the input, e.g. lanes=64
+     * @param operation runs the benchmarked code once and returns how many operations that counts for, e.g.
+     *                  the generations of a search
+     */
+    template<typename Operation>
+    void run(const std::string &name, const std::string &input, const std::string &parameter,
+             Operation operation) {
+        if (!isEnabled(name)) {
+            return;
+        }
+
+        operation();
+
+        uint64_t rounds = 1;
+        while (true) {
+            uint64_t operations = 0;
+            uint64_t allocationsBefore = getHeapAllocationCount();
+            auto start = std::chrono::steady_clock::now();
+            for (uint64_t round = 0; round < rounds; round++) {
+                operations += operation();
+            }
+            double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            uint64_t allocations = getHeapAllocationCount() - allocationsBefore;
+
+            if (seconds < minSeconds && rounds < (uint64_t(1) << 40)) {
+                rounds *= 2;
+                continue;
+            }
+
+            std::string record = "{\"benchmark\":";
+            ResultWriter::appendJsonString(record, name);
+            record += ",\"input\":";
+            ResultWriter::appendJsonString(record, input);
+            record += ",\"parameter\":";
+            ResultWriter::appendJsonString(record, parameter);
+            out << record << ",\"operations\":" << operations
+                << ",\"nsPerOp\":" << format("%.1f", seconds * 1e9 / std::max<uint64_t>(operations, 1))
+                << ",\"allocationsPerOp\":" << format("%.3f", (double) allocations / std::max<uint64_t>(operations, 1))
+                << ",\"peakRssKiB\":" << getPeakRssKiB() << "}\n";
+            out.flush();
+            return;
+        }
+    }
+};
+
+#endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_BENCHMARK_H
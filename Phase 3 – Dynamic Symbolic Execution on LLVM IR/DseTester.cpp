@@ -3,6 +3,10 @@
 #include <set>
 #include <cstdlib>
 #include <random>
+#include <atomic>
+#include <functional>
+#include <mutex>
+#include <thread>
 
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
@@ -12,72 +16,612 @@
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
+#include "llvm/Support/CommandLine.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Format.h"
 
+#include "AllocationCounter.h"
+#include "FunctionPool.h"
+#include "Instrumentation.h"
+#include "JitNavigator.h"
+#include "ModuleLoader.h"
 #include "PathNavigator.h"
+#include "ResultWriter.h"
 #include "Solver.h"
 #include "DseTester.h"
+#include "TestServer.h"
 
 using namespace llvm;
 
+static cl::OptionCategory dseTesterCategory("DSE tester options");
+
+static cl::opt<std::string> inputFilename(
+        cl::Positional, cl::desc("<input .ll file or directory>"), cl::cat(dseTesterCategory)
+);
+
+static cl::opt<bool> allFunctions(
+        "all-functions",
+        cl::desc("Test every function defined in the input instead of main, a directory input tests every "
+                 ".ll and .bc file in it"),
+        cl::init(false),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<unsigned> workers(
+        "workers",
+        cl::desc("Number of functions tested at once with --all-functions (default: all hardware threads)"),
+        cl::init(std::thread::hardware_concurrency()),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<uint64_t> randomSeed(
+        "seed",
+        cl::desc("Master random seed, the seed of every run is printed so it can be replayed"),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<uint64_t> maxSteps(
+        "max-steps",
+        cl::desc("Maximum number of blocks one navigation may enter before it is reported as a timeout (0: no limit)"),
+        cl::init(100000),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<double> maxTime(
+        "max-time",
+        cl::desc("Maximum number of seconds one navigation may run before it is reported as a timeout (0: no limit)"),
+        cl::init(0),
+        cl::cat(dseTesterCategory)
+);
+
+enum class Engine {
+    Interpreter,
+    Jit,
+};
+
+static cl::opt<Engine> engine(
+        "engine",
+        cl::desc("Execution backend of the navigations"),
+        cl::values(
+                clEnumValN(Engine::Interpreter, "interp", "Walk the IR of the function (default)"),
+                clEnumValN(Engine::Jit, "jit", "Run an instrumented copy of the function natively with ORC LLJIT")
+        ),
+        cl::init(Engine::Interpreter),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<bool> printStats(
+        "print-stats",
+        cl::desc("Print the module load time, the number of iterations and heap allocations of the run and, in a "
+                 "build with INSTRUMENTATION, the timers, counters and histograms of the hot paths"),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<bool> materializeAll(
+        "materialize-all",
+        cl::desc("Read every function of a bitcode input, not only those reachable from the tested functions"),
+        cl::init(false),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<ResultFormat> outputFormat(
+        "output-format",
+        cl::desc("Format of the generated tests"),
+        cl::values(
+                clEnumValN(ResultFormat::Text, "text", "Banner-delimited text (default)"),
+                clEnumValN(ResultFormat::Jsonl, "jsonl", "One JSON object per test"),
+                clEnumValN(ResultFormat::Binary, "binary", "Length-prefixed binary records")
+        ),
+        cl::init(ResultFormat::Text),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<std::string> outputFilename(
+        "output",
+        cl::desc("File the jsonl or binary tests are written to (default: standard output)"),
+        cl::value_desc("filename"),
+        cl::init("-"),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<bool> asyncOutput(
+        "async-output",
+        cl::desc("Write jsonl or binary tests from a background thread"),
+        cl::init(false),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<std::string> serveSocket(
+        "serve",
+        cl::desc("Run as a daemon that answers test requests on a Unix domain socket, --workers requests at once"),
+        cl::value_desc("socket path"),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<uint64_t> cacheMemory(
+        "cache-memory",
+        cl::desc("Heap size in MiB over which the daemon evicts the least recently used modules"),
+        cl::init(2048),
+        cl::cat(dseTesterCategory)
+);
+
+static cl::opt<std::string> traceFilename(
+        "trace",
+        cl::desc("Write the timed scopes of the hot paths as a Chrome trace (needs a build with INSTRUMENTATION)"),
+        cl::value_desc("filename"),
+        cl::cat(dseTesterCategory)
+);
+
+// how testFunction runs, from the command line or from a daemon request
+struct TestOptions {
+    Engine engine;
+    ExecutionBudget budget;
+    uint64_t seed;
+    bool printStatistics;
+};
+
+TestOptions getCommandLineTestOptions() {
+    return {engine, ExecutionBudget{maxSteps, maxTime}, getMasterSeed(), printStats};
+}
+
+// analyses of a function that do not depend on the test options, the daemon keeps them between requests
+struct FunctionAnalysis {
+    Function &function;
+    std::set<std::string> inputArguments;
+    // blocks and comparisons of the function, shared by every run
+    BlockSummaryTable summary;
+    // only built for native navigations, by prepare
+    std::unique_ptr<JitFunction> jitFunction;
+
+    explicit FunctionAnalysis(Function &function)
+            : function(function), inputArguments(getInputArguments(function, "a")), summary(function) {}
+
+    /**
+     * @throws std::runtime_error if the function can not be compiled for the engine
+     */
+    void prepare(Engine engine) {
+        if (engine == Engine::Jit && jitFunction == nullptr) {
+            jitFunction = std::make_unique<JitFunction>(function, inputArguments);
+        }
+    }
+};
+
 LLVMContext &getGlobalContext() {
     static LLVMContext context;
     return context;
 }
 
 
-int main(int argc, char *argv[]) {
-    // Read the IR file.
-    LLVMContext & context = getGlobalContext();
-    SMDiagnostic err;
-    std::unique_ptr<Module> M = parseIRFile(argv[1], err, context);
-    if (M == nullptr) {
-        fprintf(stderr, "error: failed to load LLVM IR file \"%s\"", argv[1]);
-        return EXIT_FAILURE;
+void printPath(raw_ostream &out, const Path &path) {
+    out << "************** Input Argument(s) ***************" << "\n";
+    for (auto &arg: path.argumentsMap) {
+        out << arg.first << " = " << arg.second << "\n";
     }
 
-    BasicBlock *mainBasicBlock;
-    // initial mainBasicBlock
-    for (auto &F: *M) {
-        if (F.getName() == "main") {
-            mainBasicBlock = &F.getEntryBlock();
-            break;
+    out << "*************** Navigated Path *****************" << "\n";
+    for (auto &basicBlock: path.navigatedPath) {
+        out << getSimpleNodeName(basicBlock) << "\n";
+    }
+    if (path.status != NavigationStatus::Completed) {
+        out << "... " << navigationStatusToString(path.status) << "\n";
+    }
+
+    if (!path.loopIterations.empty()) {
+        out << "*************** Loop Iterations ****************" << "\n";
+        for (auto &loop: path.loopIterations) {
+            out << getSimpleNodeName(loop.first) << ": " << loop.second << "\n";
         }
     }
+}
 
-    std::set<BasicBlock *> allBlocks;
-    // find all blocks and store them in a set
-    for (auto &F: *M) {
-        for (auto &BB: F) {
-            allBlocks.insert(&BB);
+/**
+ * @brief Fills a TestRecord with a navigated path
+ * @param coveredBlocks blocks covered by the previous paths, updated with the blocks of this one
+ */
+void recordPath(TestRecord &record, std::set<BasicBlock *> &coveredBlocks, const Path &path) {
+    record.clear();
+    for (auto &argument: path.argumentsMap) {
+        record.inputs.emplace_back(argument.first, argument.second);
+    }
+    for (auto basicBlock: path.navigatedPath) {
+        record.path.push_back(getSimpleNodeName(basicBlock));
+        if (coveredBlocks.insert(basicBlock).second) {
+            record.newBlocks.push_back(record.path.back());
         }
     }
+    for (auto &condition: path.conditions) {
+        record.comparisons.push_back(PathConditionToString(condition));
+    }
+    record.status = navigationStatusToString(path.status);
+    record.coveredBlocks = coveredBlocks.size();
+}
 
+/**
+ * @param module the tested module, its materialized functions are counted
+ */
+void printStartup(raw_ostream &out, double loadSeconds, const Module *module) {
+    out << "******************* Startup ********************" << "\n";
+    out << "Module load: " << format("%.3f", loadSeconds * 1000) << " ms\n";
+    if (module != nullptr) {
+        out << "Materialized functions: " << ModuleLoader::getMaterializedFunctionCount(*module) << "/"
+            << ModuleLoader::getDefinedFunctionCount(*module) << "\n";
+    }
+}
+
+/**
+ * @brief Runs dynamic symbolic execution on one function
+ *
+ * The first inputs are drawn from threadRandomEngine().
+ * @param analysis prepared for options.engine
+ * @param out text tests
+ * @param summaryStream coverage and statistics
+ * @param writeRecord receives the tests when the output format is structured, empty for the text format
+ */
+void testFunction(const FunctionAnalysis &analysis, const TestOptions &options, raw_ostream &out,
+                  raw_ostream &summaryStream, const std::function<void(const TestRecord &)> &writeRecord) {
+    Function &function = analysis.function;
     auto dseTester = DseTester(
-            mainBasicBlock,
-            getInputArguments(mainBasicBlock, "a"),
+            &function.getEntryBlock(),
+            analysis.inputArguments,
             -200'000,
-            200'000
+            200'000,
+            options.budget,
+            options.engine == Engine::Jit ? analysis.jitFunction.get() : nullptr
     );
 
-    auto navigatedPaths = dseTester.run();
+    uint64_t allocationsBeforeRun = getHeapAllocationCount();
+    auto navigatedPaths = dseTester.run(analysis.summary);
+    uint64_t runAllocations = getHeapAllocationCount() - allocationsBeforeRun;
     std::set<BasicBlock *> navigatedBlocks;
 
+    TestRecord testRecord;
+    testRecord.module = function.getParent()->getModuleIdentifier();
+    testRecord.function = function.getName().str();
     for (auto &path: navigatedPaths) {
-        outs() << "************** Input Argument(s) ***************" << "\n";
-        for (auto &arg: path.argumentsMap) {
-            outs() << arg.first << " = " << arg.second << "\n";
+        if (writeRecord) {
+            recordPath(testRecord, navigatedBlocks, path);
+            writeRecord(testRecord);
+            testRecord.id++;
+            continue;
+        }
+
+        printPath(out, path);
+        navigatedBlocks.insert(path.navigatedPath.begin(), path.navigatedPath.end());
+    }
+
+    summaryStream << "****************** Coverage ********************" << "\n";
+    summaryStream << (int)((float) navigatedBlocks.size() / function.size() * 100) << "%\n";
+
+    if (options.printStatistics) {
+        summaryStream << "****************** Statistics ******************" << "\n";
+        summaryStream << "Iterations: " << dseTester.getIterationCount() << "\n";
+        summaryStream << "Heap allocations: " << runAllocations << "\n";
+        summaryStream << "Heap allocations of navigation and solving after the first iteration: "
+                      << dseTester.getHotPathAllocationCount() << "\n";
+    }
+}
+
+/**
+ * @brief Tests every defined function of the input files on a FunctionPool
+ *
+ * The tests of a function are collected while it runs and printed in one piece, so the output of
+ * different functions never interleaves.
+ * @param loadSeconds increased by the time the workers spent loading modules
+ * @return number of functions that could not be tested
+ */
+unsigned testAllFunctions(const std::vector<FunctionTask> &tasks, raw_ostream &summaryStream,
+                          ResultWriter *resultWriter, double &loadSeconds) {
+    std::mutex outputMutex;
+    std::atomic<unsigned> failedFunctions{0};
+
+    FunctionPool pool(tasks, materializeAll);
+    pool.run(workers, [&](size_t, const FunctionTask &task, Function *function) {
+        std::string text, summary;
+        raw_string_ostream textStream(text), summaryTextStream(summary);
+        std::vector<TestRecord> records;
+        std::string error;
+
+        if (function == nullptr) {
+            error = "failed to load LLVM IR file \"" + task.filename + "\"";
+        } else {
+            // the summary of a structured run goes to its own stream, it needs the banner too
+            raw_ostream &bannerStream = resultWriter != nullptr ? summaryTextStream : textStream;
+            bannerStream << "****************** Function ********************" << "\n";
+            bannerStream << task.filename << ": " << task.functionName << "\n";
+            std::function<void(const TestRecord &)> writeRecord;
+            if (resultWriter != nullptr) {
+                writeRecord = [&](const TestRecord &record) {
+                    records.push_back(record);
+                };
+            }
+            try {
+                FunctionAnalysis analysis(*function);
+                analysis.prepare(engine);
+                testFunction(analysis, getCommandLineTestOptions(), textStream,
+                             resultWriter != nullptr ? summaryTextStream : textStream, writeRecord);
+            } catch (const std::runtime_error &exception) {
+                error = exception.what();
+            }
         }
 
-        outs() << "*************** Navigated Path *****************" << "\n";
-        for (auto &basicBlock: path.navigatedPath) {
-            outs() << getSimpleNodeName(basicBlock) << "\n";
-            navigatedBlocks.insert(basicBlock);
+        std::lock_guard<std::mutex> lock(outputMutex);
+        if (!error.empty()) {
+            failedFunctions++;
+            errs() << "error: " << task.filename << ": " << task.functionName << ": " << error << "\n";
         }
+        outs() << textStream.str();
+        summaryStream << summaryTextStream.str();
+        for (auto &record: records) {
+            resultWriter->write(record);
+        }
+    });
+    loadSeconds += pool.getLoadSeconds();
+    return failedFunctions;
+}
+
+uint64_t getUnsignedField(const ServerRequest &request, const std::string &key, uint64_t defaultValue) {
+    auto it = request.find(key);
+    if (it == request.end()) {
+        return defaultValue;
     }
+    char *end;
+    errno = 0;
+    uint64_t value = std::strtoull(it->second.c_str(), &end, 10);
+    if (it->second.empty() || *end != '\0' || errno != 0) {
+        throw std::runtime_error("invalid value \"" + it->second + "\" for " + key);
+    }
+    return value;
+}
 
-    outs() << "****************** Coverage ********************" << "\n";
-    outs() << (int)((float) navigatedBlocks.size() / allBlocks.size() * 100) << "%\n";
+double getDoubleField(const ServerRequest &request, const std::string &key, double defaultValue) {
+    auto it = request.find(key);
+    if (it == request.end()) {
+        return defaultValue;
+    }
+    char *end;
+    double value = std::strtod(it->second.c_str(), &end);
+    if (it->second.empty() || *end != '\0') {
+        throw std::runtime_error("invalid value \"" + it->second + "\" for " + key);
+    }
+    return value;
+}
+
+/**
+ * @brief Test options of a daemon request, the command line gives the defaults
+ *
+ * Fields: engine (interp or jit), seed, max-steps and max-time, with the meaning of the options of the same name.
+ * @throws std::runtime_error if a field has an invalid value
+ */
+TestOptions getRequestTestOptions(const ServerRequest &request) {
+    TestOptions options = getCommandLineTestOptions();
+    auto engineField = request.find("engine");
+    if (engineField != request.end()) {
+        if (engineField->second == "interp") {
+            options.engine = Engine::Interpreter;
+        } else if (engineField->second == "jit") {
+            options.engine = Engine::Jit;
+        } else {
+            throw std::runtime_error("invalid value \"" + engineField->second + "\" for engine");
+        }
+    }
+    options.seed = getUnsignedField(request, "seed", options.seed);
+    options.budget.maxSteps = getUnsignedField(request, "max-steps", options.budget.maxSteps);
+    options.budget.maxSeconds = getDoubleField(request, "max-time", options.budget.maxSeconds);
+    return options;
+}
+
+/**
+ * @brief Answers one daemon request
+ *
+ * A test request has the module file, the function (default main) and the test options of
+ * getRequestTestOptions. The tests are streamed back as jsonl records while they are found, then a last line
+ * has the status, the seed, whether the module was cached and the text summary. command=stats answers with the
+ * counters of the module cache.
+ */
+void handleRequest(ModuleCache<FunctionAnalysis> &cache, const ServerRequest &request, FILE *response) {
+    std::string status;
+    auto command = request.find("command");
+    if (command != request.end() && command->second == "stats") {
+        size_t cachedModules;
+        uint64_t hits, misses, evictions;
+        cache.getStatistics(cachedModules, hits, misses, evictions);
+        status = "{\"status\":\"ok\",\"modules\":" + std::to_string(cachedModules) +
+                 ",\"hits\":" + std::to_string(hits) + ",\"misses\":" + std::to_string(misses) +
+                 ",\"evictions\":" + std::to_string(evictions) +
+                 ",\"heapBytes\":" + std::to_string(sys::Process::GetMallocUsage()) + "}\n";
+        fputs(status.c_str(), response);
+        return;
+    }
+
+    std::string summary;
+    raw_string_ostream summaryStream(summary);
+    std::string error;
+    bool isHit = false;
+    TestOptions options{};
+    ResultWriter writer(response, ResultFormat::Jsonl);
+    try {
+        options = getRequestTestOptions(request);
+        auto module = request.find("module");
+        if (module == request.end()) {
+            throw std::runtime_error("the request has no module");
+        }
+        auto function = request.find("function");
+        auto cachedModule = cache.get(module->second, isHit);
+
+        FunctionAnalysis *analysis;
+        {
+            std::unique_lock<std::shared_timed_mutex> lock(cachedModule->mutex);
+            analysis = &cachedModule->getAnalysis(function != request.end() ? function->second : "main");
+            analysis->prepare(options.engine);
+        }
+
+        std::shared_lock<std::shared_timed_mutex> lock(cachedModule->mutex);
+        threadRandomEngine() = RandomEngine(options.seed, 0);
+        testFunction(*analysis, options, nulls(), summaryStream, [&](const TestRecord &record) {
+            writer.write(record);
+            writer.flush();
+        });
+        writer.close();
+    } catch (const std::runtime_error &exception) {
+        error = exception.what();
+    }
+
+    status = "{\"status\":";
+    ResultWriter::appendJsonString(status, error.empty() ? "ok" : "error");
+    if (!error.empty()) {
+        status += ",\"error\":";
+        ResultWriter::appendJsonString(status, error);
+    }
+    status += ",\"seed\":" + std::to_string(options.seed);
+    status += std::string(",\"cached\":") + (isHit ? "true" : "false");
+    status += ",\"summary\":";
+    ResultWriter::appendJsonString(status, summaryStream.str());
+    status += "}\n";
+    fputs(status.c_str(), response);
+}
+
+/**
+ * @brief Prints the instrumentation summary with --print-stats and writes the --trace file
+ * @return false if the trace could not be written
+ */
+bool reportInstrumentation(raw_ostream &summaryStream) {
+    if (printStats) {
+        Instrumentation::get().printSummary(summaryStream);
+    }
+    if (!traceFilename.empty()) {
+        try {
+            Instrumentation::get().writeTrace(traceFilename);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char *argv[]) {
+    cl::HideUnrelatedOptions(dseTesterCategory);
+    cl::ParseCommandLineOptions(argc, argv, "Dynamic symbolic execution tester for LLVM IR\n");
+
+    if (randomSeed.getNumOccurrences() > 0) {
+        setMasterSeed(randomSeed);
+    }
+    errs() << "Seed: " << getMasterSeed() << "\n";
 
+    if (!traceFilename.empty()) {
+        if (!Instrumentation::ENABLED) {
+            fprintf(stderr, "error: --trace needs a build with INSTRUMENTATION defined\n");
+            return EXIT_FAILURE;
+        }
+        Instrumentation::get().setTracing(true);
+    }
+
+    if (!serveSocket.empty()) {
+        ModuleCache<FunctionAnalysis> cache(cacheMemory << 20);
+        TestServer server(serveSocket, workers, [&](const ServerRequest &request, FILE *response) {
+            handleRequest(cache, request, response);
+        });
+        errs() << "Serving on " << serveSocket << "\n";
+        try {
+            server.run();
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        return reportInstrumentation(errs()) ? 0 : EXIT_FAILURE;
+    }
+    if (inputFilename.empty()) {
+        fprintf(stderr, "error: no input file, pass an .ll file, a directory or --serve\n");
+        return EXIT_FAILURE;
+    }
+
+    if (outputFormat == ResultFormat::Text && outputFilename != "-") {
+        fprintf(stderr, "error: --output needs --output-format=jsonl or --output-format=binary\n");
+        return EXIT_FAILURE;
+    }
+    std::unique_ptr<ResultWriter> resultWriter;
+    if (outputFormat != ResultFormat::Text) {
+        try {
+            resultWriter = std::make_unique<ResultWriter>(outputFilename, outputFormat, asyncOutput);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
+    // with a structured format the output only has tests, summaries go to stderr
+    raw_ostream &summaryStream = resultWriter != nullptr ? errs() : outs();
+
+    int exitCode = 0;
+    double loadSeconds = 0;
+    // the module main is tested in, nullptr when several functions are tested
+    std::unique_ptr<Module> M;
+    if (allFunctions || sys::fs::is_directory(inputFilename)) {
+        // the listing only reads declarations, the workers load what they test
+        ModuleLoader listingLoader;
+        std::vector<FunctionTask> tasks;
+        try {
+            tasks = listDefinedFunctions(listInputFiles(inputFilename), listingLoader);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        loadSeconds = listingLoader.getLoadSeconds();
+
+        unsigned failedFunctions = testAllFunctions(tasks, summaryStream, resultWriter.get(), loadSeconds);
+        summaryStream << "****************** Functions *******************" << "\n";
+        summaryStream << "Tested functions: " << tasks.size() - failedFunctions << "/" << tasks.size() << "\n";
+        exitCode = failedFunctions > 0 ? EXIT_FAILURE : 0;
+    } else {
+        // Read the IR file, a bitcode file only up to the functions main reaches.
+        LLVMContext & context = getGlobalContext();
+        ModuleLoader moduleLoader(materializeAll);
+        Function *mainFunction;
+        try {
+            M = moduleLoader.load(inputFilename, context);
+            mainFunction = M->getFunction("main");
+            if (mainFunction == nullptr || mainFunction->isDeclaration()) {
+                fprintf(stderr, "error: function \"main\" not found in \"%s\"\n", inputFilename.c_str());
+                return EXIT_FAILURE;
+            }
+            moduleLoader.materialize(*mainFunction);
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+        loadSeconds = moduleLoader.getLoadSeconds();
+
+        std::function<void(const TestRecord &)> writeRecord;
+        if (resultWriter != nullptr) {
+            writeRecord = [&](const TestRecord &record) {
+                resultWriter->write(record);
+            };
+        }
+        try {
+            FunctionAnalysis analysis(*mainFunction);
+            analysis.prepare(engine);
+            testFunction(analysis, getCommandLineTestOptions(), outs(), summaryStream, writeRecord);
+        } catch (const std::runtime_error &error) {
+            outs().flush();
+            fprintf(stderr, "error: %s\n", error.what());
+            exitCode = EXIT_FAILURE;
+        }
+    }
+
+    if (printStats) {
+        printStartup(summaryStream, loadSeconds, M.get());
+    }
+    if (!reportInstrumentation(summaryStream)) {
+        exitCode = EXIT_FAILURE;
+    }
+
+    if (resultWriter != nullptr) {
+        try {
+            resultWriter->close();
+        } catch (const std::runtime_error &error) {
+            fprintf(stderr, "error: %s\n", error.what());
+            return EXIT_FAILURE;
+        }
+    }
 
 //    {
 //        outs() << "&&&&&&&&&&&&&&& test1 &&&&&&&&&&&&" << "\n";
@@ -155,5 +699,5 @@ int main(int argc, char *argv[]) {
 //    }
 
 
-    return 0;
+    return exitCode;
 }
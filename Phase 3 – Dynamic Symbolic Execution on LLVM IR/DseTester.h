@@ -17,6 +17,11 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "AllocationCounter.h"
+#include "BlockSummary.h"
+#include "ExecutionBudget.h"
+#include "Instrumentation.h"
+#include "JitNavigator.h"
 #include "PathNavigator.h"
 #include "Solver.h"
 #include "Utils.h"
@@ -28,7 +33,7 @@ class DseTester {
     // 1. navigate random path
     // 2. filter conditions that belong to input arguments
     // 3. negate last condition
-    // 4. pass it to solver and get new input arguments
+    // 4. pass it to solver and get new input arguments, back off to the condition before it if it can not hold
     // 5. navigate new path and save paths
     // 6. do this until first duplicate path is found
 
@@ -37,93 +42,181 @@ public:
     BasicBlock *entryBlock;
     std::set<std::string> inputArguments;
     int minRange, maxRange;
+    ExecutionBudget budget;
+    // paths are navigated natively when it is given
+    const JitFunction *jitFunction;
 
-    DseTester(BasicBlock *entryBlock, std::set<std::string> inputArguments, int minRange, int maxRange)
+    DseTester(BasicBlock *entryBlock, std::set<std::string> inputArguments, int minRange, int maxRange,
+              const ExecutionBudget &budget = {0, 0}, const JitFunction *jitFunction = nullptr)
             : entryBlock(entryBlock), inputArguments(std::move(inputArguments)),
-              minRange(minRange), maxRange(maxRange) {}
+              minRange(minRange), maxRange(maxRange), budget(budget), jitFunction(jitFunction) {}
 
     std::vector<Path> run() {
+        // blocks and comparisons of the function are analyzed once and shared by every iteration
+        BlockSummaryTable summary(*entryBlock->getParent());
+        return run(summary);
+    }
 
-        std::vector<Path> navigatedPaths;
+    // with the blocks of the function analyzed beforehand, e.g. by a daemon that keeps them between runs
+    std::vector<Path> run(const BlockSummaryTable &summary) {
+        iterations = 0;
+        hotPathAllocations = 0;
+
+        Solver solver(*entryBlock->getParent(), inputArguments, minRange, maxRange);
+
+        if (jitFunction != nullptr) {
+            JitNavigator jitNavigator(*jitFunction, budget);
+            return run(jitNavigator, getInputSlots(*jitFunction), solver);
+        }
+        PathNavigator pathNavigator(summary, budget);
+        return run(pathNavigator, getInputSlots(summary), solver);
+    }
+
+    // navigations of the last run
+    uint64_t getIterationCount() const {
+        return iterations;
+    }
+
+    // heap allocations of navigation and solving, after the first iteration has sized every buffer
+    // (saving a new path is not counted)
+    uint64_t getHotPathAllocationCount() const {
+        return hotPathAllocations;
+    }
 
-        auto currentArgumentsMap = randomInitialize(
-                inputArguments,
-                minRange,
-                maxRange
-        );
+private:
+
+    uint64_t iterations = 0;
+    uint64_t hotPathAllocations = 0;
+
+    // slot of each input argument in the navigator, -1 if the function never uses it
+    template<typename SlotTable>
+    std::vector<int> getInputSlots(const SlotTable &slotTable) const {
+        std::vector<int> inputSlots;
+        for (auto &variable: inputArguments) {
+            inputSlots.push_back(getSlot(slotTable, variable));
+        }
+        return inputSlots;
+    }
+
+    static int getSlot(const BlockSummaryTable &summary, const std::string &variable) {
+        return summary.getSlot(variable);
+    }
+
+    static int getSlot(const JitFunction &function, const std::string &variable) {
+        return function.getInputSlot(variable);
+    }
+
+    /**
+     * @brief Runs the DSE loop with one navigator
+     *
+     * The navigator, the solver and the condition buffers are reused by every iteration, only a new path
+     * allocates (to be saved).
+     */
+    template<typename Navigator>
+    std::vector<Path> run(Navigator &pathNavigator, const std::vector<int> &inputSlots, Solver &solver) {
+        std::vector<Path> navigatedPaths;
+        std::vector<PathCondition> filteredConditions;
+        InputAssignment currentAssignment = randomInitialize(inputArguments.size(), minRange, maxRange);
 
         while (true) {
-            auto pathNavigator = PathNavigator(entryBlock, currentArgumentsMap);
+            INSTRUMENT_SCOPE("DseTester::iteration");
+            bool isFirstIteration = iterations++ == 0;
+            uint64_t allocationsBefore = getHeapAllocationCount();
+
+            pathNavigator.reset();
+            for (size_t input = 0; input < inputSlots.size(); input++) {
+                if (inputSlots[input] >= 0 && currentAssignment.assigned[input]) {
+                    pathNavigator.setArgument(inputSlots[input], currentAssignment.values[input]);
+                }
+            }
             pathNavigator.navigate();
+            INSTRUMENT_HISTOGRAM("DseTester::pathLength", pathNavigator.getPath().size());
 
             // if navigated path is already exists break
-            for (auto &path: navigatedPaths) {
-                if (path.navigatedPath == pathNavigator.getPath()) {
-                    return navigatedPaths;
-                }
+            if (isNavigated(navigatedPaths, pathNavigator.getPath())) {
+                return navigatedPaths;
+            }
+            uint64_t allocationsBeforeSaving = getHeapAllocationCount();
+            {
+                INSTRUMENT_SCOPE("DseTester::savePath");
+                navigatedPaths.emplace_back(getArgumentsMap(currentAssignment), pathNavigator.getPath(),
+                                            pathNavigator.getStatus(), getLoopIterationsMap(pathNavigator),
+                                            pathNavigator.getConditions());
             }
-            navigatedPaths.emplace_back(currentArgumentsMap, pathNavigator.getPath());
+            uint64_t allocationsAfterSaving = getHeapAllocationCount();
 
-            auto filteredCmpInsts = filterCmpInstsBaseOnInputArgs(pathNavigator.getCmpInstructions());
+            filterConditionsBaseOnInputArgs(solver, pathNavigator.getConditions(), filteredConditions);
+            INSTRUMENT_HISTOGRAM("DseTester::filteredConditions", filteredConditions.size());
+            if (filteredConditions.empty()) {
+                // no condition left to negate, no new input can be derived
+                return navigatedPaths;
+            }
 
-            auto negateOfLast = negateCmpInst(filteredCmpInsts.back());
-            filteredCmpInsts.pop_back();
-            filteredCmpInsts.push_back(negateOfLast);
+            // a negated condition that can not hold with the ones before it is dropped, and the one before it is
+            // negated instead, the inputs no condition constrains keep their values
+            negateCondition(filteredConditions.back());
+            while (!solver.solve(filteredConditions, currentAssignment)) {
+                filteredConditions.pop_back();
+                if (filteredConditions.empty()) {
+                    return navigatedPaths;
+                }
+                negateCondition(filteredConditions.back());
+            }
 
-            auto solver = Solver(filteredCmpInsts, minRange, maxRange);
-            currentArgumentsMap = solver.solve();
+            if (!isFirstIteration) {
+                hotPathAllocations += getHeapAllocationCount() - allocationsBefore -
+                                      (allocationsAfterSaving - allocationsBeforeSaving);
+            }
         }
+    }
 
-        return navigatedPaths;
+    std::map<std::string, int64_t> getArgumentsMap(const InputAssignment &inputAssignment) const {
+        std::map<std::string, int64_t> argumentsMap;
+        size_t input = 0;
+        for (auto &variable: inputArguments) {
+            if (inputAssignment.assigned[input]) {
+                argumentsMap[variable] = inputAssignment.values[input];
+            }
+            input++;
+        }
+        return argumentsMap;
     }
 
-    std::vector<ICmpInst *> filterCmpInstsBaseOnInputArgs(
-            const std::vector<ICmpInst *> &cmpInsts) {
-        std::vector<ICmpInst *> filteredCmpInsts;
-        for (const auto &cmpInstruction: cmpInsts) {
-            auto opCmp1 = cmpInstruction->getOperand(0);
-            auto opCmp2 = cmpInstruction->getOperand(1);
-
-            // Example: a == b, a != b, a < b, a > b, a <= b, a >= b
-            if (isa<LoadInst>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                // if both opCmp1Name and opCmp2Name are in inputArguments
-                // then add this cmpInstruction to filteredCmpInsts
-                if (inputArguments.find(opCmp1Name) != inputArguments.end() &&
-                    inputArguments.find(opCmp2Name) != inputArguments.end()) {
-                    filteredCmpInsts.emplace_back(cmpInstruction);
-                }
+    // header of the loop -> number of times its back edge was taken, for the loops that were entered again
+    template<typename Navigator>
+    static std::map<BasicBlock *, uint64_t> getLoopIterationsMap(const Navigator &pathNavigator) {
+        std::map<BasicBlock *, uint64_t> loopIterations;
+        for (unsigned loop = 0; loop < pathNavigator.getLoopIterations().size(); loop++) {
+            if (pathNavigator.getLoopIterations()[loop] > 0) {
+                loopIterations[pathNavigator.getLoopHeader(loop)] = pathNavigator.getLoopIterations()[loop];
             }
-                // Example: a == 5
-            else if (isa<LoadInst>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
+        }
+        return loopIterations;
+    }
 
-                // if opCmp1Name is in inputArguments, then add this cmpInstruction to filteredCmpInsts
-                if (inputArguments.find(opCmp1Name) != inputArguments.end()) {
-                    filteredCmpInsts.emplace_back(cmpInstruction);
-                }
+    static bool isNavigated(const std::vector<Path> &navigatedPaths, const std::vector<BasicBlock *> &path) {
+        INSTRUMENT_SCOPE("DseTester::isNavigated");
+        for (auto &navigatedPath: navigatedPaths) {
+            if (navigatedPath.navigatedPath == path) {
+                return true;
             }
-                // Example: 7 == b
-            else if (isa<ConstantInt>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
+        }
+        return false;
+    }
 
-                // if opCmp2Name is in inputArguments, then add this cmpInstruction to filteredCmpInsts
-                if (inputArguments.find(opCmp2Name) != inputArguments.end()) {
-                    filteredCmpInsts.emplace_back(cmpInstruction);
-                }
+    static void filterConditionsBaseOnInputArgs(const Solver &solver, const std::vector<PathCondition> &conditions,
+                                                std::vector<PathCondition> &filteredConditions) {
+        INSTRUMENT_SCOPE("DseTester::filterConditionsBaseOnInputArgs");
+        filteredConditions.clear();
+        for (auto &condition: conditions) {
+            if (solver.isSolvable(condition)) {
+                filteredConditions.push_back(condition);
             }
         }
-        return filteredCmpInsts;
     }
 
-    static ICmpInst *negateCmpInst(ICmpInst *cmpInst) {
-        return new ICmpInst(
-                cmpInst->getInversePredicate(),
-                cmpInst->getOperand(0),
-                cmpInst->getOperand(1)
-        );
+    static void negateCondition(PathCondition &condition) {
+        condition.predicate = CmpInst::getInversePredicate(condition.predicate);
     }
 };
 
@@ -0,0 +1,160 @@
+#ifndef PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_FUNCTIONPOOL_H
+#define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_FUNCTIONPOOL_H
+
+#include <cstdio>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Path.h"
+
+#include "ModuleLoader.h"
+#include "RandomEngine.h"
+
+using namespace llvm;
+
+// a defined function of one of the input files
+struct FunctionTask {
+    std::string filename;
+    std::string functionName;
+};
+
+/**
+ * @brief Input files of a run: the file itself, or every .ll and .bc file of a directory in name order
+ */
+std::vector<std::string> listInputFiles(const std::string &path) {
+    if (!sys::fs::is_directory(path)) {
+        return {path};
+    }
+
+    std::vector<std::string> files;
+    std::error_code errorCode;
+    for (sys::fs::directory_iterator it(path, errorCode), end; it != end && !errorCode; it.increment(errorCode)) {
+        StringRef extension = sys::path::extension(it->path());
+        if ((extension == ".ll" || extension == ".bc") && sys::fs::is_regular_file(it->path())) {
+            files.push_back(it->path());
+        }
+    }
+    if (errorCode) {
+        throw std::runtime_error("failed to read directory \"" + path + "\": " + errorCode.message());
+    }
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+/**
+ * @brief Every function with a body in the given files, grouped by file
+ *
+ * Only the function declarations are needed, the loader should not materialize whole modules.
+ * @throws std::runtime_error if a file can not be loaded
+ */
+std::vector<FunctionTask> listDefinedFunctions(const std::vector<std::string> &files, ModuleLoader &loader) {
+    std::vector<FunctionTask> tasks;
+    for (auto &filename: files) {
+        LLVMContext context;
+        std::unique_ptr<Module> module = loader.load(filename, context);
+        for (auto &F: *module) {
+            if (!F.isDeclaration()) {
+                tasks.push_back({filename, F.getName().str()});
+            }
+        }
+    }
+    return tasks;
+}
+
+/**
+ * @brief Tests a list of functions on a pool of worker threads
+ *
+ * LLVM contexts are not thread safe, so every worker parses the modules it needs into a context of its own
+ * and keeps the last one loaded; tasks are grouped by file, so a worker parses a file at most once. Modules
+ * are loaded with a ModuleLoader of the worker and each task only materializes the functions its function
+ * reaches. Before each task the random engine of the worker is reseeded with the task index, a function
+ * gets the same inputs for a master seed whatever the number of workers.
+ */
+class FunctionPool {
+public:
+    // function is nullptr if it could not be loaded by the worker
+    using TaskCallback = std::function<void(size_t task, const FunctionTask &, Function *function)>;
+
+private:
+    const std::vector<FunctionTask> &tasks;
+    const bool materializeAll;
+    std::atomic<size_t> nextTask{0};
+
+    std::mutex loadSecondsMutex;
+    double loadSeconds = 0;
+
+    Function *loadFunction(ModuleLoader &loader, Module *module, const FunctionTask &task) {
+        Function *function = module != nullptr ? module->getFunction(task.functionName) : nullptr;
+        if (function == nullptr) {
+            return nullptr;
+        }
+        try {
+            loader.materialize(*function);
+        } catch (const std::runtime_error &) {
+            return nullptr;
+        }
+        return function;
+    }
+
+    void runWorker(const TaskCallback &testFunction) {
+        ModuleLoader loader(materializeAll);
+        std::unique_ptr<LLVMContext> context;
+        std::unique_ptr<Module> module;
+        std::string loadedFile;
+
+        size_t task;
+        while ((task = nextTask.fetch_add(1)) < tasks.size()) {
+            if (context == nullptr || loadedFile != tasks[task].filename) {
+                module.reset();
+                context = std::make_unique<LLVMContext>();
+                try {
+                    module = loader.load(tasks[task].filename, *context);
+                } catch (const std::runtime_error &) {
+                    // every task of the file is reported as not loaded
+                }
+                loadedFile = tasks[task].filename;
+            }
+
+            threadRandomEngine() = RandomEngine(getMasterSeed(), task);
+            testFunction(task, tasks[task], loadFunction(loader, module.get(), tasks[task]));
+        }
+
+        std::lock_guard<std::mutex> lock(loadSecondsMutex);
+        loadSeconds += loader.getLoadSeconds();
+    }
+
+public:
+    /**
+     * @param materializeAll read every function body of a module, not only those the tested functions reach
+     */
+    FunctionPool(const std::vector<FunctionTask> &tasks, bool materializeAll)
+            : tasks(tasks), materializeAll(materializeAll) {}
+
+    void run(unsigned workers, const TaskCallback &testFunction) {
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < std::max(1u, workers); i++) {
+            threads.emplace_back(&FunctionPool::runWorker, this, std::cref(testFunction));
+        }
+        for (auto &thread: threads) {
+            thread.join();
+        }
+    }
+
+    // time the workers spent loading modules and materializing functions, summed over the workers
+    double getLoadSeconds() const {
+        return loadSeconds;
+    }
+};
+
+#endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_FUNCTIONPOOL_H
@@ -0,0 +1,762 @@
+#ifndef PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_JITNAVIGATOR_H
+#define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_JITNAVIGATOR_H
+
+#include <cstdio>
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <map>
+#include <set>
+#include <cstdlib>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/IR/Instructions.h"
+#include "llvm/IR/Instruction.h"
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/Dominators.h"
+#include "llvm/Analysis/LoopInfo.h"
+#include "llvm/Bitcode/BitcodeReader.h"
+#include "llvm/Bitcode/BitcodeWriter.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include "llvm/Transforms/Utils/Cloning.h"
+
+#include "BlockSummary.h"
+#include "ExecutionBudget.h"
+#include "Instrumentation.h"
+#include "Utils.h"
+
+using namespace llvm;
+
+// what the hooks of one native run record, owned by the JitNavigator of the calling thread
+struct JitTrace {
+    const std::vector<int64_t> *inputs;
+    BudgetTracker budgetTracker;
+    NavigationStatus status = NavigationStatus::Completed;
+    bool divisionByZero = false;
+    std::vector<unsigned> blockTrace;
+    // block that was about to run when the budget ran out, the edge into it still counts for the loops
+    int64_t stoppedBlock = -1;
+    // (comparison index, result)
+    std::vector<std::pair<unsigned, bool>> cmpTrace;
+    std::vector<int64_t> variables;
+
+    JitTrace(const std::vector<int64_t> *inputs, const ExecutionBudget &budget, unsigned slotCount)
+            : inputs(inputs), budgetTracker(budget), variables(slotCount) {}
+
+    void reset() {
+        status = NavigationStatus::Completed;
+        divisionByZero = false;
+        blockTrace.clear();
+        stoppedBlock = -1;
+        cmpTrace.clear();
+    }
+};
+
+inline JitTrace *&currentJitTrace() {
+    thread_local JitTrace *trace = nullptr;
+    return trace;
+}
+
+/**
+ * @brief Native version of a function, JIT compiled once with ORC LLJIT and instrumented with trace hooks
+ *
+ * The module is copied into a private context through bitcode, so the parsed module is never modified. In
+ * the copy of the function:
+ * - input variables are initialized from the navigation inputs right after the entry allocas,
+ * - every block first reports its index to a hook that also enforces the ExecutionBudget; when the budget
+ *   is exhausted the block branches to an exit block instead of running,
+ * - every icmp reports its result,
+ * - integer divisions check their divisor and leave through the exit block on zero,
+ * - the other defined functions of the module count their blocks against the same budget and check their
+ *   divisors, they return a null value once the navigation stopped, and every call that may run one of them
+ *   leaves through the exit block if the navigation stopped inside it,
+ * - the parameters are reported on entry and the phis on entering their block, the variables in memory right
+ *   before every return and in the exit block.
+ *
+ * The function is called through a thunk without parameters, which reads the integer parameters from the
+ * navigation inputs, the parameter itself or the variable it is stored to (e.g. x.addr), and ignores what
+ * the function returns.
+ *
+ * Slots, blocks and loops are numbered like the BlockSummaryTable of the function, comparisons in function
+ * order, so the trace maps back onto the parsed function and the variables are the ones PathNavigator reports:
+ * parameters, phis, and the integer allocas of the entry block and integer globals.
+ */
+class JitFunction {
+private:
+    BlockSummaryTable summary;
+    std::unique_ptr<orc::LLJIT> jit;
+    void (*entry)() = nullptr;
+
+    std::vector<BasicBlock *> blocks;
+    std::vector<ICmpInst *> cmpInsts;
+    std::vector<bool> inputSlots;
+    // variable slots whose value the copy reports
+    std::vector<bool> reportedSlots;
+    // input slot each parameter is read from, -1 if it is none
+    std::vector<int> parameterSlots;
+    // (successor block, loop) for every back edge leaving each block
+    std::vector<std::vector<std::pair<unsigned, unsigned>>> backEdges;
+    std::vector<BasicBlock *> loopHeaders;
+
+    static int32_t onBlock(int32_t block) {
+        JitTrace *trace = currentJitTrace();
+        if ((trace->status = trace->budgetTracker.step()) != NavigationStatus::Completed) {
+            trace->stoppedBlock = block;
+            return 0;
+        }
+        trace->blockTrace.push_back(block);
+        return 1;
+    }
+
+    static void onCmp(int32_t cmp, int32_t result) {
+        currentJitTrace()->cmpTrace.emplace_back(cmp, result != 0);
+    }
+
+    static int64_t onInput(int32_t slot) {
+        return (*currentJitTrace()->inputs)[slot];
+    }
+
+    static void onVariable(int32_t slot, int64_t value) {
+        currentJitTrace()->variables[slot] = value;
+    }
+
+    static void onDivisionByZero() {
+        currentJitTrace()->divisionByZero = true;
+    }
+
+    // a block of another function, it counts against the budget but is not part of the path
+    static int32_t onCalleeBlock() {
+        JitTrace *trace = currentJitTrace();
+        if (trace->status == NavigationStatus::Completed) {
+            trace->status = trace->budgetTracker.step();
+        }
+        return trace->status == NavigationStatus::Completed;
+    }
+
+    static int32_t onReturn() {
+        JitTrace *trace = currentJitTrace();
+        return trace->status == NavigationStatus::Completed && !trace->divisionByZero;
+    }
+
+    static void initializeNativeTarget() {
+        static bool initialized = (InitializeNativeTarget(), InitializeNativeTargetAsmPrinter(), true);
+        (void) initialized;
+    }
+
+    template<typename T>
+    static T check(Expected<T> expected, const std::string &what) {
+        if (!expected) {
+            throw std::runtime_error(what + ": " + toString(expected.takeError()));
+        }
+        return std::move(*expected);
+    }
+
+    static void check(Error error, const std::string &what) {
+        if (error) {
+            throw std::runtime_error(what + ": " + toString(std::move(error)));
+        }
+    }
+
+    // functions of a lazily loaded module that were never materialized are only declared in the bitcode
+    static void writeMaterializedBitcode(const Module &module, raw_ostream &stream) {
+        auto isMaterialized = [](const GlobalValue *globalValue) {
+            auto *function = dyn_cast<Function>(globalValue);
+            return function == nullptr || !function->isMaterializable();
+        };
+        for (auto &F: module) {
+            if (!isMaterialized(&F)) {
+                ValueToValueMapTy valueMap;
+                WriteBitcodeToFile(*CloneModule(module, valueMap, isMaterialized), stream);
+                return;
+            }
+        }
+        WriteBitcodeToFile(module, stream);
+    }
+
+    // the variables kept in memory that are read back before returning, every path reaches their definition
+    static bool isMemoryVariable(const Value *value) {
+        if (auto *allocaInst = dyn_cast<AllocaInst>(value)) {
+            return allocaInst->getParent() == &allocaInst->getFunction()->getEntryBlock();
+        }
+        return isa<GlobalVariable>(value);
+    }
+
+    static bool isIntegerDivision(const Instruction *instruction) {
+        auto opCode = instruction->getOpcode();
+        return (opCode == Instruction::SDiv || opCode == Instruction::UDiv || opCode == Instruction::SRem ||
+                opCode == Instruction::URem) && instruction->getType()->isIntegerTy();
+    }
+
+    // a call that may run a defined function of the module, directly or through a pointer
+    static bool mayCallDefinedFunction(const CallInst *callInst) {
+        Function *callee = callInst->getCalledFunction();
+        return !callInst->isMustTailCall() && (callee == nullptr || !callee->isDeclaration());
+    }
+
+    static Instruction *getEntryBody(Function &function) {
+        for (auto &I: function.getEntryBlock()) {
+            if (!isa<AllocaInst>(&I)) {
+                return &I;
+            }
+        }
+        return nullptr;
+    }
+
+    // leaves through faultBlock before dividing by zero
+    static void checkDivisors(const std::vector<BinaryOperator *> &divisions, BasicBlock *faultBlock) {
+        for (auto division: divisions) {
+            Value *divisor = division->getOperand(1);
+            BasicBlock *head = division->getParent();
+            BasicBlock *rest = head->splitBasicBlock(division, head->getName() + ".div");
+            head->getTerminator()->eraseFromParent();
+            IRBuilder<> builder(head);
+            builder.CreateCondBr(builder.CreateICmpEQ(divisor, Constant::getNullValue(divisor->getType())),
+                                 faultBlock, rest);
+        }
+    }
+
+    // leaves through exitBlock right after a call if the navigation stopped inside it
+    static void checkCalls(const std::vector<CallInst *> &calls, FunctionCallee returnHook, BasicBlock *exitBlock) {
+        for (auto callInst: calls) {
+            BasicBlock *head = callInst->getParent();
+            BasicBlock *rest = head->splitBasicBlock(callInst->getNextNode(), head->getName() + ".call");
+            head->getTerminator()->eraseFromParent();
+            IRBuilder<> builder(head);
+            builder.CreateCondBr(builder.CreateICmpNE(builder.CreateCall(returnHook), builder.getInt32(0)),
+                                 rest, exitBlock);
+        }
+    }
+
+    /**
+     * @brief Makes a function called by the tested one stop with the navigation
+     *
+     * Its blocks only count against the budget, it is not traced. Once the navigation stopped, it returns a null
+     * value through an exit block, which its callers leave through their own exit block.
+     */
+    static void instrumentCallee(Function &function, FunctionCallee blockHook, FunctionCallee returnHook,
+                                 FunctionCallee divisionByZeroHook) {
+        LLVMContext &context = function.getContext();
+        std::vector<BasicBlock *> blocks;
+        std::vector<BinaryOperator *> divisions;
+        std::vector<CallInst *> calls;
+        for (auto &BB: function) {
+            blocks.push_back(&BB);
+            for (auto &I: BB) {
+                auto *callInst = dyn_cast<CallInst>(&I);
+                if (callInst != nullptr && mayCallDefinedFunction(callInst)) {
+                    calls.push_back(callInst);
+                } else if (isa<BinaryOperator>(&I) && isIntegerDivision(&I)) {
+                    divisions.push_back(dyn_cast<BinaryOperator>(&I));
+                }
+            }
+        }
+
+        BasicBlock *exitBlock = BasicBlock::Create(context, "jit.exit", &function);
+        if (function.getReturnType()->isVoidTy()) {
+            ReturnInst::Create(context, exitBlock);
+        } else {
+            ReturnInst::Create(context, Constant::getNullValue(function.getReturnType()), exitBlock);
+        }
+
+        for (auto head: blocks) {
+            Instruction *splitPoint = head == blocks.front() ? getEntryBody(function) : &*head->getFirstInsertionPt();
+            IRBuilder<> builder(splitPoint);
+            Value *withinBudget = builder.CreateICmpNE(builder.CreateCall(blockHook), builder.getInt32(0));
+            BasicBlock *body = head->splitBasicBlock(splitPoint, head->getName() + ".body");
+            head->getTerminator()->eraseFromParent();
+            BranchInst::Create(body, exitBlock, withinBudget, head);
+        }
+
+        if (!divisions.empty()) {
+            BasicBlock *divisionByZeroBlock = BasicBlock::Create(context, "jit.division.by.zero", &function);
+            IRBuilder<> builder(divisionByZeroBlock);
+            builder.CreateCall(divisionByZeroHook);
+            builder.CreateBr(exitBlock);
+            checkDivisors(divisions, divisionByZeroBlock);
+        }
+        checkCalls(calls, returnHook, exitBlock);
+    }
+
+    void analyze(Function &function, const std::set<std::string> &inputArguments) {
+        for (auto &BB: function) {
+            blocks.push_back(&BB);
+            for (auto &I: BB) {
+                auto *cmpInst = dyn_cast<ICmpInst>(&I);
+                if (cmpInst != nullptr && cmpInst->getType()->isIntegerTy()) {
+                    cmpInsts.push_back(cmpInst);
+                }
+            }
+        }
+
+        inputSlots.assign(summary.getSlotCount(), false);
+        for (auto &variable: inputArguments) {
+            int slot = summary.getSlot(variable);
+            if (slot >= 0) {
+                inputSlots[slot] = true;
+            }
+        }
+        for (unsigned slot = 0; slot < summary.getSlotCount(); slot++) {
+            const Value *value = summary.getSlotValue(slot);
+            reportedSlots.push_back(summary.isVariableSlot(slot) && summary.getSlotBits(slot) > 0 &&
+                                    (isa<Argument>(value) || isa<PHINode>(value) || isMemoryVariable(value)));
+        }
+
+        for (auto &argument: function.args()) {
+            if (!argument.getType()->isIntegerTy()) {
+                throw std::runtime_error("JIT navigation needs a function with integer parameters: " +
+                                         function.getName().str());
+            }
+            int slot = summary.getSlot(getSimpleNodeName(&argument));
+            parameterSlots.push_back(slot >= 0 && inputSlots[slot] ? slot : -1);
+        }
+        // the parameter copies of -O0 code, x.addr = x, where the alloca is the input
+        for (auto &I: function.getEntryBlock()) {
+            auto *storeInst = dyn_cast<StoreInst>(&I);
+            if (storeInst != nullptr && isa<Argument>(storeInst->getValueOperand())) {
+                int slot = summary.getSlot(getSimpleNodeName(storeInst->getPointerOperand()));
+                if (slot >= 0 && inputSlots[slot]) {
+                    parameterSlots[dyn_cast<Argument>(storeInst->getValueOperand())->getArgNo()] = slot;
+                }
+            }
+        }
+
+        DominatorTree dominatorTree(function);
+        LoopInfo loopInfo(dominatorTree);
+        std::map<const Loop *, unsigned> loopIndexOf;
+        for (Loop *loop: loopInfo.getLoopsInPreorder()) {
+            loopIndexOf[loop] = loopHeaders.size();
+            loopHeaders.push_back(loop->getHeader());
+        }
+        for (auto &BB: function) {
+            backEdges.emplace_back();
+            for (BasicBlock *successor: successors(&BB)) {
+                Loop *loop = loopInfo.getLoopFor(successor);
+                if (loop != nullptr && loop->getHeader() == successor && loop->contains(&BB)) {
+                    backEdges.back().emplace_back(summary.getBlockIndex(successor), loopIndexOf[loop]);
+                }
+            }
+        }
+    }
+
+    // the copy has the same blocks and instructions in the same order as the parsed function
+    void instrument(Function &original, Function &function) {
+        LLVMContext &context = function.getContext();
+        Module &module = *function.getParent();
+        Type *int32Ty = Type::getInt32Ty(context);
+        Type *int64Ty = Type::getInt64Ty(context);
+        Type *voidTy = Type::getVoidTy(context);
+
+        FunctionCallee blockHook = module.getOrInsertFunction(
+                "__jit_navigator_block", FunctionType::get(int32Ty, {int32Ty}, false));
+        FunctionCallee cmpHook = module.getOrInsertFunction(
+                "__jit_navigator_cmp", FunctionType::get(voidTy, {int32Ty, int32Ty}, false));
+        FunctionCallee inputHook = module.getOrInsertFunction(
+                "__jit_navigator_input", FunctionType::get(int64Ty, {int32Ty}, false));
+        FunctionCallee variableHook = module.getOrInsertFunction(
+                "__jit_navigator_variable", FunctionType::get(voidTy, {int32Ty, int64Ty}, false));
+        FunctionCallee divisionByZeroHook = module.getOrInsertFunction(
+                "__jit_navigator_division_by_zero", FunctionType::get(voidTy, false));
+        FunctionCallee calleeBlockHook = module.getOrInsertFunction(
+                "__jit_navigator_callee_block", FunctionType::get(int32Ty, false));
+        FunctionCallee returnHook = module.getOrInsertFunction(
+                "__jit_navigator_return", FunctionType::get(int32Ty, false));
+
+        // collect everything before the blocks are split
+        std::vector<BasicBlock *> copiedBlocks;
+        std::vector<ICmpInst *> copiedCmpInsts;
+        std::map<const Value *, Value *> copyOf;
+        std::vector<ReturnInst *> returnInsts;
+        std::vector<BinaryOperator *> divisions;
+        std::vector<CallInst *> calls;
+        Instruction *entryBody = nullptr;
+        for (auto &argument: original.args()) {
+            copyOf[&argument] = function.getArg(argument.getArgNo());
+        }
+        for (auto originalBB = original.begin(), BB = function.begin(); BB != function.end(); ++originalBB, ++BB) {
+            copiedBlocks.push_back(&*BB);
+            for (auto originalI = originalBB->begin(), I = BB->begin(); I != BB->end(); ++originalI, ++I) {
+                copyOf[&*originalI] = &*I;
+                if (&*BB == &function.getEntryBlock() && entryBody == nullptr && !isa<AllocaInst>(&*I)) {
+                    entryBody = &*I;
+                }
+                auto *cmpInst = dyn_cast<ICmpInst>(&*I);
+                if (cmpInst != nullptr && cmpInst->getType()->isIntegerTy()) {
+                    copiedCmpInsts.push_back(cmpInst);
+                } else if (auto *returnInst = dyn_cast<ReturnInst>(&*I)) {
+                    returnInsts.push_back(returnInst);
+                } else if (isa<BinaryOperator>(&*I) && isIntegerDivision(&*I)) {
+                    divisions.push_back(dyn_cast<BinaryOperator>(&*I));
+                } else if (isa<CallInst>(&*I) && mayCallDefinedFunction(dyn_cast<CallInst>(&*I))) {
+                    calls.push_back(dyn_cast<CallInst>(&*I));
+                }
+            }
+        }
+        if (copiedBlocks.size() != blocks.size() || copiedCmpInsts.size() != cmpInsts.size()) {
+            throw std::runtime_error("JIT copy of " + function.getName().str() + " does not match the original");
+        }
+
+        // the copy of the value of every reported slot, grouped by where it is reported
+        std::vector<std::pair<unsigned, Value *>> copiedParameters, copiedMemoryVariables;
+        std::map<BasicBlock *, std::vector<std::pair<unsigned, Value *>>> copiedPhisOf;
+        for (unsigned slot = 0; slot < summary.getSlotCount(); slot++) {
+            if (!reportedSlots[slot]) {
+                continue;
+            }
+            const Value *value = summary.getSlotValue(slot);
+            if (auto *globalVariable = dyn_cast<GlobalVariable>(value)) {
+                copiedMemoryVariables.emplace_back(slot, module.getNamedGlobal(globalVariable->getName()));
+            } else if (isa<Argument>(value)) {
+                copiedParameters.emplace_back(slot, copyOf.at(value));
+            } else if (isa<PHINode>(value)) {
+                auto *copiedPhi = dyn_cast<PHINode>(copyOf.at(value));
+                copiedPhisOf[copiedPhi->getParent()].emplace_back(slot, copiedPhi);
+            } else {
+                copiedMemoryVariables.emplace_back(slot, copyOf.at(value));
+            }
+        }
+
+        auto emitVariable = [&](IRBuilder<> &builder, unsigned slot, Value *value) {
+            builder.CreateCall(variableHook, {builder.getInt32(slot), builder.CreateSExtOrTrunc(value, int64Ty)});
+        };
+        auto emitVariableDump = [&](IRBuilder<> &builder) {
+            for (auto &memoryVariable: copiedMemoryVariables) {
+                const Value *variable = summary.getSlotValue(memoryVariable.first);
+                Type *type = isa<AllocaInst>(variable) ? dyn_cast<AllocaInst>(variable)->getAllocatedType()
+                                                       : dyn_cast<GlobalVariable>(variable)->getValueType();
+                emitVariable(builder, memoryVariable.first, builder.CreateLoad(type, memoryVariable.second));
+            }
+        };
+
+        // leaves the function once the budget is exhausted or a division by zero is caught, here or in a callee
+        BasicBlock *exitBlock = BasicBlock::Create(context, "jit.exit", &function);
+        {
+            IRBuilder<> builder(exitBlock);
+            emitVariableDump(builder);
+            if (function.getReturnType()->isVoidTy()) {
+                builder.CreateRetVoid();
+            } else {
+                builder.CreateRet(Constant::getNullValue(function.getReturnType()));
+            }
+        }
+
+        {
+            IRBuilder<> builder(entryBody);
+            for (unsigned slot = 0; slot < summary.getSlotCount(); slot++) {
+                auto *allocaInst = dyn_cast<AllocaInst>(summary.getSlotValue(slot));
+                if (inputSlots[slot] && allocaInst != nullptr && isMemoryVariable(allocaInst)) {
+                    Value *input = builder.CreateCall(inputHook, {builder.getInt32(slot)});
+                    builder.CreateStore(builder.CreateSExtOrTrunc(input, allocaInst->getAllocatedType()),
+                                        copyOf.at(allocaInst));
+                }
+            }
+            for (auto &parameter: copiedParameters) {
+                emitVariable(builder, parameter.first, parameter.second);
+            }
+        }
+
+        for (unsigned block = 0; block < copiedBlocks.size(); block++) {
+            BasicBlock *head = copiedBlocks[block];
+            Instruction *splitPoint = block == 0 ? entryBody : &*head->getFirstInsertionPt();
+            IRBuilder<> builder(splitPoint);
+            // the phis got their values on the edge the block was entered through, even if it does not run
+            for (auto &phi: copiedPhisOf[head]) {
+                emitVariable(builder, phi.first, phi.second);
+            }
+            Value *withinBudget = builder.CreateICmpNE(
+                    builder.CreateCall(blockHook, {builder.getInt32(block)}), builder.getInt32(0));
+            BasicBlock *body = head->splitBasicBlock(splitPoint, head->getName() + ".body");
+            head->getTerminator()->eraseFromParent();
+            BranchInst::Create(body, exitBlock, withinBudget, head);
+        }
+
+        for (unsigned cmp = 0; cmp < copiedCmpInsts.size(); cmp++) {
+            IRBuilder<> builder(copiedCmpInsts[cmp]->getNextNode());
+            builder.CreateCall(cmpHook, {builder.getInt32(cmp), builder.CreateZExt(copiedCmpInsts[cmp], int32Ty)});
+        }
+
+        for (auto returnInst: returnInsts) {
+            IRBuilder<> builder(returnInst);
+            emitVariableDump(builder);
+        }
+
+        if (!divisions.empty()) {
+            BasicBlock *divisionByZeroBlock = BasicBlock::Create(context, "jit.division.by.zero", &function);
+            IRBuilder<> faultBuilder(divisionByZeroBlock);
+            faultBuilder.CreateCall(divisionByZeroHook);
+            faultBuilder.CreateBr(exitBlock);
+            checkDivisors(divisions, divisionByZeroBlock);
+        }
+        checkCalls(calls, returnHook, exitBlock);
+
+        for (auto &F: module) {
+            if (&F != &function && !F.isDeclaration()) {
+                instrumentCallee(F, calleeBlockHook, returnHook, divisionByZeroHook);
+            }
+        }
+
+        // calls the function with its parameters read from the inputs, whatever its return type
+        Function *thunk = Function::Create(FunctionType::get(voidTy, false), GlobalValue::ExternalLinkage,
+                                           "__jit_navigator_entry", &module);
+        IRBuilder<> builder(BasicBlock::Create(context, "entry", thunk));
+        std::vector<Value *> arguments;
+        for (auto &argument: function.args()) {
+            int slot = parameterSlots[argument.getArgNo()];
+            arguments.push_back(slot < 0 ? Constant::getNullValue(argument.getType()) : builder.CreateSExtOrTrunc(
+                    builder.CreateCall(inputHook, {builder.getInt32(slot)}), argument.getType()));
+        }
+        builder.CreateCall(&function, arguments);
+        builder.CreateRetVoid();
+    }
+
+public:
+    JitFunction(Function &function, const std::set<std::string> &inputArguments) : summary(function) {
+        INSTRUMENT_SCOPE("JitFunction::JitFunction");
+        analyze(function, inputArguments);
+
+        initializeNativeTarget();
+        jit = check(orc::LLJITBuilder().create(), "failed to create the JIT");
+
+        // copy the module into a context owned by the JIT
+        SmallVector<char, 0> bitcode;
+        raw_svector_ostream bitcodeStream(bitcode);
+        writeMaterializedBitcode(*function.getParent(), bitcodeStream);
+        auto context = std::make_unique<LLVMContext>();
+        std::unique_ptr<Module> module = check(
+                parseBitcodeFile(MemoryBufferRef(StringRef(bitcode.data(), bitcode.size()), "jit"), *context),
+                "failed to copy the module"
+        );
+        module->setDataLayout(jit->getDataLayout());
+        instrument(function, *module->getFunction(function.getName()));
+
+        orc::SymbolMap hooks;
+        auto addHook = [&](const char *name, void *address) {
+            hooks[jit->mangleAndIntern(name)] = JITEvaluatedSymbol(pointerToJITTargetAddress(address),
+                                                                   JITSymbolFlags::Exported);
+        };
+        addHook("__jit_navigator_block", (void *) &onBlock);
+        addHook("__jit_navigator_cmp", (void *) &onCmp);
+        addHook("__jit_navigator_input", (void *) &onInput);
+        addHook("__jit_navigator_variable", (void *) &onVariable);
+        addHook("__jit_navigator_division_by_zero", (void *) &onDivisionByZero);
+        addHook("__jit_navigator_callee_block", (void *) &onCalleeBlock);
+        addHook("__jit_navigator_return", (void *) &onReturn);
+
+        orc::JITDylib &dylib = jit->getMainJITDylib();
+        check(dylib.define(orc::absoluteSymbols(hooks)), "failed to define the JIT hooks");
+        // other calls of the module resolve to the symbols of this process, e.g. libc
+        dylib.addGenerator(check(orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+                jit->getDataLayout().getGlobalPrefix()), "failed to open the process symbols"));
+        check(jit->addIRModule(orc::ThreadSafeModule(std::move(module), std::move(context))),
+              "failed to add the module to the JIT");
+
+        // compiles the function, after this point it can be called from any thread
+        auto symbol = check(jit->lookup("__jit_navigator_entry"), "failed to compile " + function.getName().str());
+        entry = (void (*)()) symbol.getAddress();
+    }
+
+    void run(JitTrace &trace) const {
+        JitTrace *previousTrace = currentJitTrace();
+        currentJitTrace() = &trace;
+        entry();
+        currentJitTrace() = previousTrace;
+    }
+
+    const BlockSummaryTable &getSummary() const {
+        return summary;
+    }
+
+    BasicBlock *getBlock(unsigned block) const {
+        return blocks[block];
+    }
+
+    unsigned getBlockCount() const {
+        return blocks.size();
+    }
+
+    ICmpInst *getCmpInst(unsigned cmp) const {
+        return cmpInsts[cmp];
+    }
+
+    unsigned getSlotCount() const {
+        return summary.getSlotCount();
+    }
+
+    const std::string &getSlotName(unsigned slot) const {
+        return summary.getSlotName(slot);
+    }
+
+    bool isInputSlot(unsigned slot) const {
+        return inputSlots[slot];
+    }
+
+    bool isReportedSlot(unsigned slot) const {
+        return reportedSlots[slot];
+    }
+
+    int getInputSlot(const std::string &variableName) const {
+        int slot = summary.getSlot(variableName);
+        return slot < 0 || !inputSlots[slot] ? -1 : slot;
+    }
+
+    const std::vector<std::pair<unsigned, unsigned>> &getBackEdges(unsigned block) const {
+        return backEdges[block];
+    }
+
+    unsigned getLoopCount() const {
+        return loopHeaders.size();
+    }
+
+    BasicBlock *getLoopHeader(unsigned loop) const {
+        return loopHeaders[loop];
+    }
+};
+
+/**
+ * @brief Runs one input natively through a JitFunction and rebuilds the navigation from the hook trace
+ *
+ * It offers the same results as PathNavigator, but every comparison the function executes is recorded,
+ * not only the first one of each block. A comparison that was false is recorded with its inverse predicate, its
+ * operands are not resolved through phis.
+ */
+class JitNavigator {
+private:
+    const JitFunction &function;
+    std::vector<int64_t> inputs;
+    JitTrace trace;
+
+    std::vector<BasicBlock *> path;
+    std::vector<PathCondition> conditions;
+    std::vector<bool> assignedSlots;
+    std::vector<uint64_t> loopIterations;
+public:
+
+    JitNavigator(const JitFunction &function, const ExecutionBudget &budget = {0, 0})
+            : function(function), inputs(function.getSlotCount()), trace(&inputs, budget, function.getSlotCount()),
+              assignedSlots(function.getSlotCount()), loopIterations(function.getLoopCount()) {}
+
+    JitNavigator(const JitFunction &function, const std::map<std::string, int64_t> &argumentsMap,
+                 const ExecutionBudget &budget = {0, 0})
+            : JitNavigator(function, budget) {
+        for (auto &argument: argumentsMap) {
+            int slot = function.getInputSlot(argument.first);
+            if (slot < 0) {
+                throw std::runtime_error("Variable " + argument.first + " not found in function");
+            }
+            setArgument(slot, argument.second);
+        }
+    }
+
+    // forgets the previous navigation but keeps every buffer, so a reused navigator does not allocate
+    void reset() {
+        std::fill(inputs.begin(), inputs.end(), 0);
+        trace.reset();
+        path.clear();
+        conditions.clear();
+        std::fill(loopIterations.begin(), loopIterations.end(), 0);
+    }
+
+    void setArgument(unsigned slot, int64_t value) {
+        inputs[slot] = value;
+    }
+
+    void navigate() {
+        INSTRUMENT_SCOPE("JitNavigator::navigate");
+        trace.inputs = &inputs;
+        trace.budgetTracker.restart();
+        function.run(trace);
+        if (trace.divisionByZero) {
+            throw std::runtime_error("Division by zero");
+        }
+
+        const std::vector<unsigned> &blockTrace = trace.blockTrace;
+        if (trace.stoppedBlock >= 0 && !blockTrace.empty()) {
+            countBackEdge(blockTrace.back(), trace.stoppedBlock);
+            assignPhis(blockTrace.back(), trace.stoppedBlock);
+        }
+
+        for (unsigned slot = 0; slot < function.getSlotCount(); slot++) {
+            assignedSlots[slot] = function.isInputSlot(slot);
+        }
+        for (size_t i = 0; i < blockTrace.size(); i++) {
+            path.push_back(function.getBlock(blockTrace[i]));
+            // like PathNavigator, a variable assigned a value the summary does not model has none
+            for (auto &store: function.getSummary().getBlock(blockTrace[i]).stores) {
+                assignedSlots[store.slot] = store.value.kind != ValueKind::Unsupported;
+            }
+            if (i + 1 < blockTrace.size()) {
+                countBackEdge(blockTrace[i], blockTrace[i + 1]);
+                assignPhis(blockTrace[i], blockTrace[i + 1]);
+            }
+        }
+
+        for (auto &cmp: trace.cmpTrace) {
+            ICmpInst *cmpInstruction = function.getCmpInst(cmp.first);
+            conditions.push_back({cmpInstruction,
+                                  cmp.second ? cmpInstruction->getPredicate() : cmpInstruction->getInversePredicate(),
+                                  {cmpInstruction->getOperand(0), cmpInstruction->getOperand(1)}});
+        }
+    }
+
+    std::map<std::string, int64_t> getVariablesMap() const {
+        std::map<std::string, int64_t> variablesMap;
+        for (unsigned slot = 0; slot < function.getSlotCount(); slot++) {
+            if (assignedSlots[slot] && function.isReportedSlot(slot)) {
+                variablesMap[function.getSlotName(slot)] = trace.variables[slot];
+            }
+        }
+        return variablesMap;
+    }
+
+    NavigationStatus getStatus() const {
+        return trace.status;
+    }
+
+    const std::vector<uint64_t> &getLoopIterations() const {
+        return loopIterations;
+    }
+
+    BasicBlock *getLoopHeader(unsigned loop) const {
+        return function.getLoopHeader(loop);
+    }
+
+    std::vector<BasicBlock *> &getPath() {
+        return path;
+    }
+
+    const std::vector<PathCondition> &getConditions() const {
+        return conditions;
+    }
+
+private:
+
+    void assignPhis(unsigned from, unsigned to) {
+        const BlockSummary &block = function.getSummary().getBlock(from);
+        for (unsigned successor = 0; successor < 2 && successor < block.numberOfSuccessors; successor++) {
+            if (block.successors[successor] == to) {
+                for (auto &phiStore: block.phiStores[successor]) {
+                    assignedSlots[phiStore.slot] = phiStore.value.kind != ValueKind::Unsupported;
+                }
+                return;
+            }
+        }
+    }
+
+    void countBackEdge(unsigned from, unsigned to) {
+        for (auto &backEdge: function.getBackEdges(from)) {
+            if (backEdge.first == to) {
+                loopIterations[backEdge.second]++;
+            }
+        }
+    }
+};
+
+#endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_JITNAVIGATOR_H
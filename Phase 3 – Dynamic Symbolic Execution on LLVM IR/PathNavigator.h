@@ -2,6 +2,8 @@
 #define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_PATHNAVIGATOR_H
 
 #include <cstdio>
+#include <algorithm>
+#include <cstdint>
 #include <iostream>
 #include <set>
 #include <cstdlib>
@@ -17,48 +19,108 @@
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "BlockSummary.h"
+#include "ExecutionBudget.h"
+#include "Instrumentation.h"
 #include "Utils.h"
 
 using namespace llvm;
 
 class PathNavigator {
 private:
-    BasicBlock *entryBlock;
-    std::map<std::string, int> variablesMap;
+    const BlockSummaryTable &summary;
+    // every value as an integer of its width, see IntegerKernels.h
+    std::vector<int64_t> variables;
+    std::vector<bool> assignedSlots;
+    // value each phi got from the edge it was last entered through, resolved through the phis before it
+    std::vector<Value *> phiSources;
+    // incoming values of the phis of an edge, read before any of them is written
+    std::vector<int64_t> phiValues;
+    std::vector<Value *> incomingSources;
+    ExecutionBudget budget;
 
     std::vector<BasicBlock *> path;
-    std::vector<ICmpInst *> cmpInstructions;
+    std::vector<PathCondition> conditions;
+    NavigationStatus status = NavigationStatus::Completed;
+    // back edges taken per loop of the function
+    std::vector<uint64_t> loopIterations;
 public:
 
-    PathNavigator(BasicBlock *entryBlock, std::map<std::string, int> argumentsMap)
-            : entryBlock(entryBlock), variablesMap(std::move(argumentsMap)) {}
+    PathNavigator(const BlockSummaryTable &summary, const ExecutionBudget &budget = {0, 0})
+            : summary(summary), variables(summary.getSlotCount()), assignedSlots(summary.getSlotCount()),
+              phiSources(summary.getSlotCount()), budget(budget), loopIterations(summary.getLoopCount()) {}
+
+    PathNavigator(const BlockSummaryTable &summary, const std::map<std::string, int64_t> &argumentsMap,
+                  const ExecutionBudget &budget = {0, 0})
+            : PathNavigator(summary, budget) {
+        for (auto &argument: argumentsMap) {
+            int slot = summary.getSlot(argument.first);
+            if (slot >= 0) {
+                setArgument(slot, argument.second);
+            }
+        }
+    }
+
+    /**
+     * @brief Forgets the previous navigation but keeps every buffer, so a reused navigator does not allocate
+     */
+    void reset() {
+        std::fill(assignedSlots.begin(), assignedSlots.end(), false);
+        std::fill(phiSources.begin(), phiSources.end(), nullptr);
+        std::fill(loopIterations.begin(), loopIterations.end(), 0);
+        path.clear();
+        conditions.clear();
+        status = NavigationStatus::Completed;
+    }
+
+    // an input of a narrower variable gets the value it has in that variable, like a1 = (char) 300 is 44
+    void setArgument(unsigned slot, int64_t value) {
+        variables[slot] = normalizeInteger(value, summary.getSlotBits(slot));
+        assignedSlots[slot] = true;
+    }
 
     void navigate() {
-        BasicBlock *currentBasicBlock = entryBlock;
-        Instruction * terminatorInst;
+        INSTRUMENT_SCOPE("PathNavigator::navigate");
+        const BlockSummary *currentBlock = &summary.getBlock(BlockSummaryTable::getEntryIndex());
+        BudgetTracker budgetTracker(budget);
 
         do {
-            path.push_back(currentBasicBlock);
-            terminatorInst = currentBasicBlock->getTerminator();
-
-            applyAssignments(currentBasicBlock);
-            auto evaluateConditionResult = evaluateComparison(currentBasicBlock);
-            if (evaluateConditionResult != nullptr) {
-                if (*evaluateConditionResult) {
-                    currentBasicBlock = terminatorInst->getSuccessor(0);
-                } else {
-                    currentBasicBlock = terminatorInst->getSuccessor(1);
-                }
-            } else if (terminatorInst->getNumSuccessors() == 1) {
-                currentBasicBlock = terminatorInst->getSuccessor(0);
-            } else {
+            // a navigation that does not terminate within its budget stops with a timeout status
+            if ((status = budgetTracker.step()) != NavigationStatus::Completed) {
+                break;
+            }
+
+            path.push_back(currentBlock->basicBlock);
+
+            applyAssignments(*currentBlock);
+            bool cmpResult = currentBlock->cmpInst != nullptr && evaluateComparison(*currentBlock);
+            unsigned successor;
+            if (currentBlock->isCmpBranch) {
+                successor = cmpResult ? 0 : 1;
+            } else if (currentBlock->numberOfSuccessors == 1) {
+                successor = 0;
+            } else if (currentBlock->numberOfSuccessors == 0) {
                 break;
+            } else {
+                throw std::runtime_error("Unsupported terminator " +
+                                         valueToString(currentBlock->basicBlock->getTerminator()));
             }
 
+            if (currentBlock->backEdgeLoops[successor] >= 0) {
+                loopIterations[currentBlock->backEdgeLoops[successor]]++;
+            }
+            applyPhis(currentBlock->phiStores[successor]);
+            currentBlock = &summary.getBlock(currentBlock->successors[successor]);
         } while (true);
     }
 
-    std::map<std::string, int> &getVariablesMap() {
+    std::map<std::string, int64_t> getVariablesMap() const {
+        std::map<std::string, int64_t> variablesMap;
+        for (unsigned slot = 0; slot < summary.getSlotCount(); slot++) {
+            if (assignedSlots[slot] && summary.isVariableSlot(slot)) {
+                variablesMap[summary.getSlotName(slot)] = variables[slot];
+            }
+        }
         return variablesMap;
     }
 
@@ -66,264 +128,110 @@ public:
         return path;
     }
 
-    std::vector<ICmpInst *> &getCmpInstructions() {
-        return cmpInstructions;
+    const std::vector<PathCondition> &getConditions() const {
+        return conditions;
     }
 
-private:
-
-    void applyAssignments(BasicBlock *basicBlock) {
-        for (auto &I: *basicBlock) {
-            if (I.getOpcode() == Instruction::Store) {
-                auto *storeInst = dyn_cast<StoreInst>(&I);
-
-                std::string pointerOpName = storeInst->getPointerOperand()->getName().str();
-                Value * storeValue = storeInst->getValueOperand();
-
-                // if storeValue is a constant instruction
-                // Example: a = 5
-                if (isa<ConstantInt>(storeValue)) {
-                    variablesMap[pointerOpName] = dyn_cast<ConstantInt>(storeValue)->getSExtValue();
-                }
-                    // if storeValue is a load instruction
-                    // Example: a = b
-                else if (isa<LoadInst>(storeValue)) {
-                    std::string opName = getLoadInstOperandName(dyn_cast<LoadInst>(storeValue));
-
-                    if (variablesMap.find(opName) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opName + " not found in variablesMap");
-                    }
-
-                    variablesMap[pointerOpName] = variablesMap[opName];
-                }
-                    // check if store value is binary operator (like add, sub, mul or div)
-                    // Example: a = b + c, a = b - 2, a = c * 5, a = 10 / 2
-                else if (isa<BinaryOperator>(storeValue)) {
-                    variablesMap[pointerOpName] = evaluateBinaryOperation(
-                            dyn_cast<BinaryOperator>(storeValue)
-                    );
-                }
-            }
-        }
+    NavigationStatus getStatus() const {
+        return status;
     }
 
-    int evaluateBinaryOperation(BinaryOperator *binaryOperator) {
-        Value * op1 = binaryOperator->getOperand(0);
-        Value * op2 = binaryOperator->getOperand(1);
-
-        int op1Value = 0;
-        int op2Value = 0;
-
-        // check if op1 or op2 is a constant and get constant value
-        // or load register and get register value
-        if (isa<LoadInst>(op1) && isa<LoadInst>(op2)) {
-            std::string op1Name = getLoadInstOperandName(dyn_cast<LoadInst>(op1));
-            std::string op2Name = getLoadInstOperandName(dyn_cast<LoadInst>(op2));
-
-            if (variablesMap.find(op1Name) == variablesMap.end() ||
-                variablesMap.find(op2Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op1Name + " or " + op2Name + "is missing");
-            }
-
-            op1Value = variablesMap[op1Name];
-            op2Value = variablesMap[op2Name];
-        } else if (isa<LoadInst>(op1) && isa<ConstantInt>(op2)) {
-            std::string op1Name = getLoadInstOperandName(dyn_cast<LoadInst>(op1));
-            int op2ExactValue = dyn_cast<ConstantInt>(op2)->getSExtValue();
+    const std::vector<uint64_t> &getLoopIterations() const {
+        return loopIterations;
+    }
 
-            if (variablesMap.find(op1Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op1Name + " is missing");
-            }
+    BasicBlock *getLoopHeader(unsigned loop) const {
+        return summary.getLoopHeader(loop);
+    }
 
-            op1Value = variablesMap[op1Name];
-            op2Value = op2ExactValue;
-        } else if (isa<ConstantInt>(op1) && isa<LoadInst>(op2)) {
-            int op1ExactValue = dyn_cast<ConstantInt>(op1)->getSExtValue();
-            std::string op2Name = getLoadInstOperandName(dyn_cast<LoadInst>(op2));
+private:
 
-            if (variablesMap.find(op2Name) == variablesMap.end()) {
-                throw std::runtime_error("Variable " + op2Name + " is missing");
+    void applyAssignments(const BlockSummary &block) {
+        for (auto &store: block.stores) {
+            // Example: a = 5, a = b, a = b + c, a variable assigned an unsupported value has none
+            if (store.value.kind != ValueKind::Unsupported) {
+                int64_t value = evaluateValue(store.value);
+                variables[store.slot] = value;
+                assignedSlots[store.slot] = true;
+            } else {
+                assignedSlots[store.slot] = false;
             }
+        }
+    }
 
-            op1Value = op1ExactValue;
-            op2Value = variablesMap[op2Name];
-        } else if (isa<ConstantInt>(op1) && isa<ConstantInt>(op2)) {
-            int op1ExactValue = dyn_cast<ConstantInt>(op1)->getSExtValue();
-            int op2ExactValue = dyn_cast<ConstantInt>(op2)->getSExtValue();
-
-            op1Value = op1ExactValue;
-            op2Value = op2ExactValue;
+    // Example: x.0 = phi [a1, %entry], [%add, %if.then], entered from %if.then
+    void applyPhis(const std::vector<StoreSummary> &phiStores) {
+        if (phiStores.empty()) {
+            return;
+        }
+        phiValues.clear();
+        incomingSources.clear();
+        for (auto &phiStore: phiStores) {
+            bool isSupported = phiStore.value.kind != ValueKind::Unsupported;
+            phiValues.push_back(isSupported ? evaluateValue(phiStore.value) : 0);
+            incomingSources.push_back(resolvePhi(phiStore.value));
+        }
+        for (size_t i = 0; i < phiStores.size(); i++) {
+            variables[phiStores[i].slot] = phiValues[i];
+            assignedSlots[phiStores[i].slot] = phiStores[i].value.kind != ValueKind::Unsupported;
+            phiSources[phiStores[i].slot] = incomingSources[i];
         }
-        return evaluateBinaryOpInstruction(binaryOperator->getOpcode(), op1Value, op2Value);
     }
 
-    static int evaluateBinaryOpInstruction(Instruction::BinaryOps binaryOps, int e1, int e2) {
-        switch (binaryOps) {
-            case Instruction::Add:
-                return e1 + e2;
-            case Instruction::Sub:
-                return e1 - e2;
-            case Instruction::Mul:
-                return e1 * e2;
-            case Instruction::SDiv:
-                if (e2 != 0) {
-                    return e1 / e2;
-                } else {
-                    throw std::runtime_error("Unknown binary operation");
-                }
-            case Instruction::And:
-                return e1 & e2;
-            case Instruction::Or:
-                return e1 | e2;
-            case Instruction::Xor:
-                return e1 ^ e2;
-            case Instruction::Shl:
-                return e1 << e2;
-            case Instruction::LShr:
-            case Instruction::AShr:
-                return e1 >> e2;
-            default:
-                throw std::runtime_error("Unknown binary operation");
+    // the value a phi operand got on the path, other operands are themselves
+    Value *resolvePhi(const ValueSummary &value) const {
+        if (value.kind == ValueKind::Register && isa<PHINode>(value.value) && phiSources[value.slot] != nullptr) {
+            return phiSources[value.slot];
         }
+        return value.value;
     }
 
-    bool *evaluateComparison(BasicBlock *basicBlock) {
-        for (auto &I: *basicBlock) {
-            // Integer comparison
-            if (I.getOpcode() == Instruction::ICmp) {
-                auto *cmpInstruction = dyn_cast<ICmpInst>(&I);
-
-                auto opCmp1 = cmpInstruction->getOperand(0);
-                auto opCmp2 = cmpInstruction->getOperand(1);
-
-                auto cmpPredicate = cmpInstruction->getPredicate();
-                int opCmp1FinalValue = 0;
-                int opCmp2FinalValue = 0;
-
-                // Example: a == b, a != b, a < b, a > b, a <= b, a >= b
-                if (isa<LoadInst>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end() ||
-                        variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " or " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a == 5
-                else if (isa<LoadInst>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    int opCmp2ExactValue = dyn_cast<ConstantInt>(opCmp2)->getSExtValue();
-
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = opCmp2ExactValue;
-                }
-                    // Example: 7 == b
-                else if (isa<ConstantInt>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    int opCmp1ExactValue = dyn_cast<ConstantInt>(opCmp1)->getSExtValue();
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = opCmp1ExactValue;
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a + b == c + d
-                else if (isa<BinaryOperator>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
-
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = opCmp2Value;
-                }
-                    // Example: a + b == c
-                else if (isa<BinaryOperator>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
-
-                    if (variablesMap.find(opCmp2Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp2Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = variablesMap[opCmp2Name];
-                }
-                    // Example: a == b - c
-                else if (isa<LoadInst>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
-
-                    if (variablesMap.find(opCmp1Name) == variablesMap.end()) {
-                        throw std::runtime_error("Variable " + opCmp1Name + " is missing");
-                    }
-
-                    opCmp1FinalValue = variablesMap[opCmp1Name];
-                    opCmp2FinalValue = opCmp2Value;
-                }
-                    // Example: a + b == 11
-                else if (isa<BinaryOperator>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                    int opCmp1Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp1));
-                    int opCmp2ExactValue = dyn_cast<ConstantInt>(opCmp2)->getSExtValue();
-
-                    opCmp1FinalValue = opCmp1Value;
-                    opCmp2FinalValue = opCmp2ExactValue;
-                }
-                    // Example: 45 == a * b
-                else if (isa<ConstantInt>(opCmp1) && isa<BinaryOperator>(opCmp2)) {
-                    int opCmp1ExactValue = dyn_cast<ConstantInt>(opCmp1)->getSExtValue();
-                    int opCmp2Value = evaluateBinaryOperation(dyn_cast<BinaryOperator>(opCmp2));
-
-                    opCmp1FinalValue = opCmp1ExactValue;
-                    opCmp2FinalValue = opCmp2Value;
-                }
-
-                auto cmpResult = evaluateCmpInstruction(cmpPredicate, opCmp1FinalValue, opCmp2FinalValue);
-
-                if (!cmpResult) {
-                    cmpInstruction = new ICmpInst(cmpInstruction->getInversePredicate(), opCmp1, opCmp2);
-                }
-                cmpInstructions.emplace_back(cmpInstruction);
-                return new bool(cmpResult);
-            }
+    int64_t readVariable(const ValueSummary &value) {
+        if (!assignedSlots[value.slot]) {
+            throw std::runtime_error("Variable " + summary.getSlotName(value.slot) + " is missing");
         }
-        return nullptr;
+        return variables[value.slot];
     }
 
-    static bool evaluateCmpInstruction(ICmpInst::Predicate cmpType, int opCmp1Value, int opCmp2Value) {
-        switch (cmpType) {
-            case ICmpInst::ICMP_EQ:
-                return opCmp1Value == opCmp2Value;
-            case ICmpInst::ICMP_NE:
-                return opCmp1Value != opCmp2Value;
-            case ICmpInst::ICMP_UGT:
-                return opCmp1Value > opCmp2Value;
-            case ICmpInst::ICMP_UGE:
-                return opCmp1Value >= opCmp2Value;
-            case ICmpInst::ICMP_ULT:
-                return opCmp1Value < opCmp2Value;
-            case ICmpInst::ICMP_ULE:
-                return opCmp1Value <= opCmp2Value;
-            case ICmpInst::ICMP_SGT:
-                return opCmp1Value > opCmp2Value;
-            case ICmpInst::ICMP_SGE:
-                return opCmp1Value >= opCmp2Value;
-            case ICmpInst::ICMP_SLT:
-                return opCmp1Value < opCmp2Value;
-            case ICmpInst::ICMP_SLE:
-                return opCmp1Value <= opCmp2Value;
+    int64_t evaluateValue(const ValueSummary &value) {
+        switch (value.kind) {
+            case ValueKind::Constant:
+                return value.constant;
+            case ValueKind::Load:
+            case ValueKind::Register:
+                return readVariable(value);
+            case ValueKind::BinaryOperation:
+                return evaluateBinaryOperation(summary.getBinaryOperation(value.binaryOperation));
+            case ValueKind::Unsupported:
             default:
-                throw std::runtime_error("Unknown comparison type");
+                throw std::runtime_error("Unsupported value " + valueToString(value.value));
         }
     }
+
+    // Example: a + b, a - 2, c * 5, 10 / 2, (long) a
+    int64_t evaluateBinaryOperation(const BinaryOperationSummary &binaryOperation) {
+        // a nested operation is kept in a register, the second operand of a cast is a constant
+        int64_t op1Value = evaluateValue(binaryOperation.operands[0]);
+        int64_t op2Value = evaluateValue(binaryOperation.operands[1]);
+        return binaryOperation.kernels.scalar(op1Value, op2Value);
+    }
+
+    bool evaluateComparison(const BlockSummary &block) {
+        ICmpInst *cmpInstruction = block.cmpInst;
+        const ValueSummary &opCmp1 = block.cmpOperands[0];
+        const ValueSummary &opCmp2 = block.cmpOperands[1];
+
+        // Example: a == b, a == 5, 7 == b, a + b == c + d, a + b == 11, 45 == a * b
+        int64_t opCmp1FinalValue = evaluateValue(opCmp1);
+        int64_t opCmp2FinalValue = evaluateValue(opCmp2);
+
+        bool cmpResult = block.cmpKernels.scalar(opCmp1FinalValue, opCmp2FinalValue);
+
+        conditions.push_back({cmpInstruction,
+                              cmpResult ? cmpInstruction->getPredicate() : cmpInstruction->getInversePredicate(),
+                              {resolvePhi(opCmp1), resolvePhi(opCmp2)}});
+        return cmpResult;
+    }
 };
 
 #endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_PATHNAVIGATOR_H
@@ -2,164 +2,484 @@
 #define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_SOLVER_H
 
 #include <cstdio>
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <map>
 #include <iostream>
 #include <set>
 #include <cstdlib>
 #include <random>
+#include <stdexcept>
 #include <utility>
+#include <vector>
 
+#include "llvm/ADT/DenseMap.h"
 #include "llvm/IR/LLVMContext.h"
 #include "llvm/IR/Module.h"
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "Instrumentation.h"
 #include "PathNavigator.h"
 #include "Utils.h"
 
 using namespace llvm;
 
-class Solver {
+/**
+ * @brief Set of integers kept as sorted, disjoint closed intervals
+ *
+ * A variable range of the solver is usually one or two intervals, so comparisons cost O(intervals) instead of
+ * O(values). The interval buffer keeps its capacity, assigning one set to another does not allocate once it
+ * has grown.
+ */
+class IntervalSet {
+private:
+    std::vector<std::pair<int64_t, int64_t>> intervals;
+
 public:
-    std::vector<ICmpInst *> comparisonInstructions;
-    int minRange, maxRange;
-    std::map<std::string, std::set<int>> variablesRange;
+    void assignRange(int64_t first, int64_t last) {
+        intervals.clear();
+        if (first <= last) {
+            intervals.emplace_back(first, last);
+        }
+    }
+
+    void clear() {
+        intervals.clear();
+    }
 
-    Solver(std::vector<ICmpInst *> comparisonInstructions, int minRange, int maxRange)
-            : comparisonInstructions(std::move(comparisonInstructions)), minRange(minRange), maxRange(maxRange) {}
+    bool empty() const {
+        return intervals.empty();
+    }
 
-    std::map<std::string, int> solve() {
-        applyComparisons();
+    // the number of elements, 0 for the whole range of int64_t as it has 2^64 of them
+    uint64_t size() const {
+        uint64_t size = 0;
+        for (auto &interval: intervals) {
+            size += (uint64_t) interval.second - (uint64_t) interval.first + 1;
+        }
+        return size;
+    }
 
-        // select random number from rage of each key of variablesRange
-        std::map<std::string, int> result;
-        for (auto &variableRagePair: variablesRange) {
-            if (!variableRagePair.second.empty()) {
-                auto randomNum = randomInRange(0, variableRagePair.second.size() - 1);
-                result[variableRagePair.first] = *std::next(variableRagePair.second.begin(), randomNum);
-            } else {
-                outs() << "No value for variable " << variableRagePair.first << "\n";
+    int64_t min() const {
+        return intervals.front().first;
+    }
+
+    int64_t max() const {
+        return intervals.back().second;
+    }
+
+    // k-th smallest element, k < size()
+    int64_t at(uint64_t k) const {
+        for (auto &interval: intervals) {
+            uint64_t lastIndex = (uint64_t) interval.second - (uint64_t) interval.first;
+            if (k <= lastIndex) {
+                return (int64_t) ((uint64_t) interval.first + k);
             }
+            k -= lastIndex + 1;
         }
+        throw std::out_of_range("IntervalSet index out of range");
+    }
 
-        return result;
+    // keeps the elements in [first, last]
+    void clip(int64_t first, int64_t last) {
+        size_t kept = 0;
+        for (auto &interval: intervals) {
+            int64_t clippedFirst = std::max(interval.first, first);
+            int64_t clippedLast = std::min(interval.second, last);
+            if (clippedFirst <= clippedLast) {
+                intervals[kept++] = {clippedFirst, clippedLast};
+            }
+        }
+        intervals.resize(kept);
     }
 
-    void applyComparisons() {
-        for (auto cmpInstruction: comparisonInstructions) {
+    // keeps the elements in [first, last] of the unsigned order, where the negative values follow the others
+    void clipUnsigned(int64_t first, int64_t last) {
+        if ((first < 0) == (last < 0)) {
+            clip(first, last);
+        } else if (first >= 0) {
+            eraseRange(last + 1, first - 1);
+        } else {
+            intervals.clear();
+        }
+    }
 
-            auto opCmp1 = cmpInstruction->getOperand(0);
-            auto opCmp2 = cmpInstruction->getOperand(1);
+    // smallest element of the unsigned order
+    int64_t unsignedMin() const {
+        for (auto &interval: intervals) {
+            if (interval.second >= 0) {
+                return std::max<int64_t>(interval.first, 0);
+            }
+        }
+        return min();
+    }
 
-            auto cmpPredicate = cmpInstruction->getPredicate();
-            std::pair<std::string, std::set<int>> opCmp1FinalRange;
-            std::pair<std::string, std::set<int>> opCmp2FinalRange;
+    // largest element of the unsigned order, the largest negative one if there is any
+    int64_t unsignedMax() const {
+        for (auto it = intervals.rbegin(); it != intervals.rend(); ++it) {
+            if (it->first < 0) {
+                return std::min<int64_t>(it->second, -1);
+            }
+        }
+        return max();
+    }
 
-            // Example: a == b, a != b, a < b, a > b, a <= b, a >= b
-            if (isa<LoadInst>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
+    // removes the elements in [first, last]
+    void eraseRange(int64_t first, int64_t last) {
+        if (first > last) {
+            return;
+        }
+        size_t kept = 0, split = intervals.size();
+        int64_t splitLast = 0;
+        for (size_t i = 0; i < intervals.size(); i++) {
+            auto interval = intervals[i];
+            if (interval.second < first || interval.first > last) {
+                intervals[kept++] = interval;
+            } else if (interval.first < first && interval.second > last) {
+                split = kept;
+                splitLast = interval.second;
+                intervals[kept++] = {interval.first, first - 1};
+            } else if (interval.first < first) {
+                intervals[kept++] = {interval.first, first - 1};
+            } else if (interval.second > last) {
+                intervals[kept++] = {last + 1, interval.second};
+            }
+        }
+        intervals.resize(kept);
+        if (split < intervals.size()) {
+            intervals.insert(intervals.begin() + split + 1, {last + 1, splitLast});
+        }
+    }
 
-                opCmp1FinalRange = std::make_pair(opCmp1Name, getVariableRange(opCmp1Name));
-                opCmp2FinalRange = std::make_pair(opCmp2Name, getVariableRange(opCmp2Name));
+    void erase(int64_t value) {
+        for (size_t i = 0; i < intervals.size(); i++) {
+            auto &interval = intervals[i];
+            if (value < interval.first || value > interval.second) {
+                continue;
+            }
+            if (interval.first == interval.second) {
+                intervals.erase(intervals.begin() + i);
+            } else if (value == interval.first) {
+                interval.first++;
+            } else if (value == interval.second) {
+                interval.second--;
+            } else {
+                int64_t last = interval.second;
+                interval.second = value - 1;
+                intervals.insert(intervals.begin() + i + 1, {value + 1, last});
             }
-                // Example: a == 5
-            else if (isa<LoadInst>(opCmp1) && isa<ConstantInt>(opCmp2)) {
-                std::string opCmp1Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp1));
-                int opCmp2ExactValue = dyn_cast<ConstantInt>(opCmp2)->getSExtValue();
+            return;
+        }
+    }
 
-                opCmp1FinalRange = std::make_pair(opCmp1Name, getVariableRange(opCmp1Name));
-                opCmp2FinalRange = std::make_pair("", std::set<int>{opCmp2ExactValue});
+    // result = range1 ∩ range2, result must not be one of the operands
+    static void intersect(const IntervalSet &range1, const IntervalSet &range2, IntervalSet &result) {
+        result.intervals.clear();
+        size_t i = 0, j = 0;
+        while (i < range1.intervals.size() && j < range2.intervals.size()) {
+            int64_t first = std::max(range1.intervals[i].first, range2.intervals[j].first);
+            int64_t last = std::min(range1.intervals[i].second, range2.intervals[j].second);
+            if (first <= last) {
+                result.intervals.emplace_back(first, last);
+            }
+            if (range1.intervals[i].second < range2.intervals[j].second) {
+                i++;
+            } else {
+                j++;
             }
-                // Example: 7 == b
-            else if (isa<ConstantInt>(opCmp1) && isa<LoadInst>(opCmp2)) {
-                int opCmp1ExactValue = dyn_cast<ConstantInt>(opCmp1)->getSExtValue();
-                std::string opCmp2Name = getLoadInstOperandName(dyn_cast<LoadInst>(opCmp2));
+        }
+    }
+};
+
+enum class OperandKind : uint8_t {
+    // Example: a1, a load of an input argument or an input parameter of optimized code
+    Input,
+    // Example: 5
+    Constant,
+    // anything else, comparisons with such an operand are not solved
+    Other,
+};
+
+struct ComparisonOperand {
+    OperandKind kind;
+    // only for Input, position of the argument in the sorted input argument set
+    unsigned input;
+    // only for Constant
+    int64_t constant;
+};
 
-                opCmp1FinalRange = std::make_pair("", std::set<int>{opCmp1ExactValue});
-                opCmp2FinalRange = std::make_pair(opCmp2Name, getVariableRange(opCmp2Name));
+/**
+ * @brief Basic solver for DSE conditions
+ *
+ * The operands of every comparison and the incoming values of every phi of the function are classified once,
+ * a condition is solved with the operands its navigation resolved through the phis of the path. A solver is
+ * reused by every iteration of a DSE run: the variable ranges are interval sets whose buffers are kept between
+ * calls, so solving a path does not allocate after the first iterations.
+ *
+ * Values are integers of their width, as IntegerKernels.h keeps them: an input only ranges over the values its
+ * type holds and the unsigned predicates order the negative values after the others.
+ */
+class Solver {
+private:
+    int minRange, maxRange;
+    std::vector<std::string> inputNames;
+    // [minRange, maxRange] of every input, widened to reach both sides of the constants it is compared with
+    std::vector<std::pair<int64_t, int64_t>> inputBounds;
+    // position in the sorted input argument set of the input allocas and parameters
+    std::map<const Value *, unsigned> inputOf;
+    // width of every input, 0 if it is no integer of up to 64 bits
+    std::vector<unsigned> inputBits;
+    DenseMap<const Value *, ComparisonOperand> operandKinds;
+
+    std::vector<IntervalSet> variablesRange;
+    // a variable has a range once a comparison used it
+    std::vector<bool> hasRange;
+    IntervalSet constantRange[2];
+    IntervalSet cmpResultRange;
+
+    // inputs are named like getInputArguments names them, unnamed ones (%0, %1, ...) by one slot tracker
+    void findInputs(Function &function, const std::set<std::string> &inputArguments) {
+        ModuleSlotTracker slotTracker(function.getParent(), false);
+        slotTracker.incorporateFunction(function);
+        auto addInput = [&](const Value *value) {
+            auto it = inputArguments.find(getSimpleNodeName(value, slotTracker));
+            if (it != inputArguments.end()) {
+                inputOf[value] = std::distance(inputArguments.begin(), it);
+                Type *type = isa<AllocaInst>(value) ? dyn_cast<AllocaInst>(value)->getAllocatedType()
+                                                    : value->getType();
+                if (type->isIntegerTy() && type->getIntegerBitWidth() <= 64) {
+                    inputBits[inputOf[value]] = type->getIntegerBitWidth();
+                }
             }
+        };
+        for (auto &argument: function.args()) {
+            addInput(&argument);
+        }
+        for (auto &I: function.getEntryBlock()) {
+            if (isa<AllocaInst>(&I)) {
+                addInput(&I);
+            }
+        }
+    }
 
+    ComparisonOperand classifyOperand(Value *operand) const {
+        Value *input = operand;
+        if (auto *loadInst = dyn_cast<LoadInst>(operand)) {
+            input = loadInst->getPointerOperand();
+        } else if (auto *constantInt = dyn_cast<ConstantInt>(operand)) {
+            return {OperandKind::Constant, 0, constantInt->getSExtValue()};
+        }
+        auto it = inputOf.find(input);
+        if (it != inputOf.end() && (input != operand || isa<Argument>(operand))) {
+            return {OperandKind::Input, it->second, 0};
+        }
+        return {OperandKind::Other, 0, 0};
+    }
 
-            applyCmpInstToVariablesRange(cmpPredicate, opCmp1FinalRange, opCmp2FinalRange);
+    // Example: a1 > 5000000000 can only hold for an a1 beyond the usual [minRange, maxRange]
+    void widenBounds(const ComparisonOperand &input, const ComparisonOperand &constant) {
+        if (input.kind != OperandKind::Input || constant.kind != OperandKind::Constant) {
+            return;
         }
+        auto &bounds = inputBounds[input.input];
+        bounds.first = std::min(bounds.first, constant.constant == INT64_MIN ? INT64_MIN : constant.constant - 1);
+        bounds.second = std::max(bounds.second, constant.constant == INT64_MAX ? INT64_MAX : constant.constant + 1);
+    }
 
+    ComparisonOperand getOperand(const Value *operand) const {
+        auto it = operandKinds.find(operand);
+        return it == operandKinds.end() ? ComparisonOperand{OperandKind::Other, 0, 0} : it->second;
     }
 
-    void applyCmpInstToVariablesRange(CmpInst::Predicate cmpPredicate,
-                                      const std::pair<std::string, std::set<int>> &opCmp1Range,
-                                      const std::pair<std::string, std::set<int>> &opCmp2Range) {
+    std::pair<ComparisonOperand, ComparisonOperand> getOperands(const PathCondition &condition) const {
+        return {getOperand(condition.operands[0]), getOperand(condition.operands[1])};
+    }
 
-        // 1. Find the range that both ranges makes cmpPredicate true
-        std::set<int> cmpResultRange;
+    // range of an operand, an input gets its whole bounds the first time it is used
+    IntervalSet &getOperandRange(const ComparisonOperand &operand, unsigned index) {
+        if (operand.kind == OperandKind::Constant) {
+            constantRange[index].assignRange(operand.constant, operand.constant);
+            return constantRange[index];
+        }
+        if (!hasRange[operand.input]) {
+            hasRange[operand.input] = true;
+            variablesRange[operand.input].assignRange(inputBounds[operand.input].first,
+                                                      inputBounds[operand.input].second);
+            unsigned bits = inputBits[operand.input];
+            if (bits > 0 && bits < 64) {
+                variablesRange[operand.input].clip(-(int64_t(1) << (bits - 1)), (int64_t(1) << (bits - 1)) - 1);
+            }
+        }
+        return variablesRange[operand.input];
+    }
 
-        for (auto opCmp1RangeElement: opCmp1Range.second) {
-            for (auto opCmp2RangeElement: opCmp2Range.second) {
-                switch (cmpPredicate) {
-                    case CmpInst::ICMP_EQ:
-                        if (opCmp1RangeElement == opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    case CmpInst::ICMP_NE:
-                        if (opCmp1RangeElement != opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    case CmpInst::ICMP_UGT:
-                    case CmpInst::ICMP_SGT:
-                        if (opCmp1RangeElement > opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    case CmpInst::ICMP_UGE:
-                    case CmpInst::ICMP_SGE:
-                        if (opCmp1RangeElement >= opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    case CmpInst::ICMP_ULT:
-                    case CmpInst::ICMP_SLT:
-                        if (opCmp1RangeElement < opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    case CmpInst::ICMP_ULE:
-                    case CmpInst::ICMP_SLE:
-                        if (opCmp1RangeElement <= opCmp2RangeElement) {
-                            cmpResultRange.insert(opCmp1RangeElement);
-                        }
-                        break;
-                    default:
-                        throw std::runtime_error("Unknown CmpInst::Predicate");
+public:
+    Solver(Function &function, const std::set<std::string> &inputArguments, int minRange, int maxRange)
+            : minRange(minRange), maxRange(maxRange), inputNames(inputArguments.begin(), inputArguments.end()),
+              inputBounds(inputArguments.size(), {minRange, maxRange}), inputBits(inputArguments.size()),
+              variablesRange(inputArguments.size()), hasRange(inputArguments.size()) {
+        findInputs(function, inputArguments);
+        for (auto &BB: function) {
+            for (auto &I: BB) {
+                if (isa<ICmpInst>(&I) || isa<PHINode>(&I)) {
+                    for (Value *operand: I.operands()) {
+                        operandKinds[operand] = classifyOperand(operand);
+                    }
+                }
+                if (isa<ICmpInst>(&I)) {
+                    widenBounds(getOperand(I.getOperand(0)), getOperand(I.getOperand(1)));
+                    widenBounds(getOperand(I.getOperand(1)), getOperand(I.getOperand(0)));
                 }
-
             }
         }
+    }
 
+    /**
+     * @brief Whether the solver can use a condition
+     *
+     * Example: a == b, a == 5, 7 == b, where a and b are input arguments
+     */
+    bool isSolvable(const PathCondition &condition) const {
+        auto operands = getOperands(condition);
+        OperandKind kind1 = operands.first.kind;
+        OperandKind kind2 = operands.second.kind;
+        return (kind1 == OperandKind::Input && kind2 != OperandKind::Other) ||
+               (kind1 == OperandKind::Constant && kind2 == OperandKind::Input);
+    }
 
-        // 2. Update the range of the variable
-        if (!opCmp1Range.first.empty()) {
-            variablesRange[opCmp1Range.first] = cmpResultRange;
+    /**
+     * @brief Finds input arguments that satisfy every condition
+     *
+     * Every input used by a condition gets a random value of its range, the other inputs keep the value they have
+     * in result. When the range of an input is empty the conditions can not all hold, result is left as it is.
+     * @return false if the conditions can not all hold
+     */
+    bool solve(const std::vector<PathCondition> &conditions, InputAssignment &result) {
+        INSTRUMENT_SCOPE("Solver::solve");
+        applyComparisons(conditions);
+
+        // reported through the result only, stdout carries the records of the tests
+        for (unsigned input = 0; input < inputNames.size(); input++) {
+            if (hasRange[input] && variablesRange[input].empty()) {
+                INSTRUMENT_COUNT("Solver::emptyRanges", 1);
+                return false;
+            }
         }
 
-        if (!opCmp2Range.first.empty()) {
-            variablesRange[opCmp2Range.first] = cmpResultRange;
+        // select random number from rage of each input argument that has a range
+        result.values.resize(inputNames.size());
+        result.assigned.resize(inputNames.size(), false);
+        for (unsigned input = 0; input < inputNames.size(); input++) {
+            if (hasRange[input]) {
+                uint64_t randomNum = threadRandomEngine().below(variablesRange[input].size());
+                result.values[input] = variablesRange[input].at(randomNum);
+                result.assigned[input] = true;
+            }
+        }
+        return true;
+    }
+
+    void applyComparisons(const std::vector<PathCondition> &conditions) {
+        INSTRUMENT_SCOPE("Solver::applyComparisons");
+        std::fill(hasRange.begin(), hasRange.end(), false);
+        for (auto &condition: conditions) {
+            applyCondition(condition);
         }
     }
 
-    std::set<int> getVariableRange(const std::string &variableName) {
-        if (variablesRange.find(variableName) == variablesRange.end()) {
-            variablesRange[variableName] = std::set<int>();
-            for (int i = minRange; i <= maxRange; i++) {
-                variablesRange[variableName].insert(i);
+    /**
+     * @brief Narrows the ranges of the input arguments of a single comparison
+     *
+     * The range that makes the predicate true is the set of values x of the first operand for which some
+     * value y of the second operand satisfies it, it becomes the range of both operands.
+     */
+    void applyCondition(const PathCondition &condition) {
+        auto operands = getOperands(condition);
+        const IntervalSet &opCmp1Range = getOperandRange(operands.first, 0);
+        const IntervalSet &opCmp2Range = getOperandRange(operands.second, 1);
+
+        // 1. Find the range that both ranges makes the predicate true
+        cmpResultRange.clear();
+        if (!opCmp1Range.empty() && !opCmp2Range.empty()) {
+            switch (condition.predicate) {
+                case CmpInst::ICMP_EQ:
+                    IntervalSet::intersect(opCmp1Range, opCmp2Range, cmpResultRange);
+                    break;
+                case CmpInst::ICMP_NE:
+                    cmpResultRange = opCmp1Range;
+                    if (opCmp2Range.size() == 1) {
+                        cmpResultRange.erase(opCmp2Range.min());
+                    }
+                    break;
+                case CmpInst::ICMP_SGT:
+                    cmpResultRange = opCmp1Range;
+                    if (opCmp2Range.min() == INT64_MAX) {
+                        cmpResultRange.clear();
+                    } else {
+                        cmpResultRange.clip(opCmp2Range.min() + 1, INT64_MAX);
+                    }
+                    break;
+                case CmpInst::ICMP_SGE:
+                    cmpResultRange = opCmp1Range;
+                    cmpResultRange.clip(opCmp2Range.min(), INT64_MAX);
+                    break;
+                case CmpInst::ICMP_SLT:
+                    cmpResultRange = opCmp1Range;
+                    if (opCmp2Range.max() == INT64_MIN) {
+                        cmpResultRange.clear();
+                    } else {
+                        cmpResultRange.clip(INT64_MIN, opCmp2Range.max() - 1);
+                    }
+                    break;
+                case CmpInst::ICMP_SLE:
+                    cmpResultRange = opCmp1Range;
+                    cmpResultRange.clip(INT64_MIN, opCmp2Range.max());
+                    break;
+                // -1 is the unsigned maximum and 0 the minimum; a bound one past the signed maximum or minimum of
+                // a narrower width keeps its sign and is out of every range of that width, so it needs no wrapping
+                case CmpInst::ICMP_UGT:
+                    cmpResultRange = opCmp1Range;
+                    if (opCmp2Range.unsignedMin() == -1) {
+                        cmpResultRange.clear();
+                    } else {
+                        cmpResultRange.clipUnsigned((int64_t) ((uint64_t) opCmp2Range.unsignedMin() + 1), -1);
+                    }
+                    break;
+                case CmpInst::ICMP_UGE:
+                    cmpResultRange = opCmp1Range;
+                    cmpResultRange.clipUnsigned(opCmp2Range.unsignedMin(), -1);
+                    break;
+                case CmpInst::ICMP_ULT:
+                    cmpResultRange = opCmp1Range;
+                    if (opCmp2Range.unsignedMax() == 0) {
+                        cmpResultRange.clear();
+                    } else {
+                        cmpResultRange.clipUnsigned(0, (int64_t) ((uint64_t) opCmp2Range.unsignedMax() - 1));
+                    }
+                    break;
+                case CmpInst::ICMP_ULE:
+                    cmpResultRange = opCmp1Range;
+                    cmpResultRange.clipUnsigned(0, opCmp2Range.unsignedMax());
+                    break;
+                default:
+                    throw std::runtime_error("Unknown CmpInst::Predicate");
             }
-            return variablesRange[variableName];
         }
-        return variablesRange[variableName];
+
+        // 2. Update the range of the variable
+        if (operands.first.kind == OperandKind::Input) {
+            variablesRange[operands.first.input] = cmpResultRange;
+        }
+        if (operands.second.kind == OperandKind::Input) {
+            variablesRange[operands.second.input] = cmpResultRange;
+        }
     }
 
     static std::set<int> rangeOperation(const std::set<int> &range1, const std::set<int> &range2,
@@ -234,10 +554,6 @@ public:
         return result;
     }
 
-    inline static std::string getLoadInstOperandName(LoadInst *loadInst) {
-        return loadInst->getPointerOperand()->getName().str();
-    }
-
 };
 
 
@@ -0,0 +1,447 @@
+#ifndef PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_TESTSERVER_H
+#define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_TESTSERVER_H
+
+#include <cstdio>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Process.h"
+
+#include "ModuleLoader.h"
+
+using namespace llvm;
+
+// fields of one request, sent as key=value lines ended by an empty line
+using ServerRequest = std::map<std::string, std::string>;
+
+/**
+ * @brief Modules loaded by a daemon, with the analyses of their functions, in least recently used order
+ *
+ * A module is reloaded when its file changed since it was cached. Once the heap of the process grows over
+ * the memory limit, the least recently used modules are dropped; a module stays alive while a request still
+ * uses it. An Analysis is built from a Function & the first time the function is tested.
+ */
+template<typename Analysis>
+class ModuleCache {
+public:
+    class CachedModule {
+    private:
+        friend class ModuleCache;
+
+        std::unique_ptr<LLVMContext> context = std::make_unique<LLVMContext>();
+        std::unique_ptr<Module> module;
+        ModuleLoader loader;
+        sys::TimePoint<> modificationTime;
+        std::map<std::string, std::unique_ptr<Analysis>> analyses;
+
+    public:
+        /**
+         * Held exclusively while a function is materialized and analyzed, which changes the module, and
+         * shared while functions are tested.
+         */
+        std::shared_timed_mutex mutex;
+
+        /**
+         * @brief Analysis of a function, the function is materialized and analyzed on first use
+         *
+         * The mutex has to be held exclusively.
+         * @throws std::runtime_error if the module has no such function or it can not be materialized
+         */
+        Analysis &getAnalysis(const std::string &functionName) {
+            auto it = analyses.find(functionName);
+            if (it != analyses.end()) {
+                return *it->second;
+            }
+            Function *function = module->getFunction(functionName);
+            if (function == nullptr || function->isDeclaration()) {
+                throw std::runtime_error("function \"" + functionName + "\" not found");
+            }
+            loader.materialize(*function);
+            return *(analyses[functionName] = std::make_unique<Analysis>(*function));
+        }
+
+        const Module &getModule() const {
+            return *module;
+        }
+
+        double getLoadSeconds() const {
+            return loader.getLoadSeconds();
+        }
+    };
+
+private:
+    const uint64_t memoryLimit;
+
+    std::mutex mutex;
+    // most recently used first
+    std::list<std::string> recentlyUsed;
+    std::map<std::string, std::pair<std::shared_ptr<CachedModule>, std::list<std::string>::iterator>> modules;
+    uint64_t hits = 0, misses = 0, evictions = 0;
+
+    // the mutex has to be held
+    void evict() {
+        while (modules.size() > 1 && sys::Process::GetMallocUsage() > memoryLimit) {
+            modules.erase(recentlyUsed.back());
+            recentlyUsed.pop_back();
+            evictions++;
+        }
+    }
+
+public:
+    /**
+     * @param memoryLimit heap size in bytes over which modules are evicted
+     */
+    explicit ModuleCache(uint64_t memoryLimit) : memoryLimit(memoryLimit) {}
+
+    /**
+     * @param isHit set to whether the module was already cached
+     * @throws std::runtime_error if the file can not be loaded
+     */
+    std::shared_ptr<CachedModule> get(const std::string &filename, bool &isHit) {
+        sys::fs::file_status status;
+        if (std::error_code errorCode = sys::fs::status(filename, status)) {
+            throw std::runtime_error("failed to load LLVM IR file \"" + filename + "\": " + errorCode.message());
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto it = modules.find(filename);
+            if (it != modules.end() && it->second.first->modificationTime == status.getLastModificationTime()) {
+                recentlyUsed.splice(recentlyUsed.begin(), recentlyUsed, it->second.second);
+                hits++;
+                isHit = true;
+                return it->second.first;
+            }
+        }
+
+        // parsing does not block the other requests, two requests may load the same file at once
+        auto cachedModule = std::make_shared<CachedModule>();
+        cachedModule->module = cachedModule->loader.load(filename, *cachedModule->context);
+        cachedModule->modificationTime = status.getLastModificationTime();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        auto it = modules.find(filename);
+        if (it != modules.end()) {
+            recentlyUsed.erase(it->second.second);
+            modules.erase(it);
+        }
+        recentlyUsed.push_front(filename);
+        modules[filename] = {cachedModule, recentlyUsed.begin()};
+        misses++;
+        isHit = false;
+        evict();
+        return cachedModule;
+    }
+
+    void getStatistics(size_t &cachedModules, uint64_t &cacheHits, uint64_t &cacheMisses, uint64_t &cacheEvictions) {
+        std::lock_guard<std::mutex> lock(mutex);
+        cachedModules = modules.size();
+        cacheHits = hits;
+        cacheMisses = misses;
+        cacheEvictions = evictions;
+    }
+};
+
+/**
+ * @brief Serves requests on a Unix domain socket with a pool of worker threads
+ *
+ * A connection sends requests as key=value lines, each ended by an empty line, and reads the response the
+ * handler writes before sending the next one. A request with command=shutdown stops the server once the
+ * running requests are answered. The thread of run polls the idle connections and queues each complete request
+ * for the first free worker, so a connection only holds a worker while one of its requests runs, and the
+ * requests of a connection are answered one at a time, in order.
+ */
+class TestServer {
+public:
+    using RequestHandler = std::function<void(const ServerRequest &, FILE *response)>;
+
+private:
+    struct Connection {
+        int socket;
+        // owns the socket
+        FILE *output;
+        // received and not yet taken as a request
+        std::string input;
+        // no more input will come
+        bool isClosed = false;
+        // a request of the connection is queued or running, it is not polled then
+        bool isBusy = false;
+    };
+
+    const std::string socketPath;
+    const unsigned workers;
+    const RequestHandler handler;
+
+    int listenSocket = -1;
+    // written to wake the poll of run when a connection is idle again or the server stops
+    int wakePipe[2] = {-1, -1};
+    std::atomic<bool> stopping{false};
+
+    std::mutex queueMutex;
+    std::condition_variable queueCondition;
+    // by socket, a map so that the queued pointers stay valid
+    std::map<int, Connection> connections;
+    std::deque<std::pair<Connection *, ServerRequest>> requests;
+
+    /**
+     * @brief Takes the first request of the received input, false if it is not complete yet
+     * @param isAtEnd no more input will come, the lines received so far are then a request as well
+     */
+    static bool takeRequest(std::string &input, bool isAtEnd, ServerRequest &request) {
+        request.clear();
+        size_t begin = 0;
+        size_t end;
+        bool hasLines = false;
+        bool isComplete = false;
+        while (!isComplete && ((end = input.find('\n', begin)) != std::string::npos ||
+                               (isAtEnd && begin < input.size()))) {
+            if (end == std::string::npos) {
+                end = input.size();
+            }
+            std::string field = input.substr(begin, end - begin);
+            begin = end + 1;
+            while (!field.empty() && field.back() == '\r') {
+                field.pop_back();
+            }
+            if (field.empty()) {
+                isComplete = hasLines;
+                continue;
+            }
+            hasLines = true;
+            size_t separator = field.find('=');
+            if (separator == std::string::npos) {
+                request[field] = "";
+            } else {
+                request[field.substr(0, separator)] = field.substr(separator + 1);
+            }
+        }
+        if (hasLines && !isComplete && !isAtEnd) {
+            request.clear();
+            return false;
+        }
+        // the request, or the empty lines before the next one
+        input.erase(0, std::min(begin, input.size()));
+        return hasLines;
+    }
+
+    // queues the next request of an idle connection, or closes it once it has none left, with queueMutex held
+    void dispatch(Connection &connection) {
+        ServerRequest request;
+        if (takeRequest(connection.input, connection.isClosed, request)) {
+            connection.isBusy = true;
+            requests.emplace_back(&connection, std::move(request));
+            queueCondition.notify_one();
+        } else if (connection.isClosed) {
+            fclose(connection.output);
+            connections.erase(connection.socket);
+        }
+    }
+
+    void wake() {
+        char signal = 0;
+        // a full pipe already wakes the poll
+        (void) !write(wakePipe[1], &signal, 1);
+    }
+
+    void runWorker() {
+        while (true) {
+            Connection *connection;
+            ServerRequest request;
+            {
+                std::unique_lock<std::mutex> lock(queueMutex);
+                queueCondition.wait(lock, [this] { return !requests.empty() || stopping; });
+                if (stopping) {
+                    return;
+                }
+                connection = requests.front().first;
+                request = std::move(requests.front().second);
+                requests.pop_front();
+            }
+            if (request["command"] == "shutdown") {
+                stop();
+                fprintf(connection->output, "{\"status\":\"shutdown\"}\n");
+                fflush(connection->output);
+                return;
+            }
+            handler(request, connection->output);
+            bool isFlushed = fflush(connection->output) == 0;
+
+            std::lock_guard<std::mutex> lock(queueMutex);
+            connection->isBusy = false;
+            if (!isFlushed) {
+                // the client went away
+                connection->isClosed = true;
+                connection->input.clear();
+            }
+            // a request already received goes to the back of the queue, after the other connections
+            if (!stopping) {
+                dispatch(*connection);
+            }
+            wake();
+        }
+    }
+
+    void stop() {
+        stopping = true;
+        // running requests are still answered, queued ones are dropped
+        wake();
+        std::lock_guard<std::mutex> lock(queueMutex);
+        queueCondition.notify_all();
+    }
+
+public:
+    TestServer(std::string socketPath, unsigned workers, RequestHandler handler)
+            : socketPath(std::move(socketPath)), workers(std::max(1u, workers)), handler(std::move(handler)) {}
+
+    /**
+     * @brief Accepts connections until a shutdown request
+     * @throws std::runtime_error if the socket can not be created
+     */
+    void run() {
+        // a client that goes away makes writes fail instead of killing the daemon
+        signal(SIGPIPE, SIG_IGN);
+
+        sockaddr_un address{};
+        address.sun_family = AF_UNIX;
+        if (socketPath.size() >= sizeof(address.sun_path)) {
+            throw std::runtime_error("socket path \"" + socketPath + "\" is too long");
+        }
+        strcpy(address.sun_path, socketPath.c_str());
+
+        if (pipe(wakePipe) != 0) {
+            throw std::runtime_error(std::string("failed to create a pipe: ") + strerror(errno));
+        }
+        fcntl(wakePipe[0], F_SETFL, O_NONBLOCK);
+        fcntl(wakePipe[1], F_SETFL, O_NONBLOCK);
+        listenSocket = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (listenSocket < 0) {
+            std::string error = strerror(errno);
+            close(wakePipe[0]);
+            close(wakePipe[1]);
+            throw std::runtime_error("failed to create the socket: " + error);
+        }
+        // a socket file left by a daemon that did not stop cleanly, anything else at the path is kept
+        struct stat pathStatus;
+        if (lstat(socketPath.c_str(), &pathStatus) == 0) {
+            if (!S_ISSOCK(pathStatus.st_mode)) {
+                close(listenSocket);
+                close(wakePipe[0]);
+                close(wakePipe[1]);
+                throw std::runtime_error("\"" + socketPath + "\" exists and is not a socket");
+            }
+            unlink(socketPath.c_str());
+        }
+        if (bind(listenSocket, (sockaddr *) &address, sizeof(address)) != 0 || listen(listenSocket, 64) != 0) {
+            std::string error = strerror(errno);
+            close(listenSocket);
+            close(wakePipe[0]);
+            close(wakePipe[1]);
+            throw std::runtime_error("failed to listen on \"" + socketPath + "\": " + error);
+        }
+
+        std::vector<std::thread> threads;
+        for (unsigned i = 0; i < workers; i++) {
+            threads.emplace_back(&TestServer::runWorker, this);
+        }
+
+        std::vector<pollfd> polled;
+        while (!stopping) {
+            polled = {{listenSocket, POLLIN, 0}, {wakePipe[0], POLLIN, 0}};
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                for (auto &entry: connections) {
+                    if (!entry.second.isBusy) {
+                        polled.push_back({entry.first, POLLIN, 0});
+                    }
+                }
+            }
+            if (poll(polled.data(), polled.size(), -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            char buffer[4096];
+            if (polled[1].revents != 0) {
+                while (read(wakePipe[0], buffer, sizeof(buffer)) > 0) {}
+            }
+
+            // the polled connections were idle and still are: a worker only dispatches again the busy connection it
+            // owns, so only this thread makes an idle connection busy
+            {
+                std::lock_guard<std::mutex> lock(queueMutex);
+                for (size_t i = 2; i < polled.size(); i++) {
+                    if (polled[i].revents == 0) {
+                        continue;
+                    }
+                    Connection &connection = connections.at(polled[i].fd);
+                    ssize_t length = read(connection.socket, buffer, sizeof(buffer));
+                    if (length > 0) {
+                        connection.input.append(buffer, length);
+                    } else if (length == 0 || errno != EINTR) {
+                        connection.isClosed = true;
+                    }
+                    dispatch(connection);
+                }
+            }
+
+            if (polled[0].revents != 0) {
+                int socket = accept(listenSocket, nullptr, nullptr);
+                if (socket < 0) {
+                    if (errno == EINTR || errno == ECONNABORTED) {
+                        continue;
+                    }
+                    break;
+                }
+                FILE *output = fdopen(socket, "w");
+                if (output == nullptr) {
+                    close(socket);
+                    continue;
+                }
+                std::lock_guard<std::mutex> lock(queueMutex);
+                connections[socket] = Connection{socket, output, {}};
+            }
+        }
+        stop();
+
+        for (auto &thread: threads) {
+            thread.join();
+        }
+        for (auto &entry: connections) {
+            fclose(entry.second.output);
+        }
+        close(listenSocket);
+        close(wakePipe[0]);
+        close(wakePipe[1]);
+        unlink(socketPath.c_str());
+    }
+};
+
+#endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_TESTSERVER_H
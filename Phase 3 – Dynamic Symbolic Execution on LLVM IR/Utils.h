@@ -2,6 +2,7 @@
 #define PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_UTILS_H
 
 #include <cstdio>
+#include <algorithm>
 #include <iostream>
 #include <set>
 #include <cstdlib>
@@ -12,30 +13,47 @@
 #include "llvm/IR/Function.h"
 #include "llvm/IR/Instructions.h"
 #include "llvm/IR/Instruction.h"
+#include "llvm/IR/ModuleSlotTracker.h"
 #include "llvm/IRReader/IRReader.h"
 #include "llvm/Support/SourceMgr.h"
 #include "llvm/Support/raw_ostream.h"
 
+#include "ExecutionBudget.h"
+#include "RandomEngine.h"
+
 using namespace llvm;
 
+// a comparison executed by a navigation with the predicate that held, the inverse one if it was false
+struct PathCondition {
+    ICmpInst *cmpInst;
+    CmpInst::Predicate predicate;
+    // the operands of cmpInst, where a phi is replaced by the value it got from the edge the path entered it by
+    Value *operands[2];
+};
+
 class Path {
 public:
-    std::map<std::string, int> argumentsMap;
+    std::map<std::string, int64_t> argumentsMap;
     std::vector<BasicBlock *> navigatedPath;
+    NavigationStatus status;
+    std::map<BasicBlock *, uint64_t> loopIterations;
+    std::vector<PathCondition> conditions;
+
+    Path(std::map<std::string, int64_t> argumentsMap, std::vector<BasicBlock *> path,
+         NavigationStatus status = NavigationStatus::Completed,
+         std::map<BasicBlock *, uint64_t> loopIterations = {}, std::vector<PathCondition> conditions = {})
+            : argumentsMap(std::move(argumentsMap)), navigatedPath(std::move(path)),
+              status(status), loopIterations(std::move(loopIterations)), conditions(std::move(conditions)) {}
+};
 
-    Path(std::map<std::string, int> argumentsMap, std::vector<BasicBlock *> path)
-            : argumentsMap(std::move(argumentsMap)), navigatedPath(std::move(path)) {}
+// values of the input arguments, indexed by the position of the argument in the sorted input argument set
+struct InputAssignment {
+    std::vector<int64_t> values;
+    std::vector<bool> assigned;
 };
 
 int randomInRange(int startOfRange, int endOfRange) {
-    //the random device that will seed the generator
-    std::random_device seeder;
-    //then make a mersenne twister engine
-    std::mt19937 engine(seeder());
-    //then the easy part... the distribution
-    std::uniform_int_distribution<int> dist(startOfRange, endOfRange);
-    //then just generate the integer like this:
-    return dist(engine);
+    return threadRandomEngine().inRange(startOfRange, endOfRange);
 }
 
 std::string getSimpleNodeName(const Value *node) {
@@ -47,6 +65,16 @@ std::string getSimpleNodeName(const Value *node) {
     return os.str();
 }
 
+// numbers unnamed values with the slot tracker of their function instead of a new one per call
+std::string getSimpleNodeName(const Value *node, ModuleSlotTracker &slotTracker) {
+    if (!node->getName().empty())
+        return node->getName().str();
+    std::string str;
+    raw_string_ostream os(str);
+    node->printAsOperand(os, false, slotTracker);
+    return os.str();
+}
+
 std::set<std::string> getInputArguments(BasicBlock *entryBlock, const std::string &prefix) {
     // get all variables that their variable name starts with "a"
     std::set<std::string> inputArguments;
@@ -61,14 +89,46 @@ std::set<std::string> getInputArguments(BasicBlock *entryBlock, const std::strin
     return inputArguments;
 }
 
-std::map<std::string, int> randomInitialize(std::set<std::string> inputArguments, int minRange, int maxRange) {
-    std::map<std::string, int> variableMap;
+/**
+ * @brief Input variables of a function: the allocas of its entry block whose name starts with prefix, the
+ * allocas its parameters are stored to (e.g. x.addr) and, in optimized code, the integer parameters that are
+ * used directly
+ */
+std::set<std::string> getInputArguments(Function &function, const std::string &prefix) {
+    std::set<std::string> inputArguments = getInputArguments(&function.getEntryBlock(), prefix);
+    std::set<const Argument *> storedArguments;
+    for (auto &I: function.getEntryBlock()) {
+        if (auto *storeInst = dyn_cast<StoreInst>(&I)) {
+            if (isa<Argument>(storeInst->getValueOperand()) && isa<AllocaInst>(storeInst->getPointerOperand())) {
+                inputArguments.insert(getSimpleNodeName(storeInst->getPointerOperand()));
+                storedArguments.insert(dyn_cast<Argument>(storeInst->getValueOperand()));
+            }
+        }
+    }
+    for (auto &argument: function.args()) {
+        if (argument.getType()->isIntegerTy() && storedArguments.count(&argument) == 0) {
+            inputArguments.insert(getSimpleNodeName(&argument));
+        }
+    }
+    return inputArguments;
+}
+
+std::map<std::string, int64_t> randomInitialize(std::set<std::string> inputArguments, int minRange, int maxRange) {
+    std::map<std::string, int64_t> variableMap;
     for (auto &variable: inputArguments) {
         variableMap[variable] = randomInRange(minRange, maxRange);
     }
     return variableMap;
 }
 
+InputAssignment randomInitialize(size_t inputCount, int minRange, int maxRange) {
+    InputAssignment inputAssignment{std::vector<int64_t>(inputCount), std::vector<bool>(inputCount, true)};
+    for (auto &value: inputAssignment.values) {
+        value = randomInRange(minRange, maxRange);
+    }
+    return inputAssignment;
+}
+
 std::string cmpPredicateToString(CmpInst::Predicate predicate) {
     switch (predicate) {
         case CmpInst::ICMP_EQ:
@@ -135,4 +195,23 @@ std::string CmpInstructionToString(ICmpInst *cmpInst) {
            + ")";
 }
 
+std::string PathConditionToString(const PathCondition &condition) {
+    return "(" +
+           getSimpleNodeName(condition.cmpInst->getOperand(0)) + " " +
+           cmpPredicateToString(condition.predicate) + " " +
+           getSimpleNodeName(condition.cmpInst->getOperand(1))
+           + ")";
+}
+
+// the first line of a value as the IR printer writes it, like "%e = sext i8 %t to i32", for the errors of values
+// that are not modeled
+std::string valueToString(const Value *value) {
+    std::string text;
+    raw_string_ostream stream(text);
+    value->print(stream);
+    stream.flush();
+    size_t begin = std::min(text.find_first_not_of(' '), text.size());
+    return text.substr(begin, text.find('\n', begin) - begin);
+}
+
 #endif //PHASE_3__DYNAMIC_SYMBOLIC_EXECUTION_ON_LLVM_IR_UTILS_H